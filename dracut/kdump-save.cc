@@ -18,9 +18,11 @@
 #include <cerrno>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <string>
 
+#include <fcntl.h>
 #include <signal.h>
 #include <sys/resource.h>
 #include <sys/types.h>
@@ -31,11 +33,14 @@
 #include "global.h"
 #include "configuration.h"
 #include "deletedumps.h"
+#include "dumpestimator.h"
 #include "fileutil.h"
 #include "ledblink.h"
 #include "mounts.h"
 #include "process.h"
 #include "savedump.h"
+#include "timeline.h"
+#include "vmcoreindex.h"
 
 using std::cerr;
 using std::cout;
@@ -159,6 +164,17 @@ static inline bool handleExitFadump()
 
 #endif
 
+// print how long each phase took (also saved in the dump directory)
+static void printTimeline()
+{
+    Timeline *timeline = Timeline::timeline();
+    if (timeline->empty())
+        return;
+
+    cout << endl << "Timeline of dump saving:" << endl;
+    timeline->print(cout);
+}
+
 // If KDUMP_IMMEDIATE_REBOOT is false, then open a shell. If it's true, then
 // reboot.
 static void handleExit()
@@ -342,18 +358,67 @@ void rwFixup()
     }
 }
 
-static void deleteDumps()
+// sample the pages of the dump once; the same estimate is used to make
+// room for the new dump and to choose its dump level
+static std::unique_ptr<DumpEstimator> sampleDump()
 {
+    std::unique_ptr<DumpEstimator> estimator;
     try {
-        DeleteDumps deleter;
+        VmcoreIndex index(DEFAULT_DUMP);
+        estimator.reset(new DumpEstimator(index, sysconf(_SC_PAGESIZE)));
+        estimator->sample(FileDescriptor(DEFAULT_DUMP, O_RDONLY),
+                          DUMPESTIMATOR_SAMPLES, time(NULL));
+    } catch (KError &err) {
+        cerr << "Cannot estimate dump size: " << err.what() << endl;
+        estimator.reset();
+    }
+    return estimator;
+}
+
+// start deleting old dumps and wait until there is room for the new one
+static void startDeleteDumps(DeleteDumps &deleter,
+                             const DumpEstimator *estimator)
+{
+    Configuration *config = Configuration::config();
+
+    try {
+        unsigned long long projected = 0;
+        try {
+            if (estimator)
+                projected = estimator->estimate(
+                    config->KDUMP_DUMPLEVEL.value(),
+                    DumpEstimator::parseFormat(
+                        config->KDUMP_DUMPFORMAT.value()));
+        } catch (KError &err) {
+            cerr << "Cannot estimate dump size: " << err.what() << endl;
+        }
+
         deleter.rootDir(KDUMP_DIR);
-        deleter.deleteAll();
+        deleter.start(projected);
+
+        // without an estimate, the space needed for the new dump is
+        // unknown; finish deleting before the dump is saved, so that
+        // the deletion cannot run into the new dump
+        if (projected)
+            deleter.waitForSpace();
+        else
+            deleter.wait();
+    } catch (KError &err) {
+        handleError(string("Cannot delete old dumps: ") + err.what());
+    }
+}
+
+// wait for the rest of the old dumps to be deleted
+static void finishDeleteDumps(DeleteDumps &deleter)
+{
+    try {
+        deleter.wait();
     } catch (KError &err) {
         handleError(string("Cannot delete old dumps: ") + err.what());
     }
 }
 
-static void saveDump()
+static void saveDump(const DumpEstimator *estimator)
 {
     string hostname;
     ifstream fin(HOSTNAME);
@@ -374,6 +439,7 @@ static void saveDump()
         SaveDump saver;
         saver.rootDir(KDUMP_DIR);
         saver.hostName(hostname);
+        saver.estimator(estimator);
         saver.create();
     } catch (KError &err) {
         Configuration *config = Configuration::config();
@@ -396,15 +462,19 @@ static void execute()
 
     const string &transfer = config->KDUMP_TRANSFER.value();
     if (!transfer.empty()) {
+        TimelinePhase phase("transfer");
         int code = runCommand(transfer);
         if (code)
             cerr << "Transfer exit code is " << code << endl;
     } else {
+        TimelinePhase rwPhase("remount read-write");
         rwFixup();
+        rwPhase.end();
 
         // pre-script
         const string &prescript = config->KDUMP_PRESCRIPT.value();
         if (!prescript.empty()) {
+            TimelinePhase phase("pre-script");
             int code = runCommand(prescript);
             if (code != 0 && !config->KDUMP_CONTINUE_ON_ERROR.value()) {
                 ostringstream msg;
@@ -413,15 +483,30 @@ static void execute()
             }
         }
 
-        // delete old dumps
-        deleteDumps();
+        TimelinePhase estimatePhase("sample dump");
+        std::unique_ptr<DumpEstimator> estimator = sampleDump();
+        estimatePhase.end();
+
+        // delete old dumps while the dump is saved; the dump level is
+        // chosen only after there is room for the new dump
+        DeleteDumps deleter;
+        TimelinePhase deletePhase("wait for free space");
+        startDeleteDumps(deleter, estimator.get());
+        deletePhase.end();
 
         // save the dump
-        saveDump();
+        TimelinePhase savePhase("save dump");
+        saveDump(estimator.get());
+        savePhase.end();
+
+        TimelinePhase finishPhase("finish deleting old dumps");
+        finishDeleteDumps(deleter);
+        finishPhase.end();
 
         // post-script
         const string &postscript = config->KDUMP_POSTSCRIPT.value();
         if (!postscript.empty()) {
+            TimelinePhase phase("post-script");
             int code = runCommand(postscript);
             if (code != 0 && !config->KDUMP_CONTINUE_ON_ERROR.value()) {
                 ostringstream msg;
@@ -431,11 +516,15 @@ static void execute()
         }
     }
 
+    printTimeline();
     handleExit();
 }
 
 int main(int argc, char **argv)
 {
+    // start the clock as early as possible
+    Timeline::timeline();
+
     try {
         // sanity check
         if (!FilePath(DEFAULT_DUMP).exists())
@@ -454,8 +543,9 @@ int main(int argc, char **argv)
     } catch(std::exception &e) {
         cerr << "Cannot save dump!" << endl
              << endl
-             << "  " << e.what() << "." << endl
-             << endl
+             << "  " << e.what() << "." << endl;
+        printTimeline();
+        cerr << endl
              << "Something failed. You can try to debug it here." << endl;
         runShell();
         return 1;
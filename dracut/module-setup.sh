@@ -21,6 +21,9 @@ kdump_check_net() {
     elif [ "${KDUMP_NETCONFIG%:force}" != "$KDUMP_NETCONFIG" ]; then
         # always set up network
         kdump_neednet=y
+    elif [ "$KDUMP_LEAN_INITRD" = "yes" ]; then
+        # only if kdumptool needs it to save the dump
+        [ "$kdump_needs_network" = "yes" ] && kdump_neednet=y
     else
         for protocol in "${kdump_Protocol[@]}" ; do
 	    if [ "$protocol" != "file" -a "$protocol" != "srcfile" ]; then
@@ -125,7 +128,7 @@ depends() {
 
     # drm is needed to get console output, but it is not included
     # automatically, because kdump does not use plymouth
-    _modules[drm]=
+    [ "$KDUMP_LEAN_INITRD" != "yes" ] && _modules[drm]=
 
     [ "$kdump_neednet" = y ] && _modules[network]=
 
@@ -307,10 +310,14 @@ install() {
 	inst_hook pre-pivot 90 "$KDUMP_LIBDIR"/kdump-save
     fi
 
-    inst_multiple makedumpfile \
-	$KDUMP_REQUIRED_PROGRAMS
-    inst_simple $(type -p makedumpfile-R.pl) /kdump/makedumpfile-R.pl
-    chmod -x "$initdir/kdump/makedumpfile-R.pl"
+    if [ "$KDUMP_LEAN_INITRD" != "yes" -o \
+	 "$kdump_needs_makedumpfile" = "yes" ] ; then
+	inst_multiple makedumpfile
+	inst_simple $(type -p makedumpfile-R.pl) /kdump/makedumpfile-R.pl
+	chmod -x "$initdir/kdump/makedumpfile-R.pl"
+    fi
+    [ -n "$KDUMP_REQUIRED_PROGRAMS" ] && \
+	inst_multiple $KDUMP_REQUIRED_PROGRAMS
 
     # Install /etc/resolv.conf to provide initial DNS configuration. The file
     # is resolved first to install directly the target file if it is a symlink.
@@ -0,0 +1,70 @@
+/*
+ * (c) 2026, SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <string>
+
+#include "global.h"
+#include "kerneltool.h"
+#include "stringutil.h"
+#include "util.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    if (argc < 3) {
+        cerr << "Usage: " << argv[0] << " iterations image..." << endl;
+        return EXIT_FAILURE;
+    }
+
+    int iterations = atoi(argv[1]);
+    if (iterations <= 0) {
+        cerr << "Invalid number of iterations: " << argv[1] << endl;
+        return EXIT_FAILURE;
+    }
+
+    cout << std::fixed << std::setprecision(3);
+    for (int i = 2; i < argc; ++i) {
+        string result;
+        double start = Util::monotonicTime();
+        for (int j = 0; j < iterations; ++j) {
+            try {
+                KernelTool kt(argv[i]);
+                result = StringUtil::number2string(
+                    kt.extractKernelConfig().size()) + " bytes";
+            } catch (const KError &e) {
+                result = e.what();
+            }
+        }
+        double elapsed = Util::monotonicTime() - start;
+
+        cout << argv[i] << ": " << elapsed * 1000 / iterations
+             << " ms (" << result << ")" << endl;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
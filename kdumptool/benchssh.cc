@@ -0,0 +1,243 @@
+/*
+ * (c) 2026, SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <iterator>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "global.h"
+#include "configuration.h"
+#include "dataprovider.h"
+#include "fileutil.h"
+#include "process.h"
+#include "rootdirurl.h"
+#include "sshtransfer.h"
+#include "stringutil.h"
+#include "util.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+// Stand-in for ssh(1) which runs the remote command on the local host
+static const char fakeSSH[] =
+    "#!/bin/sh\n"
+    "for arg; do cmd=$arg; done\n"
+    "exec /bin/sh -c \"$cmd\"\n";
+
+// -----------------------------------------------------------------------------
+static void writeFile(const string &name, const char *data, size_t len,
+                      mode_t mode = 0644)
+{
+    int fd = open(name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, mode);
+    if (fd < 0)
+        throw KSystemError("Cannot create " + name, errno);
+    while (len) {
+        ssize_t ret = write(fd, data, len);
+        if (ret < 0) {
+            close(fd);
+            throw KSystemError("Cannot write " + name, errno);
+        }
+        data += ret;
+        len -= ret;
+    }
+    close(fd);
+}
+
+// -----------------------------------------------------------------------------
+// Every sparse-th MiB is random, the rest is zero.
+static void makeInput(const string &name, unsigned mib, unsigned sparse)
+{
+    std::vector<char> data(size_t(mib) << 20);
+    std::mt19937 rng(mib);
+    for (unsigned i = 0; i < mib; i += sparse) {
+        uint32_t *p = reinterpret_cast<uint32_t *>(&data[size_t(i) << 20]);
+        for (size_t j = 0; j < (1 << 20) / sizeof(*p); ++j)
+            p[j] = rng();
+    }
+    writeFile(name, data.data(), data.size());
+}
+
+// -----------------------------------------------------------------------------
+static bool sameContents(const string &a, const string &b)
+{
+    std::ifstream fa(a.c_str(), std::ios::binary);
+    std::ifstream fb(b.c_str(), std::ios::binary);
+    std::istreambuf_iterator<char> ia(fa), ib(fb), end;
+    while (ia != end && ib != end)
+        if (*ia++ != *ib++)
+            return false;
+    return ia == end && ib == end;
+}
+
+// -----------------------------------------------------------------------------
+// The transfer before large blocks were used: BUFSIZ writes into
+// a dd with the default block size.
+static void legacyTransfer(const string &input, const string &target)
+{
+    string remote = "dd of=" + target + "-incomplete && mv " +
+        target + "-incomplete " + target;
+    StringVector args;
+    args.push_back("localhost");
+    args.push_back(remote);
+
+    SubProcess p;
+    auto pipe = std::make_shared<ParentToChildPipe>();
+    p.setChildFD(STDIN_FILENO, pipe);
+    p.spawn("ssh", args);
+
+    std::ifstream in(input.c_str(), std::ios::binary);
+    char buf[BUFSIZ];
+    while (in.read(buf, sizeof buf) || in.gcount()) {
+        const char *p = buf;
+        size_t len = in.gcount();
+        while (len) {
+            ssize_t ret = write(pipe->writeEnd(), p, len);
+            if (ret < 0)
+                throw KSystemError("Cannot write to ssh", errno);
+            p += ret;
+            len -= ret;
+        }
+    }
+    pipe->close();
+    if (p.wait() != 0)
+        throw KError("ssh failed");
+}
+
+// -----------------------------------------------------------------------------
+static void run(const string &dir, const string &input, const string &mode,
+                unsigned mib)
+{
+    Configuration *config = Configuration::config();
+    config->KDUMP_SSH_SPARSE.update(mode == "sparse" ? "yes" : "no");
+    config->KDUMP_SSH_COMPRESS.update(
+        mode == "gzip" || mode == "zstd" ? mode : "");
+    config->KDUMP_SSH_STREAM.update(mode == "stream" ? "zstd" : "");
+
+    FilePath target(dir);
+    target.appendPath("out");
+    // KDUMP_SSH_COMPRESS applies to dump files only
+    string file = "vmcore-" + FilePath(input).baseName() + "-" + mode;
+
+    string result;
+    double start = Util::monotonicTime();
+    try {
+        if (mode == "legacy") {
+            target.mkdir(true);
+            legacyTransfer(input, target + "/" + file);
+        } else {
+            RootDirURLVector urlv;
+            urlv.push_back(RootDirURL("ssh://bench@localhost" + target, ""));
+            SSHTransfer transfer(urlv);
+            FileDataProvider provider(input.c_str());
+            transfer.perform(&provider, StringVector(1, file), NULL);
+        }
+    } catch (const KError &e) {
+        result = e.what();
+    }
+    double elapsed = Util::monotonicTime() - start;
+
+    if (result.empty()) {
+        string suffix = mode == "gzip" ? ".gz" : mode == "zstd" ? ".zst" : "";
+        struct stat st;
+        string output = target + "/" + file + suffix;
+        if (stat(output.c_str(), &st) != 0)
+            result = "no output";
+        else if (suffix.empty() && !sameContents(input, output))
+            result = "output differs";
+        else
+            result = StringUtil::number2string(st.st_size >> 10) +
+                " KiB, " +
+                StringUtil::number2string((st.st_blocks * 512) >> 10) +
+                " KiB allocated";
+    }
+
+    cout << std::left << std::setw(8) << FilePath(input).baseName()
+         << std::setw(8) << mode << std::right
+         << std::setw(10) << mib / elapsed << " MiB/s (" << result << ")"
+         << endl;
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    if (argc != 2) {
+        cerr << "Usage: " << argv[0] << " size_in_MiB" << endl;
+        return EXIT_FAILURE;
+    }
+
+    int mib = atoi(argv[1]);
+    if (mib <= 0) {
+        cerr << "Invalid size: " << argv[1] << endl;
+        return EXIT_FAILURE;
+    }
+
+    char tmpl[] = "/tmp/benchssh.XXXXXX";
+    if (!mkdtemp(tmpl)) {
+        perror("mkdtemp");
+        return EXIT_FAILURE;
+    }
+    FilePath dir(tmpl);
+    signal(SIGPIPE, SIG_IGN);
+
+    int ret = EXIT_SUCCESS;
+    try {
+        FilePath bin(dir);
+        bin.appendPath("bin").mkdir(false);
+        writeFile(bin + "/ssh", fakeSSH, sizeof(fakeSSH) - 1, 0755);
+        const char *path = getenv("PATH");
+        setenv("PATH", (bin + ":" + (path ? path : "/usr/bin:/bin")).c_str(),
+               1);
+
+        string random = dir + "/random";
+        string sparse = dir + "/sparse";
+        makeInput(random, mib, 1);
+        makeInput(sparse, mib, 8);
+
+        static const char *const modes[] = {
+            "legacy", "default", "sparse", "gzip", "zstd", "stream"
+        };
+        cout << std::fixed << std::setprecision(1);
+        for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); ++i) {
+            run(dir, random, modes[i], mib);
+            run(dir, sparse, modes[i], mib);
+        }
+    } catch (const std::exception &e) {
+        cerr << "Fatal exception: " << e.what() << endl;
+        ret = EXIT_FAILURE;
+    }
+
+    dir.rmdir(true);
+    return ret;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,278 @@
+/*
+ * (c) 2026, SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include <cerrno>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <endian.h>
+#include <elf.h>
+
+#include "global.h"
+#include "debug.h"
+#include "bootheader.h"
+
+using std::string;
+
+/* x86 boot header for bzImage */
+#define X86_HEADER_OFF_SETUP_SECTS  0x01f1
+#define X86_HEADER_OFF_START        0x0202
+#define X86_HEADER_OFF_VERSION      0x0206
+#define X86_HEADER_OFF_KVERSION     0x020e
+#define X86_HEADER_OFF_RELOCATABLE  0x0234
+#define X86_HEADER_OFF_PAYLOAD      0x0248
+#define X86_HEADER_OFF_PAYLOAD_LEN  0x024c
+#define X86_HEADER_MAGIC            0x53726448
+#define X86_HEADER_RELOCATABLE_VER  0x0205
+#define X86_HEADER_PAYLOAD_VER      0x0208
+
+/* kernel_version is relative to the start of the setup header */
+#define X86_KVERSION_BASE           0x0200
+#define X86_KVERSION_MAX            256
+
+/* arm64 Image header (Documentation/arch/arm64/booting.rst) */
+#define AARCH64_HEADER_OFF_SIZE     16
+#define AARCH64_HEADER_OFF_MAGIC    56
+#define AARCH64_HEADER_SIZE         64
+#define AARCH64_HEADER_MAGIC        0x644d5241  /* "ARM\x64" */
+
+/* S/390 VM boot image */
+#define S390_HEADER_OFF_IPLSTART    4
+#define S390_HEADER_SIZE_IPLSTART   4
+static const unsigned char S390_HEADER[] = {
+  0x00, 0x08, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00,
+  0x02, 0x00, 0x00, 0x18, 0x60, 0x00, 0x00, 0x50,
+  0x02, 0x00, 0x00, 0x68, 0x60, 0x00, 0x00, 0x50,
+  0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40,
+  0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40,
+  0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40,
+  0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40,
+  0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40,
+  0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40,
+  0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40,
+  0x02, 0x00, 0x00, 0xf0, 0x60, 0x00, 0x00, 0x50,
+  0x02, 0x00, 0x01, 0x40, 0x60, 0x00, 0x00, 0x50,
+  0x02, 0x00, 0x01, 0x90, 0x60, 0x00, 0x00, 0x50,
+  0x02, 0x00, 0x01, 0xe0, 0x60, 0x00, 0x00, 0x50,
+  0x02, 0x00, 0x02, 0x30, 0x60, 0x00, 0x00, 0x50,
+  0x02, 0x00, 0x02, 0x80, 0x60, 0x00, 0x00, 0x50,
+  0x02, 0x00, 0x02, 0xd0, 0x60, 0x00, 0x00, 0x50,
+  0x02, 0x00, 0x03, 0x20, 0x60, 0x00, 0x00, 0x50,
+  0x02, 0x00, 0x03, 0x70, 0x60, 0x00, 0x00, 0x50,
+  0x02, 0x00, 0x03, 0xc0, 0x60, 0x00, 0x00, 0x50,
+  0x02, 0x00, 0x04, 0x10, 0x60, 0x00, 0x00, 0x50,
+  0x02, 0x00, 0x04, 0x60, 0x60, 0x00, 0x00, 0x50,
+  0x02, 0x00, 0x04, 0xb0, 0x60, 0x00, 0x00, 0x50,
+  0x02, 0x00, 0x05, 0x00, 0x60, 0x00, 0x00, 0x50,
+  0x02, 0x00, 0x05, 0x50, 0x60, 0x00, 0x00, 0x50,
+  0x02, 0x00, 0x05, 0xa0, 0x60, 0x00, 0x00, 0x50,
+  0x02, 0x00, 0x05, 0xf0, 0x60, 0x00, 0x00, 0x50,
+  0x02, 0x00, 0x06, 0x40, 0x60, 0x00, 0x00, 0x50,
+  0x02, 0x00, 0x06, 0x90, 0x60, 0x00, 0x00, 0x50,
+  0x02, 0x00, 0x06, 0xe0, 0x20, 0x00, 0x00, 0x50,
+};
+
+// -----------------------------------------------------------------------------
+static inline uint16_t get_le16(const unsigned char *p)
+{
+    uint16_t val;
+    memcpy(&val, p, sizeof val);
+    return le16toh(val);
+}
+
+// -----------------------------------------------------------------------------
+static inline uint32_t get_le32(const unsigned char *p)
+{
+    uint32_t val;
+    memcpy(&val, p, sizeof val);
+    return le32toh(val);
+}
+
+// -----------------------------------------------------------------------------
+static inline uint64_t get_le64(const unsigned char *p)
+{
+    uint64_t val;
+    memcpy(&val, p, sizeof val);
+    return le64toh(val);
+}
+
+//{{{ BootHeader ---------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+BootHeader::BootHeader(int fd)
+    : m_data(NULL), m_len(0), m_map(NULL)
+{
+    Debug::debug()->trace("BootHeader::BootHeader(%d)", fd);
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+        throw KSystemError("Cannot stat kernel image", errno);
+
+    // pages are faulted in only as far as the parser looks at them
+    if (S_ISREG(st.st_mode) && st.st_size > 0) {
+        m_map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (m_map == MAP_FAILED) {
+            m_map = NULL;
+            throw KSystemError("Cannot map kernel image", errno);
+        }
+        m_data = static_cast<const unsigned char *>(m_map);
+        m_len = st.st_size;
+    }
+
+    parse();
+}
+
+// -----------------------------------------------------------------------------
+BootHeader::BootHeader(const void *data, size_t len)
+    : m_data(static_cast<const unsigned char *>(data)), m_len(len),
+      m_map(NULL)
+{
+    parse();
+}
+
+// -----------------------------------------------------------------------------
+BootHeader::~BootHeader()
+{
+    if (m_map)
+        munmap(m_map, m_len);
+}
+
+// -----------------------------------------------------------------------------
+const char *BootHeader::formatName(Format fmt)
+{
+    switch (fmt) {
+        case BH_ELF:
+            return "ELF";
+        case BH_X86:
+            return "bzImage";
+        case BH_S390:
+            return "S/390";
+        case BH_AARCH64:
+            return "arm64 Image";
+        default:
+            return "unknown";
+    }
+}
+
+// -----------------------------------------------------------------------------
+void BootHeader::parse()
+{
+    m_format = BH_UNKNOWN;
+    m_protocol = 0;
+    m_relocatable = false;
+    m_payloadOffset = -1;
+    m_payloadLength = 0;
+    m_payloadCompression = Decompressor::FMT_NONE;
+    m_imageSize = 0;
+
+    // the headers of a compressed file are not accessible
+    m_compression = Decompressor::detect(m_data, m_len);
+    if (m_compression != Decompressor::FMT_NONE)
+        return;
+
+    if (m_len >= SELFMAG && memcmp(m_data, ELFMAG, SELFMAG) == 0)
+        m_format = BH_ELF;
+    else if (parseX86())
+        m_format = BH_X86;
+    else if (parseS390())
+        m_format = BH_S390;
+    else if (parseAarch64())
+        m_format = BH_AARCH64;
+
+    Debug::debug()->dbg("Boot header: %s", formatName(m_format));
+}
+
+// -----------------------------------------------------------------------------
+bool BootHeader::parseX86()
+{
+    if (m_len < X86_HEADER_OFF_VERSION + 2 ||
+        get_le32(m_data + X86_HEADER_OFF_START) != X86_HEADER_MAGIC)
+        return false;
+
+    m_protocol = get_le16(m_data + X86_HEADER_OFF_VERSION);
+
+    if (m_len >= X86_HEADER_OFF_KVERSION + 2) {
+        size_t kversion = get_le16(m_data + X86_HEADER_OFF_KVERSION);
+        size_t start = X86_KVERSION_BASE + kversion;
+        if (kversion && start < m_len) {
+            const char *s = reinterpret_cast<const char *>(m_data + start);
+            size_t maxlen = m_len - start;
+            if (maxlen > X86_KVERSION_MAX)
+                maxlen = X86_KVERSION_MAX;
+            m_version.assign(s, strnlen(s, maxlen));
+        }
+    }
+
+    // older versions are not relocatable
+    if (m_protocol >= X86_HEADER_RELOCATABLE_VER &&
+        m_len > X86_HEADER_OFF_RELOCATABLE)
+        m_relocatable = !!m_data[X86_HEADER_OFF_RELOCATABLE];
+
+    // the payload offset is relative to the protected-mode code,
+    // which starts after the boot sector and the setup sectors
+    if (m_protocol >= X86_HEADER_PAYLOAD_VER &&
+        m_len >= X86_HEADER_OFF_PAYLOAD_LEN + 4) {
+        unsigned setup_sects = m_data[X86_HEADER_OFF_SETUP_SECTS];
+        if (!setup_sects)
+            setup_sects = 4;
+        size_t offset = (setup_sects + 1) * 512 +
+            size_t(get_le32(m_data + X86_HEADER_OFF_PAYLOAD));
+        if (offset < m_len) {
+            m_payloadOffset = offset;
+            m_payloadLength = get_le32(m_data + X86_HEADER_OFF_PAYLOAD_LEN);
+            m_payloadCompression = Decompressor::detect(m_data + offset,
+                                                        m_len - offset);
+        }
+    }
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+bool BootHeader::parseS390()
+{
+    if (m_len < sizeof S390_HEADER)
+        return false;
+
+    /* the iplstart address varies, so ignore it */
+    const size_t tail = S390_HEADER_OFF_IPLSTART + S390_HEADER_SIZE_IPLSTART;
+    if (memcmp(m_data, S390_HEADER, S390_HEADER_OFF_IPLSTART) != 0 ||
+        memcmp(m_data + tail, S390_HEADER + tail,
+               sizeof S390_HEADER - tail) != 0)
+        return false;
+
+    m_relocatable = true;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+bool BootHeader::parseAarch64()
+{
+    if (m_len < AARCH64_HEADER_SIZE ||
+        get_le32(m_data + AARCH64_HEADER_OFF_MAGIC) != AARCH64_HEADER_MAGIC)
+        return false;
+
+    m_imageSize = get_le64(m_data + AARCH64_HEADER_OFF_SIZE);
+    m_relocatable = true;
+    return true;
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,181 @@
+/*
+ * (c) 2026, SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#ifndef BOOTHEADER_H
+#define BOOTHEADER_H
+
+#include <string>
+
+#include <sys/types.h>
+
+#include "global.h"
+#include "decompress.h"
+
+//{{{ BootHeader ---------------------------------------------------------------
+
+/**
+ * Parser for the headers at the start of a kernel image file.
+ *
+ * The file is memory-mapped and all headers are parsed at once when the
+ * object is created: ELF, the x86 boot protocol (bzImage), the arm64
+ * Image header and the S/390 VM boot image. All accessors return the
+ * parsed values without further system calls.
+ *
+ * The parser never reads outside the mapped data, so it is safe to use
+ * on truncated or otherwise damaged files.
+ */
+class BootHeader {
+
+    public:
+        /**
+         * Image format recognised from the header.
+         */
+        enum Format {
+            BH_UNKNOWN,
+            BH_ELF,
+            BH_X86,
+            BH_S390,
+            BH_AARCH64
+        };
+
+        /**
+         * Map a kernel image and parse its headers.
+         *
+         * @param[in] fd file descriptor of the kernel image; the file
+         *            offset is not changed
+         * @exception KSystemError if the file cannot be mapped
+         */
+        BootHeader(int fd);
+
+        /**
+         * Parse the headers of a kernel image in memory. The data is
+         * not copied and must stay valid while the object is used.
+         *
+         * @param[in] data start of the kernel image
+         * @param[in] len  size of @p data
+         */
+        BootHeader(const void *data, size_t len);
+
+        virtual ~BootHeader();
+
+        /**
+         * Returns the format of the (uncompressed) file.
+         */
+        Format format() const
+        { return m_format; }
+
+        /**
+         * Returns the compression format of the whole file. A compressed
+         * file is reported as BH_UNKNOWN by format().
+         */
+        Decompressor::Format compression() const
+        { return m_compression; }
+
+        /**
+         * Returns the x86 boot protocol version, e.g. 0x20f, or zero if
+         * this is not a bzImage.
+         */
+        unsigned protocolVersion() const
+        { return m_protocol; }
+
+        /**
+         * Checks whether the kernel is relocatable. This is the
+         * relocatable_kernel flag for a bzImage; arm64 and S/390 images
+         * are always relocatable. It is @c false for all other formats.
+         */
+        bool isRelocatable() const
+        { return m_relocatable; }
+
+        /**
+         * Returns the file offset of the compressed kernel in a bzImage
+         * (boot protocol 2.08 or later), or -1 if it is not known.
+         */
+        off_t payloadOffset() const
+        { return m_payloadOffset; }
+
+        /**
+         * Returns the size of the compressed kernel in a bzImage, or zero
+         * if it is not known.
+         */
+        size_t payloadLength() const
+        { return m_payloadLength; }
+
+        /**
+         * Returns the compression format of the payload. Only meaningful
+         * if payloadOffset() is not negative.
+         */
+        Decompressor::Format payloadCompression() const
+        { return m_payloadCompression; }
+
+        /**
+         * Returns the kernel version string embedded in a bzImage, e.g.
+         * "6.4.0-150600.21-default (geeko@buildhost) #1 SMP ...", or an
+         * empty string if there is none.
+         */
+        const std::string &version() const
+        { return m_version; }
+
+        /**
+         * Returns the effective image size from the arm64 Image header,
+         * or zero if it is not known.
+         */
+        unsigned long long imageSize() const
+        { return m_imageSize; }
+
+        /**
+         * Returns a human-readable name of a format, e.g. "bzImage".
+         *
+         * @param[in] fmt the image format
+         */
+        static const char *formatName(Format fmt);
+
+    protected:
+        /**
+         * Parse all headers. Called once from the constructors.
+         */
+        void parse();
+
+        bool parseX86();
+        bool parseS390();
+        bool parseAarch64();
+
+    private:
+        const unsigned char *m_data;
+        size_t m_len;
+        void *m_map;
+
+        Format m_format;
+        Decompressor::Format m_compression;
+        unsigned m_protocol;
+        bool m_relocatable;
+        off_t m_payloadOffset;
+        size_t m_payloadLength;
+        Decompressor::Format m_payloadCompression;
+        std::string m_version;
+        unsigned long long m_imageSize;
+
+        // non-copyable
+        BootHeader(const BootHeader &);
+        BootHeader &operator=(const BootHeader &);
+};
+
+//}}}
+
+#endif /* BOOTHEADER_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
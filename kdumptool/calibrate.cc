@@ -18,13 +18,18 @@
  */
 #include <iostream>
 #include <fstream>
+#include <cstdio>
 #include <cerrno>
 #include <cstring>
 #include <cstdlib>
 #include <limits>
+#include <memory>
+#include <sstream>
+#include <vector>
 
 #include <dirent.h>
 #include <fcntl.h>
+#include <strings.h>
 #include <unistd.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -40,6 +45,7 @@
 #include "rootdirurl.h"
 #include "stringvector.h"
 #include "configparser.h"
+#include "cryptinfo.h"
 
 // All calculations are in KiB
 
@@ -155,6 +161,16 @@ static inline unsigned long s390x_align_memmap(unsigned long maxpfn)
 // with 4-KiB pages this covers 0.5 TiB of RAM in one cycle
 #define MAX_BITMAP_KB	MB(32)
 
+// makedumpfile keeps PAGE_DATA_NUM (50) page buffers for every thread,
+// each of them holding a page before and after compression
+#define THREAD_PAGE_BUFFERS	(2 * 50)
+
+// Compression work area and touched stack of a makedumpfile thread
+#define THREAD_EXTRA_KB		MB(1)
+
+// Private memory of a makedumpfile --split process (without bitmaps)
+#define SPLIT_PROCESS_KB	MB(4)
+
 // Minimum lowmem allocation. This is 64M for swiotlb and 8M
 // for overflow, DMA buffers, etc.
 #define MINLOW_KB	MB(64 + 8)
@@ -950,105 +966,179 @@ unsigned long long MemMap::find(unsigned long size, unsigned long align) const
 }
 
 //}}}
-//{{{ CryptInfo ----------------------------------------------------------------
+//{{{ Breakdown ----------------------------------------------------------------
 
 /**
- * Given a LUKS crypto device, dump the header using 'cryptinfo' and
- * parse the output looking for maximum memory requirements.
+ * Record of all terms which contribute to the final reservation size.
  */
-class CryptInfo {
-        unsigned long m_memory;
+class Breakdown {
+        struct Term {
+            std::string name;
+            unsigned long kb;
+            std::string source;
+        };
+        std::vector<Term> m_terms;
 
     public:
-        CryptInfo(std::string const& device);
+        /**
+         * Add a term.
+         *
+         * @param[in] name   short identifier of the term
+         * @param[in] kb     size [KiB]
+         * @param[in] source where the number comes from
+         */
+        void add(const std::string &name, unsigned long kb,
+                 const std::string &source)
+        { m_terms.push_back(Term{ name, kb, source }); }
 
-	/**
-	 * Get memory requirements.
-	 *
-	 * @return Maximum memory in KiB needed to open the device
-	 */
-        unsigned long memory(void) const
-        { return m_memory; }
+        /**
+         * Append all terms of another breakdown.
+         */
+        void add(const Breakdown &other)
+        { m_terms.insert(m_terms.end(),
+                         other.m_terms.begin(), other.m_terms.end()); }
+
+        /**
+         * Write all terms as a JSON array.
+         *
+         * @param[in] os output stream
+         */
+        void writeJSON(std::ostream &os) const;
 };
 
 // -----------------------------------------------------------------------------
-CryptInfo::CryptInfo(std::string const& device)
-    : m_memory(0)
+static string jsonString(const string &str)
 {
-    Debug::debug()->trace("CryptInfo::CryptInfo(%s)", device.c_str());
-
-    ProcessFilter p;
-
-    StringVector args;
-    args.push_back("luksDump");
-    args.push_back(device);
+    std::ostringstream ss;
 
-    std::ostringstream stdoutStream, stderrStream;
-    p.setStdout(&stdoutStream);
-    p.setStderr(&stderrStream);
-    int ret = p.execute("cryptsetup", args);
-    if (ret != 0) {
-        KString error = stderrStream.str();
-        throw KError("cryptsetup failed: " + error.trim());
+    ss << '"';
+    for (unsigned char c : str) {
+        if (c == '"' || c == '\\')
+            ss << '\\' << c;
+        else if (c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof buf, "\\u%04x", c);
+            ss << buf;
+        } else
+            ss << c;
     }
+    ss << '"';
+    return ss.str();
+}
 
-    KString out = stdoutStream.str();
-    size_t pos = 0;
-    while (pos < out.length()) {
-        size_t end = out.find_first_of("\r\n", pos);
-        size_t sep = out.find(':', pos);
-        if (sep < end) {
-            KString key = out.substr(pos, sep - pos);
-            if (key.trim() == "Memory") {
-                KString val = out.substr(sep + 1, end - sep - 1);
-                unsigned long memory = val.trim().asLongLong();
-                Debug::debug()->dbg("Crypto device %s needs %lu KiB",
-                                    device.c_str(), memory);
-                if (memory > m_memory)
-                    m_memory = memory;
-            }
-        }
-        pos = out.find_first_not_of("\r\n", end);
+// -----------------------------------------------------------------------------
+void Breakdown::writeJSON(std::ostream &os) const
+{
+    os << '[';
+    for (auto it = m_terms.begin(); it != m_terms.end(); ++it) {
+        if (it != m_terms.begin())
+            os << ',';
+        os << endl << "    { \"term\": " << jsonString(it->name)
+           << ", \"KiB\": " << it->kb
+           << ", \"source\": " << jsonString(it->source) << " }";
     }
+    os << endl << "  ]";
 }
 
 //}}}
-//{{{ Calibrate ----------------------------------------------------------------
+//{{{ RuntimeSize --------------------------------------------------------------
 
-// -----------------------------------------------------------------------------
-Calibrate::Calibrate()
-    : m_shrink(false)
-{
-    Debug::debug()->trace("Calibrate::Calibrate()");
+/**
+ * Estimate the run-time memory requirements of the kdump environment.
+ *
+ * The parts which do not depend on the number of CPUs are computed
+ * only once, so the total can be re-evaluated cheaply for different
+ * values of KDUMP_CPUS.
+ */
+class RuntimeSize {
+        SizeConstants const &m_sizes;
+        unsigned long m_memtotal;
+        unsigned long m_syscpus;
+        unsigned long m_fixed;
+        Breakdown m_fixedTerms;
 
-    m_options.push_back(new FlagOption("shrink", 's', &m_shrink,
-        "Shrink the crash kernel reservation"));
-}
+    public:
+        /**
+         * Compute the CPU-independent requirements.
+         *
+         * @param[in] sizes    size constants of the target kernel
+         * @param[in] memtotal total RAM size [KiB]
+         *
+         * @exception KError if the system CPUs cannot be counted
+         */
+        RuntimeSize(SizeConstants const &sizes, unsigned long memtotal);
 
-// -----------------------------------------------------------------------------
-const char *Calibrate::getName() const
-{
-    return "calibrate";
-}
+        /**
+         * Get the number of CPUs in the system (online and offline).
+         */
+        unsigned long syscpus(void) const
+        { return m_syscpus; }
+
+        /**
+         * Get the total run-time requirements.
+         *
+         * @param[in]  cpus  value of KDUMP_CPUS (zero means all CPUs)
+         * @param[out] terms if non-NULL, all terms are added here
+         * @returns run-time memory requirements [KiB]
+         */
+        unsigned long size(unsigned long cpus,
+                           Breakdown *terms = nullptr) const;
+
+    protected:
+        /**
+         * Get the number of makedumpfile workers.
+         *
+         * This follows the logic of SaveDump::saveDump().
+         *
+         * @param[in]  cpus  value of KDUMP_CPUS
+         * @param[out] split set to @c true if --split would be used
+         * @returns number of threads or processes (at least 1)
+         */
+        unsigned long workers(unsigned long cpus, bool *split) const;
+
+        /**
+         * Get the kernel per-cpu requirements [KiB].
+         */
+        unsigned long percpu(unsigned long cpus, Breakdown *terms) const;
+
+        /**
+         * Get the user-space requirements [KiB].
+         */
+        unsigned long user(unsigned long cpus, Breakdown *terms) const;
+};
 
 // -----------------------------------------------------------------------------
-static unsigned long runtimeSize(SizeConstants const &sizes,
-                                 unsigned long memtotal)
+RuntimeSize::RuntimeSize(SizeConstants const &sizes, unsigned long memtotal)
+    : m_sizes(sizes), m_memtotal(memtotal)
 {
     Configuration *config = Configuration::config();
-    unsigned long required, prev;
+    unsigned long required;
+
+    SystemCPU syscpu;
+    unsigned long online = syscpu.numOnline();
+    unsigned long offline = syscpu.numOffline();
+    Debug::debug()->dbg("CPUs online: %lu, offline: %lu", online, offline);
+    m_syscpus = online + offline;
 
     // Run-time kernel requirements
     required = sizes.kernel_base_kb() + sizes.initramfs_kb();
+    m_fixedTerms.add("kernel_base", sizes.kernel_base_kb(),
+                     "calibrate.conf: KERNEL_BASE");
+    m_fixedTerms.add("initramfs", sizes.initramfs_kb(),
+                     "calibrate.conf: INIT_CACHED");
 
     // Double the size, because fbcon allocates its own framebuffer,
     // and many DRM drivers allocate the hw framebuffer in system RAM
     try {
         Framebuffers fb;
         required += 2 * fb.size() / 1024UL;
+        m_fixedTerms.add("framebuffer", 2 * fb.size() / 1024UL,
+                         "/sys/class/graphics (doubled for fbcon)");
     } catch(KError &e) {
         Debug::debug()->dbg("Cannot get framebuffer size: %s", e.what());
         required += 2 * DEF_FRAMEBUFFER_KB;
+        m_fixedTerms.add("framebuffer", 2 * DEF_FRAMEBUFFER_KB,
+                         string("default (") + e.what() + ")");
     }
 
     // LUKS Argon2 hash requires a lot of memory
@@ -1077,19 +1167,24 @@ static unsigned long runtimeSize(SizeConstants const &sizes,
         }
 
         unsigned long crypto_mem = 0;
+        string crypto_dev = "no LUKS devices";
         for (const auto& devmap : map.devices()) {
             if (devmap.second == "crypto_LUKS") {
                 CryptInfo info(devmap.first);
-                if (crypto_mem < info.memory())
+                if (crypto_mem < info.memory()) {
                     crypto_mem = info.memory();
+                    crypto_dev = "LUKS header of " + devmap.first;
+                }
             }
         }
         required += crypto_mem;
+        m_fixedTerms.add("luks", crypto_mem, crypto_dev);
 
         Debug::debug()->dbg("Adding %lu KiB for crypto devices", crypto_mem);
     } catch (KError &e) {
         Debug::debug()->dbg("Cannot check encrypted volumes: %s", e.what());
         // Fall back to no allocation
+        m_fixedTerms.add("luks", 0, string("unknown (") + e.what() + ")");
     }
 
     // Add space for constant slabs
@@ -1100,6 +1195,8 @@ static unsigned long runtimeSize(SizeConstants const &sizes,
                 unsigned long slabsize = elem.second->numSlabs() *
                     elem.second->pagesPerSlab() * sizes.pagesize() / 1024;
                 required += slabsize;
+                m_fixedTerms.add("slab", slabsize,
+                                 "/proc/slabinfo: " + elem.second->name());
 
                 Debug::debug()->dbg("Adding %ld KiB for %s slab cache",
                                     slabsize, elem.second->name().c_str());
@@ -1107,43 +1204,129 @@ static unsigned long runtimeSize(SizeConstants const &sizes,
         }
     } catch (KError &e) {
         Debug::debug()->dbg("Cannot get slab sizes: %s", e.what());
+        m_fixedTerms.add("slab", 0, string("unknown (") + e.what() + ")");
     }
 
-    // Add memory based on CPU count
-    unsigned long cpus = 0;
-    if (CAN_REDUCE_CPUS)
-        cpus = config->KDUMP_CPUS.value();
-    if (!cpus) {
-        SystemCPU syscpu;
-        unsigned long online = syscpu.numOnline();
-        unsigned long offline = syscpu.numOffline();
-        Debug::debug()->dbg("CPUs online: %lu, offline: %lu",
-                            online, offline);
-        cpus = online + offline;
+    m_fixed = required;
+}
+
+// -----------------------------------------------------------------------------
+unsigned long RuntimeSize::workers(unsigned long cpus, bool *split) const
+{
+    Configuration *config = Configuration::config();
+
+    *split = false;
+    if (cpus > m_syscpus)
+        cpus = m_syscpus;
+    if (config->kdumptoolContainsFlag("SINGLE") || cpus <= 1)
+        return 1;
+
+    // Neither --split nor --num-threads is available for ELF dumps
+    if (strcasecmp(config->KDUMP_DUMPFORMAT.value().c_str(), "elf") == 0)
+        return 1;
+
+    // The check for NOSPLIT is for backward compatibility
+    *split = config->kdumptoolContainsFlag("SPLIT") &&
+        !config->kdumptoolContainsFlag("NOSPLIT");
+    return cpus;
+}
+
+// -----------------------------------------------------------------------------
+unsigned long RuntimeSize::percpu(unsigned long cpus, Breakdown *terms) const
+{
+    const char *source = "KDUMP_CPUS";
+    if (!CAN_REDUCE_CPUS || !cpus) {
+        cpus = m_syscpus;
+        source = "system CPUs";
     }
-    Debug::debug()->dbg("Total assumed CPUs: %lu", cpus);
-    cpus *= sizes.percpu_kb();
-    Debug::debug()->dbg("Total per-cpu requirements: %lu KiB", cpus);
-    required += cpus;
 
-    // User-space requirements
-    unsigned long user = sizes.user_base_kb();
-    if (config->needsNetwork())
-        user += sizes.user_net_kb();
+    unsigned long ret = cpus * m_sizes.percpu_kb();
+    if (terms) {
+        std::ostringstream ss;
+        ss << "calibrate.conf: PERCPU * " << cpus << " (" << source << ")";
+        terms->add("percpu", ret, ss.str());
+    }
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+unsigned long RuntimeSize::user(unsigned long cpus, Breakdown *terms) const
+{
+    Configuration *config = Configuration::config();
+
+    unsigned long user = m_sizes.user_base_kb();
+    if (terms)
+        terms->add("user_base", m_sizes.user_base_kb(),
+                   "calibrate.conf: USER_BASE");
+    if (config->needsNetwork()) {
+        user += m_sizes.user_net_kb();
+        if (terms)
+            terms->add("user_net", m_sizes.user_net_kb(),
+                       "calibrate.conf: USER_NET");
+    }
 
     if (config->needsMakedumpfile()) {
         // Estimate bitmap size (1 bit for every RAM page)
-        unsigned long bitmapsz = shr_round_up(memtotal / sizes.pagesize(), 2);
+        unsigned long bitmapsz =
+            shr_round_up(m_memtotal / m_sizes.pagesize(), 2);
         if (bitmapsz > MAX_BITMAP_KB)
             bitmapsz = MAX_BITMAP_KB;
         Debug::debug()->dbg("Estimated bitmap size: %lu KiB", bitmapsz);
         user += bitmapsz;
 
         // Makedumpfile needs additional 96 B for every 128 MiB of RAM
-        user += 96 * shr_round_up(memtotal, 20 + 7);
+        unsigned long mdfmem = 96 * shr_round_up(m_memtotal, 20 + 7);
+        user += mdfmem;
+
+        if (terms) {
+            terms->add("bitmap", bitmapsz,
+                       "1 bit per RAM page, at most MAX_BITMAP_KB");
+            terms->add("makedumpfile", mdfmem, "96 B per 128 MiB of RAM");
+        }
+
+        // Each additional split process has its own bitmaps, each
+        // additional thread has its own page buffers
+        bool split;
+        unsigned long nworkers = workers(cpus, &split);
+        unsigned long worker_kb = split
+            ? SPLIT_PROCESS_KB + bitmapsz
+            : THREAD_PAGE_BUFFERS * m_sizes.pagesize() / 1024 +
+              THREAD_EXTRA_KB;
+        Debug::debug()->dbg("makedumpfile %s: %lu, %lu KiB each",
+                            split ? "processes" : "threads",
+                            nworkers, worker_kb);
+        user += (nworkers - 1) * worker_kb;
+
+        if (terms) {
+            std::ostringstream ss;
+            ss << (nworkers - 1) << (split
+                ? " extra --split processes (SPLIT_PROCESS_KB + bitmap)"
+                : " extra --num-threads threads (THREAD_PAGE_BUFFERS"
+                  " + THREAD_EXTRA_KB)");
+            terms->add("workers", (nworkers - 1) * worker_kb, ss.str());
+        }
     }
     Debug::debug()->dbg("Total userspace: %lu KiB", user);
-    required += user;
+    return user;
+}
+
+// -----------------------------------------------------------------------------
+unsigned long RuntimeSize::size(unsigned long cpus, Breakdown *terms) const
+{
+    unsigned long required, prev;
+    SizeConstants const &sizes = m_sizes;
+
+    Debug::debug()->trace("RuntimeSize::size(%lu)", cpus);
+
+    required = m_fixed;
+    if (terms)
+        terms->add(m_fixedTerms);
+
+    unsigned long percpusz = percpu(cpus, terms);
+    Debug::debug()->dbg("Total per-cpu requirements: %lu KiB", percpusz);
+    required += percpusz;
+
+    required += user(cpus, terms);
 
     // Make room for dirty pages and in-flight I/O:
     //
@@ -1159,18 +1342,25 @@ static unsigned long runtimeSize(SizeConstants const &sizes,
     dirty = (required - prev) * MB(1) / (MB(1) + BUF_PER_DIRTY_MB);
     Debug::debug()->dbg("Dirty pagecache: %lu KiB", dirty);
     Debug::debug()->dbg("In-flight I/O: %lu KiB", required - prev - dirty);
+    if (terms) {
+        terms->add("dirty", dirty, "DIRTY_RATIO % of total");
+        terms->add("inflight_io", required - prev - dirty,
+                   "BUF_PER_DIRTY_MB per dirty MiB");
+    }
 
     // Account for "large hashes"
     prev = required;
     required = required * MB(1024) / (MB(1024) - KERNEL_HASH_PER_MB);
     Debug::debug()->dbg("Large kernel hashes: %lu KiB", required - prev);
+    if (terms)
+        terms->add("hashes", required - prev, "KERNEL_HASH_PER_MB per MiB");
 
     // Add space for memmap
     prev = required;
 #if HAVE_FADUMP
-    if (config->KDUMP_FADUMP.value()) {
+    if (Configuration::config()->KDUMP_FADUMP.value()) {
         // FADUMP will map all memory
-        unsigned long maxpfn = memtotal / (sizes.pagesize() / 1024);
+        unsigned long maxpfn = m_memtotal / (sizes.pagesize() / 1024);
         required += shr_round_up(maxpfn * sizes.sizeof_page(), 10);
     } else {
 #endif
@@ -1181,11 +1371,37 @@ static unsigned long runtimeSize(SizeConstants const &sizes,
     }
 #endif
     Debug::debug()->dbg("Maximum memmap size: %lu KiB", required - prev);
+    if (terms)
+        terms->add("memmap", required - prev,
+                   "calibrate.conf: SIZEOFPAGE per PAGESIZE");
 
     Debug::debug()->dbg("Total run-time size: %lu KiB", required);
     return required;
 }
 
+//}}}
+//{{{ Calibrate ----------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+Calibrate::Calibrate()
+    : m_shrink(false), m_fit(0), m_json(false)
+{
+    Debug::debug()->trace("Calibrate::Calibrate()");
+
+    m_options.push_back(new FlagOption("shrink", 's', &m_shrink,
+        "Shrink the crash kernel reservation"));
+    m_options.push_back(new IntOption("fit", 'f', &m_fit,
+        "Recommend KDUMP_CPUS for a reservation of this size (MiB)"));
+    m_options.push_back(new FlagOption("json", 'j', &m_json,
+        "Print the result and its breakdown in JSON format"));
+}
+
+// -----------------------------------------------------------------------------
+const char *Calibrate::getName() const
+{
+    return "calibrate";
+}
+
 // -----------------------------------------------------------------------------
 static void shrink_crash_size(unsigned long size)
 {
@@ -1211,6 +1427,55 @@ static void shrink_crash_size(unsigned long size)
     close(fd);
 }
 
+// -----------------------------------------------------------------------------
+static unsigned long addReserve(unsigned long required, unsigned long bootsize,
+                                Breakdown *terms = nullptr)
+{
+    // Make sure there is enough space at boot
+    if (required < bootsize) {
+        if (terms)
+            terms->add("boot", bootsize - required,
+                       "calibrate.conf: boot-time requirements");
+        required = bootsize;
+    }
+
+    // Reserve a fixed percentage on top of the calculation
+    if (terms) {
+        terms->add("reserve_pct", required * ADD_RESERVE_PCT / 100,
+                   "ADD_RESERVE_PCT % of total");
+        terms->add("reserve", ADD_RESERVE_KB, "ADD_RESERVE_KB");
+    }
+    return (required * (100 + ADD_RESERVE_PCT)) / 100 + ADD_RESERVE_KB;
+}
+
+// -----------------------------------------------------------------------------
+static void printSizes(bool json, const unsigned long sizes[],
+                       bool fit, unsigned long cpus, const Breakdown &terms)
+{
+    static const char *const names[] = {
+        "Total", "Low", "High", "MinLow", "MaxLow", "MinHigh", "MaxHigh",
+        nullptr
+    };
+
+    if (!json) {
+        for (int i = 0; names[i]; ++i)
+            cout << names[i] << ": " << sizes[i] << endl;
+        if (fit)
+            cout << "CPUs: " << cpus << endl;
+        return;
+    }
+
+    cout << "{" << endl;
+    for (int i = 0; names[i]; ++i)
+        cout << "  " << jsonString(names[i]) << ": " << sizes[i]
+             << "," << endl;
+    if (fit)
+        cout << "  \"CPUs\": " << cpus << "," << endl;
+    cout << "  \"Breakdown\": ";
+    terms.writeJSON(cout);
+    cout << endl << "}" << endl;
+}
+
 // -----------------------------------------------------------------------------
 void Calibrate::execute()
 {
@@ -1222,13 +1487,10 @@ void Calibrate::execute()
     Debug::debug()->dbg("Guest variant: %s", hyper.guest_variant().c_str());
     if (hyper.type() == "xen" && hyper.guest_type() == "PV" &&
         hyper.guest_variant() == "DomU") {
-        cout << "Total: 0" << endl;
-        cout << "Low: 0" << endl;
-        cout << "High: 0" << endl;
-        cout << "MinLow: 0" << endl;
-        cout << "MaxLow: 0" << endl;
-        cout << "MinHigh: 0 " << endl;
-        cout << "MaxHigh: 0 " << endl;
+        static const unsigned long zero[7] = { 0 };
+        Breakdown terms;
+        terms.add("none", 0, "Xen PV DomU");
+        printSizes(m_json, zero, m_fit > 0, 0, terms);
         return;
     }
 
@@ -1248,20 +1510,22 @@ void Calibrate::execute()
         bootsize += sizes.kernel_init_net_kb() + sizes.initramfs_net_kb();
     Debug::debug()->dbg("Memory needed at boot: %lu KiB", bootsize);
 
+    std::unique_ptr<RuntimeSize> runtime;
+    Breakdown terms;
     try {
-        required = runtimeSize(sizes, memtotal);
-
-	// Make sure there is enough space at boot
-	if (required < bootsize)
-	    required = bootsize;
-
-        // Reserve a fixed percentage on top of the calculation
-        required = (required * (100 + ADD_RESERVE_PCT)) / 100 + ADD_RESERVE_KB;
-
+        Breakdown runtimeTerms;
+        runtime.reset(new RuntimeSize(sizes, memtotal));
+        required = runtime->size(config->KDUMP_CPUS.value(), &runtimeTerms);
+        required = addReserve(required, bootsize, &runtimeTerms);
+        terms.add(runtimeTerms);
     } catch(KError &e) {
 	Debug::debug()->info(e.what());
+	runtime.reset();
 	required = DEF_RESERVE_KB;
+	terms.add("default", DEF_RESERVE_KB,
+		  string("DEF_RESERVE_KB (") + e.what() + ")");
     }
+    unsigned long reserved = required;
 
     unsigned long low, minlow, maxlow;
     unsigned long high, minhigh, maxhigh;
@@ -1276,6 +1540,7 @@ void Calibrate::execute()
     if ((base + (required << 10)) >= (1ULL<<32)) {
 	Debug::debug()->dbg("Adding 64 MiB for SWIOTLB");
 	required += MB(64);
+	terms.add("swiotlb", MB(64), "crash area above 4 GiB");
     }
 
     if (base < (1ULL<<32)) {
@@ -1283,8 +1548,11 @@ void Calibrate::execute()
     } else {
         low = minlow = MINLOW_KB;
         required = (required > low ? required - low : 0);
-        if (required < bootsize)
+        if (required < bootsize) {
+            terms.add("boot_high", bootsize - required,
+                      "calibrate.conf: boot-time requirements (high)");
             required = bootsize;
+        }
     }
     high = required;
 
@@ -1321,8 +1589,11 @@ void Calibrate::execute()
             Debug::debug()->dbg("Minimum FADUMP size: %lu KiB", fadump_min);
         if (minlow < fadump_min)
             minlow = fadump_min;
-        if (required < minlow)
+        if (required < minlow) {
+            terms.add("fadump_min", minlow - required,
+                      "minimum FADUMP boot memory");
             required = minlow;
+        }
     }
 #endif
 
@@ -1340,13 +1611,41 @@ void Calibrate::execute()
 
 #endif  // __x86_64__
 
-    cout << "Total: " << (memtotal >> 10) << endl;
-    cout << "Low: " << shr_round_up(low, 10) << endl;
-    cout << "High: " << shr_round_up(high, 10) << endl;
-    cout << "MinLow: " << shr_round_up(minlow, 10) << endl;
-    cout << "MaxLow: " << (maxlow >> 10) << endl;
-    cout << "MinHigh: " << shr_round_up(minhigh, 10) << endl;
-    cout << "MaxHigh: " << (maxhigh >> 10) << endl;
+    // Find the highest KDUMP_CPUS which fits into the given size,
+    // keeping the architecture-specific additions computed above;
+    // zero means that not even one CPU fits
+    unsigned long fitcpus = 0;
+    if (m_fit > 0 && runtime) {
+        unsigned long extra = low + high > reserved
+            ? low + high - reserved
+            : 0;
+        unsigned long limit = MB((unsigned long)m_fit);
+        unsigned long maxcpus = runtime->syscpus();
+        while (fitcpus < maxcpus) {
+            unsigned long mid = (fitcpus + maxcpus + 1) / 2;
+            if (addReserve(runtime->size(mid), bootsize) + extra <= limit)
+                fitcpus = mid;
+            else
+                maxcpus = mid - 1;
+        }
+        Debug::debug()->dbg("Recommended KDUMP_CPUS for %d MiB: %lu",
+                            m_fit, fitcpus);
+        if (!fitcpus)
+            cerr << "Not even one CPU fits into " << m_fit << " MiB."
+                 << endl;
+    } else if (m_fit > 0)
+        cerr << "Cannot estimate the memory needed per CPU." << endl;
+
+    const unsigned long result[] = {
+        memtotal >> 10,
+        shr_round_up(low, 10),
+        shr_round_up(high, 10),
+        shr_round_up(minlow, 10),
+        maxlow >> 10,
+        shr_round_up(minhigh, 10),
+        maxhigh >> 10,
+    };
+    printSizes(m_json, result, m_fit > 0, fitcpus, terms);
 
     if (m_shrink)
         shrink_crash_size(required << 10);
@@ -30,6 +30,8 @@
 class Calibrate : public Subcommand {
     protected:
         bool m_shrink;
+        int m_fit;
+        bool m_json;
 
     public:
         /**
@@ -20,6 +20,12 @@
 #include <fstream>
 #include <sstream>
 #include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "configparser.h"
 #include "debug.h"
@@ -27,11 +33,16 @@
 #include "process.h"
 #include "quotedstring.h"
 #include "stringvector.h"
+#include "fileutil.h"
 
 using std::string;
 using std::ifstream;
+using std::istringstream;
 using std::stringstream;
 
+// First line of the cache file; bump the version if the format changes
+#define CACHE_SIGNATURE "# kdump config cache v1"
+
 //{{{ ConfigParser -------------------------------------------------------------
 
 // -----------------------------------------------------------------------------
@@ -59,6 +70,11 @@ string ConfigParser::getValue(const std::string &name) const
 
 //{{{ ShellConfigParser --------------------------------------------------------
 
+string ShellConfigParser::m_cacheFile(CONFIGPARSER_CACHE);
+bool ShellConfigParser::m_cacheLoaded;
+bool ShellConfigParser::m_cacheDirty;
+std::map<string, ShellConfigParser::Script> ShellConfigParser::m_cache;
+
 // -----------------------------------------------------------------------------
 ShellConfigParser::ShellConfigParser(const string &filename)
     : ConfigParser(filename)
@@ -72,6 +88,59 @@ void ShellConfigParser::parse()
     if (!fin)
         throw KSystemError("Cannot open config file " + m_configFile, errno);
 
+    struct stat st;
+    if (stat(m_configFile.c_str(), &st) != 0)
+        throw KSystemError("Cannot stat config file " + m_configFile, errno);
+
+    loadCache();
+    std::map<string, Script>::iterator it = m_cache.find(m_configFile);
+    bool cached = it != m_cache.end() &&
+        it->second.dev == (unsigned long long)st.st_dev &&
+        it->second.ino == (unsigned long long)st.st_ino &&
+        it->second.size == (unsigned long long)st.st_size &&
+        it->second.mtime_sec == st.st_mtim.tv_sec &&
+        it->second.mtime_nsec == st.st_mtim.tv_nsec;
+
+    string text;
+    if (cached) {
+        Debug::debug()->dbg("ShellConfigParser: %s found in cache",
+                            m_configFile.c_str());
+    } else {
+        stringstream ss;
+        ss << fin.rdbuf();
+        text = ss.str();
+
+        Script &script = m_cache[m_configFile];
+        script.dev = st.st_dev;
+        script.ino = st.st_ino;
+        script.size = st.st_size;
+        script.mtime_sec = st.st_mtim.tv_sec;
+        script.mtime_nsec = st.st_mtim.tv_nsec;
+        script.native = compile(text, script);
+        if (!script.native)
+            script.assignments.clear();
+        m_cacheDirty = true;
+
+        it = m_cache.find(m_configFile);
+    }
+
+    if (it->second.native && evaluate(it->second))
+        return;
+
+    if (cached) {
+        stringstream ss;
+        ss << fin.rdbuf();
+        text = ss.str();
+    }
+
+    Debug::debug()->dbg("ShellConfigParser: Parsing %s with /bin/sh",
+                        m_configFile.c_str());
+    parseShell(text);
+}
+
+// -----------------------------------------------------------------------------
+void ShellConfigParser::parseShell(const string &text)
+{
     // build the shell snippet
     stringstream shell;
     shell << "#!/bin/sh\n";
@@ -85,10 +154,9 @@ void ShellConfigParser::parse()
         shell << name << "=" << value.quoted() << "\n";
     }
 
-    shell << fin.rdbuf();
-    if (fin && !fin.tellg())
-        shell.clear(shell.rdstate() & ~shell.failbit);
-    fin.close();
+    shell << text;
+    if (!text.empty() && text[text.size() - 1] != '\n')
+        shell << '\n';
 
     for (StringStringMap::const_iterator it = m_variables.begin();
             it != m_variables.end(); ++it) {
@@ -124,6 +192,608 @@ void ShellConfigParser::parse()
     }
 }
 
+// -----------------------------------------------------------------------------
+static inline bool isNameStart(char c)
+{
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '_';
+}
+
+// -----------------------------------------------------------------------------
+static inline bool isNameChar(char c)
+{
+    return isNameStart(c) || (c >= '0' && c <= '9');
+}
+
+// -----------------------------------------------------------------------------
+static inline bool isBlank(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Compiler for the sysconfig subset of the shell language.
+ */
+class ShellConfigParser::Compiler {
+
+    public:
+        struct Unsupported {
+            size_t pos;
+            const char *what;
+        };
+
+        Compiler(const string &text)
+            : m_text(text), m_pos(0)
+        { }
+
+        /**
+         * Compile the next word of a simple command.
+         *
+         * @param[out] value the compiled word
+         * @return @c false at the end of the text
+         * @exception Unsupported if the text needs a real shell
+         */
+        bool nextWord(std::vector<Segment> &value);
+
+        /**
+         * Compile the next assignment.
+         *
+         * @param[out] assignment the compiled assignment
+         * @return @c false at the end of the text
+         * @exception Unsupported if the text needs a real shell
+         */
+        bool nextAssignment(Assignment &assignment);
+
+        /**
+         * Returns the line number of the current position.
+         */
+        unsigned long lineNumber() const
+        {
+            unsigned long line = 1;
+            for (size_t i = 0; i < m_pos && i < m_text.size(); ++i)
+                if (m_text[i] == '\n')
+                    ++line;
+            return line;
+        }
+
+    private:
+        const string &m_text;
+        size_t m_pos;
+
+        char peek(size_t off = 0) const
+        {
+            return m_pos + off < m_text.size() ? m_text[m_pos + off] : '\0';
+        }
+
+        bool atEnd() const
+        { return m_pos >= m_text.size(); }
+
+        void unsupported(const char *what)
+        {
+            Unsupported ex = { m_pos, what };
+            throw ex;
+        }
+
+        void literal(std::vector<Segment> &value, const string &text);
+        void dollar(std::vector<Segment> &value, bool quoted);
+        void doubleQuoted(std::vector<Segment> &value);
+        void word(std::vector<Segment> &value);
+};
+
+// -----------------------------------------------------------------------------
+void ShellConfigParser::Compiler::literal(std::vector<Segment> &value, const string &text)
+{
+    if (value.empty() || value.back().variable) {
+        value.resize(value.size() + 1);
+        value.back().variable = false;
+    }
+    value.back().text += text;
+}
+
+// -----------------------------------------------------------------------------
+void ShellConfigParser::Compiler::dollar(std::vector<Segment> &value, bool quoted)
+{
+    char c = peek(1);
+    size_t start, len;
+
+    if (isNameStart(c)) {
+        start = m_pos + 1;
+        for (len = 1; isNameChar(m_text[start + len]); ++len)
+            ;
+        m_pos = start + len;
+    } else if (c == '{') {
+        start = m_pos + 2;
+        for (len = 0; isNameChar(m_text[start + len]); ++len)
+            ;
+        if (!len || !isNameStart(m_text[start]) ||
+            m_text[start + len] != '}')
+            unsupported("parameter expansion");
+        m_pos = start + len + 1;
+    } else if (isBlank(c) || c == '\n' || c == '\0' || (quoted && c == '"')) {
+        // a lone dollar sign is taken literally
+        literal(value, "$");
+        ++m_pos;
+        return;
+    } else {
+        unsupported("special parameter or substitution");
+        return;
+    }
+
+    value.resize(value.size() + 1);
+    value.back().variable = true;
+    value.back().text.assign(m_text, start, len);
+}
+
+// -----------------------------------------------------------------------------
+void ShellConfigParser::Compiler::doubleQuoted(std::vector<Segment> &value)
+{
+    ++m_pos;                    // opening quote
+    for (;;) {
+        char c = peek();
+        if (atEnd())
+            unsupported("unterminated double quote");
+        else if (c == '"') {
+            ++m_pos;
+            return;
+        } else if (c == '\\') {
+            char next = peek(1);
+            if (next == '\n')
+                ;               // line continuation
+            else if (next == '$' || next == '`' || next == '"' ||
+                     next == '\\')
+                literal(value, string(1, next));
+            else {
+                literal(value, "\\");
+                ++m_pos;
+                continue;
+            }
+            m_pos += 2;
+        } else if (c == '$')
+            dollar(value, true);
+        else if (c == '`')
+            unsupported("command substitution");
+        else {
+            size_t end = m_text.find_first_of("\"\\$`", m_pos);
+            if (end == string::npos)
+                end = m_text.size();
+            literal(value, m_text.substr(m_pos, end - m_pos));
+            m_pos = end;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+void ShellConfigParser::Compiler::word(std::vector<Segment> &value)
+{
+    while (!atEnd()) {
+        char c = peek();
+        if (isBlank(c) || c == '\n' || c == ';')
+            return;
+
+        switch (c) {
+            case '\'': {
+                size_t end = m_text.find('\'', m_pos + 1);
+                if (end == string::npos)
+                    unsupported("unterminated single quote");
+                literal(value, m_text.substr(m_pos + 1, end - m_pos - 1));
+                m_pos = end + 1;
+                break;
+            }
+
+            case '"':
+                doubleQuoted(value);
+                break;
+
+            case '\\':
+                if (m_pos + 1 >= m_text.size())
+                    unsupported("backslash at end of file");
+                if (peek(1) != '\n')
+                    literal(value, string(1, peek(1)));
+                m_pos += 2;
+                break;
+
+            case '$':
+                dollar(value, false);
+                break;
+
+            case '`':
+                unsupported("command substitution");
+                break;
+
+            case '|': case '&': case '<': case '>': case '(': case ')':
+                unsupported("shell operator");
+                break;
+
+            case '~':
+                unsupported("tilde expansion");
+                break;
+
+            default:
+                literal(value, string(1, c));
+                ++m_pos;
+                break;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+bool ShellConfigParser::Compiler::nextWord(std::vector<Segment> &value)
+{
+    while (!atEnd()) {
+        char c = peek();
+        if (isBlank(c) || c == '\n')
+            ++m_pos;
+        else if (c == '\\' && peek(1) == '\n')
+            m_pos += 2;
+        else if (c == ';' || c == '#')
+            unsupported("shell command");
+        else
+            break;
+    }
+    if (atEnd())
+        return false;
+
+    value.clear();
+    word(value);
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+bool ShellConfigParser::Compiler::nextAssignment(Assignment &assignment)
+{
+    // skip blanks, empty commands, comments and line continuations
+    while (!atEnd()) {
+        char c = peek();
+        if (isBlank(c) || c == '\n' || c == ';')
+            ++m_pos;
+        else if (c == '\\' && peek(1) == '\n')
+            m_pos += 2;
+        else if (c == '#') {
+            m_pos = m_text.find('\n', m_pos);
+            if (m_pos == string::npos)
+                m_pos = m_text.size();
+        } else
+            break;
+    }
+    if (atEnd())
+        return false;
+
+    size_t start = m_pos;
+    if (!isNameStart(peek()))
+        unsupported("shell command");
+    while (isNameChar(peek()))
+        ++m_pos;
+    if (peek() != '=')
+        unsupported("shell command");
+
+    assignment.name.assign(m_text, start, m_pos - start);
+    if (assignment.name == "IFS")
+        unsupported("assignment to IFS");
+    assignment.value.clear();
+    ++m_pos;
+    word(assignment.value);
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+bool ShellConfigParser::compile(const string &text, Script &script)
+{
+    Compiler compiler(text);
+
+    script.assignments.clear();
+    try {
+        Assignment assignment;
+        while (compiler.nextAssignment(assignment))
+            script.assignments.push_back(assignment);
+    } catch (const Compiler::Unsupported &ex) {
+        Debug::debug()->dbg("ShellConfigParser: %s in line %lu",
+                            ex.what, compiler.lineNumber());
+        return false;
+    }
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+StringVector ShellConfigParser::splitWords(const string &text)
+{
+    Debug::debug()->trace("ShellConfigParser::splitWords(%s)", text.c_str());
+
+    StringVector words;
+
+    // unquoted glob characters would be expanded by the shell, but
+    // the compiler does not track quoting
+    if (text.find_first_of("*?[") == string::npos) {
+        Compiler compiler(text);
+        try {
+            std::vector<Segment> value;
+            while (compiler.nextWord(value)) {
+                string word;
+                std::vector<Segment>::const_iterator it;
+                for (it = value.begin(); it != value.end(); ++it) {
+                    if (it->variable) {
+                        Compiler::Unsupported ex = { 0, "variable" };
+                        throw ex;
+                    }
+                    word += it->text;
+                }
+                words.push_back(word);
+            }
+            return words;
+        } catch (const Compiler::Unsupported &ex) {
+            Debug::debug()->dbg("ShellConfigParser: %s in \"%s\"",
+                                ex.what, text.c_str());
+        }
+    }
+
+    // let the shell split the words and print them separated by NUL
+    stringstream shell;
+    shell << "set -- " << text << "\n"
+          << "printf '%s\\0' \"$@\"\n";
+    stringstream shelloutput;
+
+    ProcessFilter p;
+    p.setStdin(&shell);
+    p.setStdout(&shelloutput);
+    int ret = p.execute("/bin/sh", StringVector());
+    if (ret != 0)
+        throw KError("Cannot split \"" + text + "\" into words.");
+
+    words.clear();
+    string word;
+    while (getline(shelloutput, word, '\0'))
+        words.push_back(word);
+    return words;
+}
+
+// -----------------------------------------------------------------------------
+bool ShellConfigParser::evaluate(const Script &script)
+{
+    StringStringMap values(m_variables);
+
+    for (std::vector<Assignment>::const_iterator it =
+             script.assignments.begin();
+         it != script.assignments.end(); ++it) {
+        string value;
+        for (std::vector<Segment>::const_iterator seg = it->value.begin();
+             seg != it->value.end(); ++seg) {
+            if (!seg->variable) {
+                value += seg->text;
+                continue;
+            }
+
+            // variables which are not set in the file come from the
+            // environment, just like in the shell
+            StringStringMap::const_iterator var = values.find(seg->text);
+            if (var != values.end())
+                value += var->second;
+            else {
+                const char *env = getenv(seg->text.c_str());
+                if (env)
+                    value += env;
+            }
+        }
+        values[it->name] = value;
+    }
+
+    // the shell prints each variable with an unquoted echo, which splits
+    // the value into words and joins them with a single space
+    StringStringMap result;
+    for (StringStringMap::const_iterator it = m_variables.begin();
+            it != m_variables.end(); ++it) {
+        const string &value = values[it->first];
+
+        // pathname expansion and echo escape sequences are left to the
+        // shell, because the result depends on the file system or on the
+        // shell implementation
+        if (value.find_first_of("*?[\\") != string::npos) {
+            Debug::debug()->dbg("ShellConfigParser: %s needs a shell",
+                                it->first.c_str());
+            return false;
+        }
+
+        string &out = result[it->first];
+        string::size_type pos = value.find_first_not_of(" \t\n");
+        while (pos != string::npos) {
+            string::size_type end = value.find_first_of(" \t\n", pos);
+            if (!out.empty())
+                out += ' ';
+            out.append(value, pos, end == string::npos ? end : end - pos);
+            pos = value.find_first_not_of(" \t\n", end);
+        }
+
+        Debug::debug()->trace("ShellConfigParser: Setting %s to %s",
+            it->first.c_str(), out.c_str());
+    }
+
+    m_variables.swap(result);
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+void ShellConfigParser::setCacheFile(const string &path)
+{
+    m_cacheFile = path;
+    m_cacheLoaded = false;
+    m_cacheDirty = false;
+    m_cache.clear();
+}
+
+// -----------------------------------------------------------------------------
+void ShellConfigParser::flushCache()
+{
+    if (m_cacheDirty)
+        saveCache();
+    m_cacheDirty = false;
+}
+
+// -----------------------------------------------------------------------------
+static string escapeLiteral(const string &text)
+{
+    string ret;
+    for (string::const_iterator it = text.begin(); it != text.end(); ++it) {
+        if (*it == '\\')
+            ret += "\\\\";
+        else if (*it == '\t')
+            ret += "\\t";
+        else if (*it == '\n')
+            ret += "\\n";
+        else
+            ret += *it;
+    }
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+static bool unescapeLiteral(const string &text, string &ret)
+{
+    ret.clear();
+    for (string::size_type i = 0; i < text.size(); ++i) {
+        if (text[i] != '\\') {
+            ret += text[i];
+            continue;
+        }
+        if (++i >= text.size())
+            return false;
+        if (text[i] == 't')
+            ret += '\t';
+        else if (text[i] == 'n')
+            ret += '\n';
+        else
+            ret += text[i];
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+void ShellConfigParser::loadCache()
+{
+    if (m_cacheLoaded)
+        return;
+    m_cacheLoaded = true;
+
+    if (m_cacheFile.empty())
+        return;
+
+    Debug::debug()->trace("ShellConfigParser::loadCache(): %s",
+                          m_cacheFile.c_str());
+
+    ifstream fin(m_cacheFile.c_str());
+    if (!fin)
+        return;
+
+    string line;
+    if (!getline(fin, line) || line != CACHE_SIGNATURE) {
+        Debug::debug()->dbg("Ignoring %s: unknown format",
+                            m_cacheFile.c_str());
+        return;
+    }
+
+    // Each file starts with a line of the form:
+    //   dev ino size mtime_sec mtime_nsec count path
+    // where count is -1 if the file needs a shell. It is followed by
+    // count assignment lines:
+    //   name TAB segment TAB segment ...
+    // where a segment is "$name" for a variable or "=text" for literal
+    // text with backslash, tab and newline escaped
+    while (getline(fin, line)) {
+        istringstream ss(line);
+        Script script;
+        long count;
+        string path;
+
+        ss >> script.dev >> script.ino >> script.size
+           >> script.mtime_sec >> script.mtime_nsec >> count;
+        if (!ss || ss.get() != ' ' || !getline(ss, path) || path.empty() ||
+            count < -1) {
+            Debug::debug()->dbg("Ignoring malformed cache line: %s",
+                                line.c_str());
+            continue;
+        }
+
+        script.native = (count >= 0);
+        bool valid = true;
+        for (long i = 0; i < count && valid; ++i) {
+            if (!getline(fin, line)) {
+                valid = false;
+                break;
+            }
+
+            Assignment assignment;
+            string::size_type pos = line.find('\t');
+            assignment.name = line.substr(0, pos);
+            while (pos != string::npos) {
+                string::size_type end = line.find('\t', pos + 1);
+                string field = line.substr(pos + 1, end == string::npos
+                                           ? end : end - pos - 1);
+                Segment seg;
+                if (field.empty() || (field[0] != '$' && field[0] != '=')) {
+                    valid = false;
+                    break;
+                }
+                seg.variable = (field[0] == '$');
+                if (seg.variable)
+                    seg.text = field.substr(1);
+                else if (!unescapeLiteral(field.substr(1), seg.text)) {
+                    valid = false;
+                    break;
+                }
+                assignment.value.push_back(seg);
+                pos = end;
+            }
+            script.assignments.push_back(assignment);
+        }
+
+        if (!valid) {
+            Debug::debug()->dbg("Ignoring malformed cache entry for %s",
+                                path.c_str());
+            continue;
+        }
+        m_cache[path] = script;
+    }
+}
+
+// -----------------------------------------------------------------------------
+void ShellConfigParser::saveCache()
+{
+    if (m_cacheFile.empty())
+        return;
+
+    Debug::debug()->trace("ShellConfigParser::saveCache(): %s",
+                          m_cacheFile.c_str());
+
+    std::ostringstream out;
+    out << CACHE_SIGNATURE << '\n';
+    for (std::map<string, Script>::const_iterator it = m_cache.begin();
+         it != m_cache.end(); ++it) {
+        const Script &s = it->second;
+
+        if (!FilePath(it->first).exists())
+            continue;
+
+        out << s.dev << ' ' << s.ino << ' ' << s.size << ' '
+            << s.mtime_sec << ' ' << s.mtime_nsec << ' '
+            << (s.native ? long(s.assignments.size()) : -1L) << ' '
+            << it->first << '\n';
+        for (std::vector<Assignment>::const_iterator a =
+                 s.assignments.begin();
+             a != s.assignments.end(); ++a) {
+            out << a->name;
+            for (std::vector<Segment>::const_iterator seg =
+                     a->value.begin();
+                 seg != a->value.end(); ++seg) {
+                if (seg->variable)
+                    out << "\t$" << seg->text;
+                else
+                    out << "\t=" << escapeLiteral(seg->text);
+            }
+            out << '\n';
+        }
+    }
+
+    FileUtil::saveCacheFile(m_cacheFile, out.str());
+}
+
 //}}}
 
 // vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
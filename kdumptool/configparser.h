@@ -19,9 +19,17 @@
 #ifndef CONFIGPARSER_H
 #define CONFIGPARSER_H
 
+#include <map>
 #include <string>
+#include <vector>
 
 #include "global.h"
+#include "stringvector.h"
+
+/**
+ * Default location of the persistent cache of compiled sysconfig files.
+ */
+#define CONFIGPARSER_CACHE DEFAULT_CACHE_DIR "/config"
 
 //{{{ ConfigParser -------------------------------------------------------------
 
@@ -95,12 +103,23 @@ class ConfigParser {
 //{{{ ShellConfigParser --------------------------------------------------------
 
 /**
- * This configuration parser is shell based. This means, it sources the
- * configuration in a shell (/bin/sh), and prints the evaluated value from
- * that shell. This output is parsed.
+ * Parser for shell-style configuration files such as /etc/sysconfig/kdump.
  *
- * This mechanism is necessary for the /etc/sysconfig files to be parsed
+ * The result is the same as if the configuration were sourced by a
+ * shell (/bin/sh) and each variable printed with an unquoted echo. This
+ * mechanism is necessary for the /etc/sysconfig files to be parsed
  * according to the standard.
+ *
+ * The subset actually used in sysconfig files (assignments, single and
+ * double quotes, backslash escapes, $VAR and ${VAR} expansion, comments)
+ * is handled natively. Only if the file contains other constructs, e.g.
+ * command substitution or shell commands, is the file run through a
+ * shell.
+ *
+ * The compiled form of a file is kept in a persistent cache, keyed by
+ * the path and validated against the device, inode, size and
+ * modification time of the file. New entries are written by
+ * flushCache(). The cache is best-effort.
  */
 class ShellConfigParser : public ConfigParser {
 
@@ -122,6 +141,107 @@ class ShellConfigParser : public ConfigParser {
          *            shell that actually parses the configuration file fails
          */
         virtual void parse();
+
+        /**
+         * Set the location of the persistent cache. An empty path
+         * disables the persistent cache.
+         *
+         * @param[in] path path to the cache file
+         */
+        static void setCacheFile(const std::string &path);
+
+        /**
+         * Write the persistent cache if any entries have been added.
+         */
+        static void flushCache();
+
+        /**
+         * Split a string into words like the shell splits the arguments
+         * of a simple command, i.e. with quote removal. Quotes and
+         * backslashes are handled natively; if the string contains
+         * expansions, it is split by /bin/sh.
+         *
+         * @param[in] text the words, possibly quoted
+         * @return the words
+         * @exception KError if the shell cannot split the text
+         */
+        static StringVector splitWords(const std::string &text);
+
+    protected:
+        /**
+         * Part of an assignment value: literal text or the name of
+         * a variable which is expanded.
+         */
+        struct Segment {
+            bool variable;
+            std::string text;
+        };
+
+        /**
+         * Compiled variable assignment.
+         */
+        struct Assignment {
+            std::string name;
+            std::vector<Segment> value;
+        };
+
+        /**
+         * Compiled configuration file.
+         */
+        struct Script {
+            unsigned long long dev, ino, size;
+            long long mtime_sec, mtime_nsec;
+            bool native;
+            std::vector<Assignment> assignments;
+        };
+
+        class Compiler;
+
+        /**
+         * Compile a configuration file.
+         *
+         * @param[in]  text the contents of the file
+         * @param[out] script the compiled assignments
+         * @return @c true on success, @c false if the file contains
+         *         constructs which need a real shell
+         */
+        static bool compile(const std::string &text, Script &script);
+
+        /**
+         * Set the variables from a compiled configuration file.
+         *
+         * @param[in] script the compiled assignments
+         * @return @c true on success, @c false if the shell would
+         *         modify a value when printing it (globbing or escape
+         *         sequences); no variable is changed in that case
+         */
+        bool evaluate(const Script &script);
+
+        /**
+         * Source the configuration file in /bin/sh and read back the
+         * variables.
+         *
+         * @param[in] text the contents of the file
+         * @exception KError if spawning the shell fails
+         */
+        void parseShell(const std::string &text);
+
+        /**
+         * Load the cache file (once per process).
+         */
+        static void loadCache();
+
+        /**
+         * Write the cache file, replacing the old one atomically.
+         * Entries for files which no longer exist are dropped.
+         */
+        static void saveCache();
+
+    private:
+        static std::string m_cacheFile;
+        static bool m_cacheLoaded;
+        static bool m_cacheDirty;
+        static std::map<std::string, Script> m_cache;
 };
 
 //}}}
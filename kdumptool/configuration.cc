@@ -166,8 +166,14 @@ bool Configuration::needsMakedumpfile()
     if (KDUMP_DUMPLEVEL.value() != 0)
 	return true;
 
-    return strcasecmp(KDUMP_DUMPFORMAT.value().c_str(), "none") != 0 &&
-	strcasecmp(KDUMP_DUMPFORMAT.value().c_str(), "elf") != 0;
+    if (strcasecmp(KDUMP_DUMPFORMAT.value().c_str(), "none") == 0)
+	return false;
+
+    // the dump level is raised if the dump does not fit on the target
+    if (!kdumptoolContainsFlag("FIXEDLEVEL"))
+	return true;
+
+    return strcasecmp(KDUMP_DUMPFORMAT.value().c_str(), "elf") != 0;
 }
 
 
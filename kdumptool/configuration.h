@@ -297,6 +297,8 @@ class Configuration {
 
 	/*
 	 * Checks whether this configuration needs makedumpfile.
+	 * Without the FIXEDLEVEL flag, any dump may need it, because
+	 * the dump level can be raised when the dump does not fit.
 	 *
 	 * @return @c false if vmcore can be simply copied, and @c false
 	 *         if makedumpfile is needed to do the filtering
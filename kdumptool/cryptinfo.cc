@@ -0,0 +1,249 @@
+/*
+ * (c) 2026, SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+#include <endian.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "global.h"
+#include "debug.h"
+#include "cryptinfo.h"
+#include "fileutil.h"
+#include "process.h"
+#include "stringutil.h"
+#include "stringvector.h"
+
+using std::string;
+
+// Binary LUKS header; only the fields that are common to LUKS1 and
+// LUKS2, or specific to LUKS2, are used
+#define LUKS_MAGIC		"LUKS\xba\xbe"
+#define LUKS_MAGIC_L		6
+#define LUKS_UUID_L		40
+#define LUKS2_CSUM_L		64
+#define LUKS2_HDR_BIN_LEN	4096
+
+// Valid LUKS2 header sizes are powers of two between these values
+#define LUKS2_HDR_MIN		(16UL << 10)
+#define LUKS2_HDR_MAX		(4UL << 20)
+
+struct luks2_hdr_disk {
+    char	magic[LUKS_MAGIC_L];
+    uint16_t	version;
+    uint64_t	hdr_size;
+    uint64_t	seqid;
+    char	label[48];
+    char	checksum_alg[32];
+    uint8_t	salt[64];
+    char	uuid[LUKS_UUID_L];
+    char	subsystem[48];
+    uint64_t	hdr_offset;
+    char	_padding[184];
+    uint8_t	csum[LUKS2_CSUM_L];
+    char	_padding4096[7 * 512];
+} __attribute__((packed));
+
+//{{{ CryptInfo ----------------------------------------------------------------
+
+std::map<string, unsigned long> CryptInfo::m_cache;
+
+// -----------------------------------------------------------------------------
+static void read_full(int fd, void *buf, size_t len, off_t off)
+{
+    char *p = static_cast<char *>(buf);
+    while (len) {
+        ssize_t ret = pread(fd, p, len, off);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            throw KSystemError("Cannot read LUKS header", errno);
+        }
+        if (ret == 0)
+            throw KError("LUKS header is truncated");
+        p += ret;
+        len -= ret;
+        off += ret;
+    }
+}
+
+// -----------------------------------------------------------------------------
+CryptInfo::CryptInfo(std::string const& device)
+    : m_memory(0)
+{
+    Debug::debug()->trace("CryptInfo::CryptInfo(%s)", device.c_str());
+
+    FileDescriptor fd(device, O_RDONLY | O_CLOEXEC);
+    string key;
+    size_t jsonlen;
+    unsigned version = readHeader(fd, key, jsonlen);
+
+    // the (possibly large) JSON area is read only on a cache miss
+    std::map<string, unsigned long>::const_iterator it = m_cache.find(key);
+    if (it != m_cache.end()) {
+        m_memory = it->second;
+        Debug::debug()->dbg("Crypto device %s needs %lu KiB (cached)",
+                            device.c_str(), m_memory);
+        return;
+    }
+
+    switch (version) {
+    case 1:
+        // LUKS1 only supports PBKDF2, which needs no extra memory
+        break;
+    case 2:
+        m_memory = parseJSON(readJSON(fd, jsonlen));
+        break;
+    default:
+        readDump(device);
+        break;
+    }
+    Debug::debug()->dbg("Crypto device %s needs %lu KiB",
+                        device.c_str(), m_memory);
+
+    m_cache[key] = m_memory;
+}
+
+// -----------------------------------------------------------------------------
+unsigned CryptInfo::readHeader(int fd, string &key, size_t &jsonlen)
+{
+    struct luks2_hdr_disk hdr;
+
+    read_full(fd, &hdr, sizeof hdr, 0);
+    if (memcmp(hdr.magic, LUKS_MAGIC, LUKS_MAGIC_L) != 0)
+        throw KError("No LUKS header found");
+
+    unsigned version = be16toh(hdr.version);
+    key.assign(hdr.uuid, strnlen(hdr.uuid, LUKS_UUID_L));
+    if (version != 2) {
+        // the version must be part of the key, because the checksum
+        // field is used only by LUKS2
+        key += ":v" + StringUtil::number2string(version);
+        return version == 1 ? version : 0;
+    }
+
+    static const char hexdigits[] = "0123456789abcdef";
+    key.push_back(':');
+    for (int i = 0; i < LUKS2_CSUM_L; ++i) {
+        key.push_back(hexdigits[hdr.csum[i] >> 4]);
+        key.push_back(hexdigits[hdr.csum[i] & 0x0f]);
+    }
+
+    uint64_t hdr_size = be64toh(hdr.hdr_size);
+    if (hdr_size < LUKS2_HDR_MIN || hdr_size > LUKS2_HDR_MAX ||
+        (hdr_size & (hdr_size - 1)))
+        throw KError("Invalid LUKS2 header size");
+    jsonlen = hdr_size - LUKS2_HDR_BIN_LEN;
+
+    return version;
+}
+
+// -----------------------------------------------------------------------------
+string CryptInfo::readJSON(int fd, size_t jsonlen)
+{
+    string json(jsonlen, '\0');
+    read_full(fd, &json[0], json.size(), LUKS2_HDR_BIN_LEN);
+    json.resize(strnlen(json.c_str(), json.size()));
+    return json;
+}
+
+// -----------------------------------------------------------------------------
+unsigned long CryptInfo::parseJSON(std::string const& json)
+{
+    static const char ws[] = " \t\r\n";
+    unsigned long ret = 0;
+    string::size_type pos = 0;
+
+    // No need for a complete JSON parser; LUKS2 uses the "memory" key
+    // only for the memory cost of a keyslot KDF, so look for that key
+    // outside string values
+    while ( (pos = json.find('"', pos)) != string::npos) {
+        string str;
+        while (++pos < json.length() && json[pos] != '"') {
+            if (json[pos] == '\\' && ++pos >= json.length())
+                break;
+            str.push_back(json[pos]);
+        }
+        if (pos >= json.length())
+            throw KError("Unterminated string in LUKS2 metadata");
+        ++pos;
+
+        if (str != "memory")
+            continue;
+        string::size_type next = json.find_first_not_of(ws, pos);
+        if (next == string::npos || json[next] != ':')
+            continue;
+        next = json.find_first_not_of(ws, next + 1);
+        pos = json.find_first_not_of("0123456789", next);
+        if (next == string::npos || pos == next)
+            throw KError("Invalid memory cost in LUKS2 metadata");
+
+        unsigned long memory = strtoul(json.c_str() + next, NULL, 10);
+        if (memory > ret)
+            ret = memory;
+    }
+
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+void CryptInfo::readDump(std::string const& device)
+{
+    Debug::debug()->trace("CryptInfo::readDump(%s)", device.c_str());
+
+    ProcessFilter p;
+
+    StringVector args;
+    args.push_back("luksDump");
+    args.push_back(device);
+
+    std::ostringstream stdoutStream, stderrStream;
+    p.setStdout(&stdoutStream);
+    p.setStderr(&stderrStream);
+    int ret = p.execute("cryptsetup", args);
+    if (ret != 0) {
+        KString error = stderrStream.str();
+        throw KError("cryptsetup failed: " + error.trim());
+    }
+
+    KString out = stdoutStream.str();
+    size_t pos = 0;
+    while (pos < out.length()) {
+        size_t end = out.find_first_of("\r\n", pos);
+        size_t sep = out.find(':', pos);
+        if (sep < end) {
+            KString key = out.substr(pos, sep - pos);
+            if (key.trim() == "Memory") {
+                KString val = out.substr(sep + 1, end - sep - 1);
+                unsigned long memory = val.trim().asLongLong();
+                if (memory > m_memory)
+                    m_memory = memory;
+            }
+        }
+        pos = out.find_first_not_of("\r\n", end);
+    }
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
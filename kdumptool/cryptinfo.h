@@ -0,0 +1,108 @@
+/*
+ * (c) 2026, SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#ifndef CRYPTINFO_H
+#define CRYPTINFO_H
+
+#include <map>
+#include <string>
+
+#include "global.h"
+
+//{{{ CryptInfo ----------------------------------------------------------------
+
+/**
+ * Given a LUKS crypto device, read its header and find the maximum
+ * memory requirements of its key slots.
+ *
+ * LUKS1 and LUKS2 headers are parsed directly. Other versions are
+ * handled by parsing the output of 'cryptsetup luksDump'. Results are
+ * cached by the header UUID and checksum, so a device which is seen
+ * more than once (e.g. through different paths) is parsed only once.
+ */
+class CryptInfo {
+        unsigned long m_memory;
+
+    public:
+        /**
+         * Probe a LUKS device.
+         *
+         * @param[in] device path to the block device (or header file)
+         *
+         * @exception KError if the header cannot be read or parsed
+         */
+        CryptInfo(std::string const& device);
+
+	/**
+	 * Get memory requirements.
+	 *
+	 * @return Maximum memory in KiB needed to open the device
+	 */
+        unsigned long memory(void) const
+        { return m_memory; }
+
+    protected:
+        /**
+         * Read the binary header.
+         *
+         * @param[in]  fd      open file descriptor of the device
+         * @param[out] key     cache key (UUID and header checksum)
+         * @param[out] jsonlen size of the JSON metadata area (LUKS2 only)
+         * @return LUKS version, or zero if the version is unknown
+         *
+         * @exception KError if this is not a LUKS device
+         */
+        unsigned readHeader(int fd, std::string &key, size_t &jsonlen);
+
+        /**
+         * Read the LUKS2 JSON metadata area, which follows the binary
+         * header.
+         *
+         * @param[in] fd      open file descriptor of the device
+         * @param[in] jsonlen size of the JSON area (from readHeader())
+         * @return JSON metadata without the trailing padding
+         */
+        std::string readJSON(int fd, size_t jsonlen);
+
+        /**
+         * Parse the output of 'cryptsetup luksDump'.
+         *
+         * @param[in] device path to the block device
+         */
+        void readDump(std::string const& device);
+
+    public:
+        /**
+         * Find the maximum "memory" value in LUKS2 JSON metadata.
+         *
+         * @param[in] json LUKS2 JSON metadata
+         * @return maximum memory cost of all keyslots [KiB]
+         *
+         * @exception KError if the JSON metadata is malformed
+         */
+        static unsigned long parseJSON(std::string const& json);
+
+    private:
+        static std::map<std::string, unsigned long> m_cache;
+};
+
+//}}}
+
+#endif /* CRYPTINFO_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -22,6 +22,7 @@
 #include <cerrno>
 #include <algorithm>
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 #include "dataprovider.h"
@@ -30,6 +31,8 @@
 #include "debug.h"
 #include "stringutil.h"
 #include "fileutil.h"
+#include "process.h"
+#include "multiplexio.h"
 
 using std::fopen;
 using std::fread;
@@ -175,9 +178,17 @@ void FileDataProvider::finish()
 
 // -----------------------------------------------------------------------------
 BufferDataProvider::BufferDataProvider(const char *data, size_t size)
-    : m_data(data), m_size(size)
+    : m_start(data), m_total(size), m_data(data), m_size(size)
 {}
 
+// -----------------------------------------------------------------------------
+void BufferDataProvider::prepare()
+{
+    m_data = m_start;
+    m_size = m_total;
+    AbstractDataProvider::prepare();
+}
+
 // -----------------------------------------------------------------------------
 size_t BufferDataProvider::getData(char *buffer, size_t maxread)
 {
@@ -198,13 +209,118 @@ size_t BufferDataProvider::getData(char *buffer, size_t maxread)
 //{{{ ProcessDataProvider ------------------------------------------------------
 
 // -----------------------------------------------------------------------------
-ProcessDataProvider::ProcessDataProvider(const char *pipe_cmdline,
-                                         const char *direct_cmdline)
-    : m_pipeCmdline(pipe_cmdline), m_directCmdline(direct_cmdline),
-      m_processFile(NULL)
+ProcessDataProvider::ProcessDataProvider(const StringVector &pipe_args,
+                                         const StringVector &direct_args)
+    : m_pipeArgs(pipe_args), m_directArgs(direct_args)
 {
     Debug::debug()->trace("ProcessDataProvider::ProcessDataProvider(%s, %s)",
-        pipe_cmdline, direct_cmdline);
+        pipe_args.join(' ').c_str(), direct_args.join(' ').c_str());
+}
+
+// -----------------------------------------------------------------------------
+ProcessDataProvider::~ProcessDataProvider()
+{
+    // SubProcess kills a running child
+}
+
+// -----------------------------------------------------------------------------
+void ProcessDataProvider::spawn(const StringVector &args, bool pipeStdout)
+{
+    m_process.reset(new SubProcess());
+    m_io.reset(new MultiplexIO());
+    m_errorOutput.clear();
+    m_errorLine.clear();
+    m_lastError.clear();
+
+    m_stdout.reset();
+    if (pipeStdout) {
+        m_stdout.reset(new OArea(STDOUT_FILENO));
+        m_stdout->setupSubProcess(*m_process);
+    }
+    m_stderr.reset(new OBuffer(STDERR_FILENO, &m_errorOutput));
+    m_stderr->setupSubProcess(*m_process);
+
+    StringVector::const_iterator first = args.begin();
+    m_process->spawn(*first, StringVector(first + 1, args.end()));
+
+    if (m_stdout)
+        m_stdout->setupIO(*m_io);
+    m_stderr->setupIO(*m_io);
+}
+
+// -----------------------------------------------------------------------------
+void ProcessDataProvider::handleStderr()
+{
+    m_stderr->handleEvents(*m_io);
+
+    // without a progress notifier, makedumpfile can draw its own
+    if (!getProgress())
+        fwrite(m_errorOutput.data(), 1, m_errorOutput.size(), stderr);
+
+    // progress lines end with a carriage return
+    for (char c : m_errorOutput) {
+        if (c == '\r' || c == '\n') {
+            handleStderrLine(m_errorLine);
+            m_errorLine.clear();
+        } else
+            m_errorLine += c;
+    }
+    m_errorOutput.clear();
+
+    if (!m_stderr->isOpen() && !m_errorLine.empty()) {
+        handleStderrLine(m_errorLine);
+        m_errorLine.clear();
+    }
+}
+
+// -----------------------------------------------------------------------------
+void ProcessDataProvider::handleStderrLine(const string &line)
+{
+    if (line.empty())
+        return;
+
+    // e.g. "Copying data                      : [ 42.0 %] |  eta: 3s"
+    string::size_type start = line.find('[');
+    string::size_type end = line.find("%]", start);
+    if (start != string::npos && end != string::npos) {
+        Progress *p = getProgress();
+        if (p && line.compare(0, 12, "Copying data") == 0) {
+            double percent = strtod(line.c_str() + start + 1, NULL);
+            p->progressed((unsigned long long)(percent * 10), 1000);
+        }
+        return;
+    }
+
+    if (getProgress())
+        fprintf(stderr, "%s\n", line.c_str());
+    m_lastError = line;
+}
+
+// -----------------------------------------------------------------------------
+void ProcessDataProvider::wait(const StringVector &args)
+{
+    // collect the remaining error output
+    while (m_stderr->isOpen()) {
+        m_io->monitor();
+        handleStderr();
+    }
+
+    int status = m_process->wait();
+    m_process.reset();
+    m_io.reset();
+    m_stdout.reset();
+    m_stderr.reset();
+
+    if (WIFSIGNALED(status))
+        throw KError(args.front() + " killed by signal " +
+            StringUtil::number2string(WTERMSIG(status)) + ".");
+    if (WEXITSTATUS(status) != 0) {
+        string msg = args.front() + " failed (" +
+            StringUtil::number2string(WEXITSTATUS(status)) + ")";
+        if (!m_lastError.empty())
+            msg += ": " + m_lastError;
+        throw KError(msg + ".");
+    }
 }
 
 // -----------------------------------------------------------------------------
@@ -212,25 +328,33 @@ void ProcessDataProvider::prepare()
 {
     Debug::debug()->trace("ProcessDataProvider::prepare");
 
-    m_processFile = popen(m_pipeCmdline.c_str(), "r");
-    if (!m_processFile)
-        throw KSystemError("Could not start process " + m_pipeCmdline, errno);
+    spawn(m_pipeArgs, true);
+    AbstractDataProvider::prepare();
 }
 
 // -----------------------------------------------------------------------------
 size_t ProcessDataProvider::getData(char *buffer, size_t maxread)
 {
-    if (!m_processFile)
-        throw KError("Process " + m_pipeCmdline + " not started.");
-
-    errno = 0;
-    size_t ret = fread(buffer, 1, maxread, m_processFile);
-    if (ret == 0 && errno != 0) {
-        setError(true);
-        throw KSystemError("Error reading from " + m_pipeCmdline, errno);
+    if (!m_process)
+        throw KError("Process " + m_pipeArgs.front() + " not started.");
+
+    // read directly into the caller's buffer
+    m_stdout->setArea(buffer, maxread);
+    while (m_stdout->isOpen()) {
+        m_io->monitor();
+        handleStderr();
+
+        try {
+            m_stdout->handleEvents(*m_io);
+        } catch (const KError &) {
+            setError(true);
+            throw;
+        }
+        if (m_stdout->filled())
+            return m_stdout->filled();
     }
 
-    return ret;
+    return 0;
 }
 
 // -----------------------------------------------------------------------------
@@ -238,12 +362,21 @@ void ProcessDataProvider::finish()
 {
     Debug::debug()->trace("ProcessDataProvider::finish");
 
-    int err = pclose(m_processFile);
-    m_processFile = NULL;
+    if (!m_process)
+        return;
 
-    if (WEXITSTATUS(err) != 0)
-        throw KError(m_pipeCmdline + " failed (" +
-            StringUtil::number2string(WEXITSTATUS(err)) +").");
+    // a reader may stop early; do not leave the child blocked on the pipe
+    if (m_stdout)
+        m_stdout->close(*m_io);
+
+    try {
+        wait(m_pipeArgs);
+    } catch (...) {
+        setError(true);
+        AbstractDataProvider::finish();
+        throw;
+    }
+    AbstractDataProvider::finish();
 }
 
 // -----------------------------------------------------------------------------
@@ -258,19 +391,21 @@ void ProcessDataProvider::saveToFile(const StringVector &targets)
     Debug::debug()->trace("ProcessDataProvider::saveToFile([ \"%s\"%s ])",
 	targets.front().c_str(), targets.size() > 1 ? ", ...": "");
 
-    string cmdline = m_directCmdline;
-    StringVector::const_iterator it;
-    for (it = targets.begin(); it != targets.end(); ++it) {
-	cmdline += ' ';
-	cmdline += *it;
-    }
+    StringVector args = m_directArgs;
+    args.insert(args.end(), targets.begin(), targets.end());
 
-    Debug::debug()->trace("Executing '%s'", cmdline.c_str());
+    Debug::debug()->trace("Executing '%s'", args.join(' ').c_str());
 
-    int err = system(cmdline.c_str());
-    if (WEXITSTATUS(err) != 0)
-        throw KError("Running " + m_directCmdline + " failed (" +
-            StringUtil::number2string(WEXITSTATUS(err)) +").");
+    spawn(args, false);
+    AbstractDataProvider::prepare();
+    try {
+        wait(args);
+    } catch (...) {
+        setError(true);
+        AbstractDataProvider::finish();
+        throw;
+    }
+    AbstractDataProvider::finish();
 }
 
 //}}}
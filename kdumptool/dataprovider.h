@@ -21,12 +21,17 @@
 
 #include <cstdio>
 #include <cstdarg>
+#include <memory>
 
 #include "global.h"
 #include "rootdirurl.h"
 #include "stringvector.h"
 
 class Progress;
+class SubProcess;
+class OArea;
+class OBuffer;
+class MultiplexIO;
 
 //{{{ DataProvider -------------------------------------------------------------
 
@@ -252,6 +257,14 @@ class BufferDataProvider : public AbstractDataProvider {
          */
         BufferDataProvider(const char *data, size_t size);
 
+        /**
+         * Rewinds to the start of the buffer, so the data can be
+         * transferred again.
+         *
+         * @see DataProvider::prepare()
+         */
+        void prepare();
+
         /**
          * Provides the data.
          *
@@ -260,6 +273,8 @@ class BufferDataProvider : public AbstractDataProvider {
         size_t getData(char *buffer, size_t maxread);
 
     private:
+        const char *m_start;
+        size_t m_total;
         const char *m_data;
         size_t m_size;
 };
@@ -269,21 +284,33 @@ class BufferDataProvider : public AbstractDataProvider {
 
 /**
  * ProcessDataProvider is a DataProvider that gets the data from stdout from
- * a process. It does not make sense to set a Progress notifier for that type
- * of DataProvider because we don't know when the data stream ends.
+ * a process. The process is executed directly (without a shell).
+ *
+ * The standard error output of the process is captured. If a Progress
+ * notifier is set, progress lines of makedumpfile ("Copying data : [ 42.0 %]")
+ * are translated into progress notifications and all other lines are
+ * passed to stderr. Without a notifier, stderr is passed unchanged.
  */
 class ProcessDataProvider : public AbstractDataProvider {
 
     public:
 
         /**
-         * Creates a new BufferDataProvider object.
+         * Creates a new ProcessDataProvider object.
          *
-         * @param[in] data the buffer
-         * @param[in] add_cmdline additional parameters when the
-         *            ProcessDataProvider::saveToFile() shortcut is used
+         * @param[in] pipe_args the program and its arguments when the data
+         *            is read from stdout
+         * @param[in] direct_args the program and its arguments when the
+         *            ProcessDataProvider::saveToFile() shortcut is used;
+         *            the target files are appended
+         */
+        ProcessDataProvider(const StringVector &pipe_args,
+                            const StringVector &direct_args);
+
+        /**
+         * Kills the process if it is still running.
          */
-        ProcessDataProvider(const char *cmdline, const char *add_cmdline="");
+        ~ProcessDataProvider();
 
         /**
          * Returns @c true.
@@ -322,10 +349,22 @@ class ProcessDataProvider : public AbstractDataProvider {
          */
         virtual void finish();
 
+    protected:
+        void spawn(const StringVector &args, bool pipeStdout);
+        void handleStderr();
+        void handleStderrLine(const std::string &line);
+        void wait(const StringVector &args);
+
     private:
-        std::string m_pipeCmdline;
-        std::string m_directCmdline;
-        FILE *m_processFile;
+        StringVector m_pipeArgs;
+        StringVector m_directArgs;
+        std::unique_ptr<SubProcess> m_process;
+        std::unique_ptr<OArea> m_stdout;
+        std::unique_ptr<OBuffer> m_stderr;
+        std::unique_ptr<MultiplexIO> m_io;
+        std::string m_errorOutput;
+        std::string m_errorLine;
+        std::string m_lastError;
 };
 
 //}}}
@@ -0,0 +1,641 @@
+/*
+ * (c) 2026, SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <endian.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include <zlib.h>
+
+#include "global.h"
+
+#if HAVE_LIBLZMA
+#   include <lzma.h>
+#endif // HAVE_LIBLZMA
+#if HAVE_LIBZSTD
+#   include <zstd.h>
+#endif // HAVE_LIBZSTD
+#if HAVE_LIBLZ4
+#   include <lz4.h>
+#   include <lz4frame.h>
+#endif // HAVE_LIBLZ4
+
+#include "debug.h"
+#include "decompress.h"
+#include "stringutil.h"
+
+using std::string;
+
+/* size of the buffer for compressed data */
+#define INPUT_SIZE          (64 * 1024)
+
+/* longest magic number of the supported formats */
+#define MAGIC_MAX           6
+
+static const unsigned char gzip_magic[] = { 0x1f, 0x8b };
+static const unsigned char xz_magic[] = { 0xfd, '7', 'z', 'X', 'Z', 0x00 };
+static const unsigned char zstd_magic[] = { 0x28, 0xb5, 0x2f, 0xfd };
+static const unsigned char lz4_magic[] = { 0x04, 0x22, 0x4d, 0x18 };
+static const unsigned char lz4_legacy_magic[] = { 0x02, 0x21, 0x4c, 0x18 };
+
+/* the legacy LZ4 format (lz4 -l) uses fixed 8 MiB blocks */
+#define LZ4_LEGACY_BLOCK    (8 * 1024 * 1024)
+
+//{{{ PlainDecompressor --------------------------------------------------------
+
+/**
+ * Pass-through "decompressor" for uncompressed data.
+ */
+class PlainDecompressor : public Decompressor {
+
+    public:
+        PlainDecompressor(int fd, off_t offset)
+            : Decompressor(FMT_NONE, fd, offset)
+        {}
+
+        void skip(off_t len);
+
+    protected:
+        size_t decompress(unsigned char *buf, size_t len);
+};
+
+// -----------------------------------------------------------------------------
+void PlainDecompressor::skip(off_t len)
+{
+    size_t avail = m_inputLen - m_inputPos;
+    if (off_t(avail) >= len) {
+        m_inputPos += len;
+        return;
+    }
+
+    // no need to read the data in between
+    m_offset += len - avail;
+    m_inputPos = m_inputLen = 0;
+}
+
+// -----------------------------------------------------------------------------
+size_t PlainDecompressor::decompress(unsigned char *buf, size_t len)
+{
+    if (!fillInput())
+        return 0;
+
+    size_t avail = m_inputLen - m_inputPos;
+    if (len > avail)
+        len = avail;
+    memcpy(buf, m_input + m_inputPos, len);
+    m_inputPos += len;
+    return len;
+}
+
+//}}}
+//{{{ GzipDecompressor ---------------------------------------------------------
+
+class GzipDecompressor : public Decompressor {
+
+    public:
+        GzipDecompressor(int fd, off_t offset);
+        ~GzipDecompressor();
+
+    protected:
+        size_t decompress(unsigned char *buf, size_t len);
+
+    private:
+        z_stream m_stream;
+        bool m_end;
+};
+
+// -----------------------------------------------------------------------------
+GzipDecompressor::GzipDecompressor(int fd, off_t offset)
+    : Decompressor(FMT_GZIP, fd, offset), m_end(false)
+{
+    memset(&m_stream, 0, sizeof m_stream);
+
+    // 16 + MAX_WBITS: parse (and verify) the gzip header and trailer
+    if (inflateInit2(&m_stream, 16 + MAX_WBITS) != Z_OK)
+        throw KError("inflateInit2() failed");
+}
+
+// -----------------------------------------------------------------------------
+GzipDecompressor::~GzipDecompressor()
+{
+    inflateEnd(&m_stream);
+}
+
+// -----------------------------------------------------------------------------
+size_t GzipDecompressor::decompress(unsigned char *buf, size_t len)
+{
+    m_stream.next_out = buf;
+    m_stream.avail_out = len;
+
+    while (!m_end && m_stream.avail_out == len) {
+        if (!fillInput())
+            throw KError("Unexpected end of gzip data.");
+
+        m_stream.next_in = m_input + m_inputPos;
+        m_stream.avail_in = m_inputLen - m_inputPos;
+        int ret = inflate(&m_stream, Z_NO_FLUSH);
+        m_inputPos = m_inputLen - m_stream.avail_in;
+
+        if (ret == Z_STREAM_END)
+            m_end = true;
+        else if (ret != Z_OK && ret != Z_BUF_ERROR)
+            throw KError("gzip decompression failed (" +
+                         StringUtil::number2string(ret) + ").");
+    }
+
+    return len - m_stream.avail_out;
+}
+
+//}}}
+//{{{ XzDecompressor -----------------------------------------------------------
+
+#if HAVE_LIBLZMA
+
+class XzDecompressor : public Decompressor {
+
+    public:
+        XzDecompressor(int fd, off_t offset);
+        ~XzDecompressor();
+
+    protected:
+        size_t decompress(unsigned char *buf, size_t len);
+
+    private:
+        lzma_stream m_stream;
+        bool m_end;
+};
+
+// -----------------------------------------------------------------------------
+XzDecompressor::XzDecompressor(int fd, off_t offset)
+    : Decompressor(FMT_XZ, fd, offset), m_end(false)
+{
+    lzma_stream init = LZMA_STREAM_INIT;
+    m_stream = init;
+
+    lzma_ret ret = lzma_stream_decoder(&m_stream, UINT64_MAX, 0);
+    if (ret != LZMA_OK)
+        throw KError("lzma_stream_decoder() failed (" +
+                     StringUtil::number2string(int(ret)) + ").");
+}
+
+// -----------------------------------------------------------------------------
+XzDecompressor::~XzDecompressor()
+{
+    lzma_end(&m_stream);
+}
+
+// -----------------------------------------------------------------------------
+size_t XzDecompressor::decompress(unsigned char *buf, size_t len)
+{
+    m_stream.next_out = buf;
+    m_stream.avail_out = len;
+
+    while (!m_end && m_stream.avail_out == len) {
+        if (!fillInput())
+            throw KError("Unexpected end of xz data.");
+
+        m_stream.next_in = m_input + m_inputPos;
+        m_stream.avail_in = m_inputLen - m_inputPos;
+        lzma_ret ret = lzma_code(&m_stream, LZMA_RUN);
+        m_inputPos = m_inputLen - m_stream.avail_in;
+
+        if (ret == LZMA_STREAM_END)
+            m_end = true;
+        else if (ret != LZMA_OK)
+            throw KError("xz decompression failed (" +
+                         StringUtil::number2string(int(ret)) + ").");
+    }
+
+    return len - m_stream.avail_out;
+}
+
+#endif // HAVE_LIBLZMA
+
+//}}}
+//{{{ ZstdDecompressor ---------------------------------------------------------
+
+#if HAVE_LIBZSTD
+
+class ZstdDecompressor : public Decompressor {
+
+    public:
+        ZstdDecompressor(int fd, off_t offset);
+        ~ZstdDecompressor();
+
+    protected:
+        size_t decompress(unsigned char *buf, size_t len);
+
+    private:
+        ZSTD_DStream *m_stream;
+        bool m_end;
+};
+
+// -----------------------------------------------------------------------------
+ZstdDecompressor::ZstdDecompressor(int fd, off_t offset)
+    : Decompressor(FMT_ZSTD, fd, offset), m_end(false)
+{
+    m_stream = ZSTD_createDStream();
+    if (!m_stream)
+        throw KError("ZSTD_createDStream() failed.");
+    ZSTD_initDStream(m_stream);
+}
+
+// -----------------------------------------------------------------------------
+ZstdDecompressor::~ZstdDecompressor()
+{
+    ZSTD_freeDStream(m_stream);
+}
+
+// -----------------------------------------------------------------------------
+size_t ZstdDecompressor::decompress(unsigned char *buf, size_t len)
+{
+    ZSTD_outBuffer out = { buf, len, 0 };
+
+    while (!m_end && out.pos == 0) {
+        if (!fillInput())
+            throw KError("Unexpected end of zstd data.");
+
+        ZSTD_inBuffer in = {
+            m_input + m_inputPos, m_inputLen - m_inputPos, 0
+        };
+        size_t ret = ZSTD_decompressStream(m_stream, &out, &in);
+        m_inputPos += in.pos;
+
+        if (ZSTD_isError(ret))
+            throw KError(string("zstd decompression failed: ") +
+                         ZSTD_getErrorName(ret));
+        if (ret == 0)
+            m_end = true;
+    }
+
+    return out.pos;
+}
+
+#endif // HAVE_LIBZSTD
+
+//}}}
+//{{{ Lz4Decompressor ----------------------------------------------------------
+
+#if HAVE_LIBLZ4
+
+/**
+ * LZ4 frame format, as written by the lz4 tool by default.
+ */
+class Lz4Decompressor : public Decompressor {
+
+    public:
+        Lz4Decompressor(int fd, off_t offset);
+        ~Lz4Decompressor();
+
+    protected:
+        size_t decompress(unsigned char *buf, size_t len);
+
+    private:
+        LZ4F_dctx *m_ctx;
+        bool m_end;
+};
+
+// -----------------------------------------------------------------------------
+Lz4Decompressor::Lz4Decompressor(int fd, off_t offset)
+    : Decompressor(FMT_LZ4, fd, offset), m_end(false)
+{
+    LZ4F_errorCode_t ret = LZ4F_createDecompressionContext(&m_ctx,
+                                                           LZ4F_VERSION);
+    if (LZ4F_isError(ret))
+        throw KError(string("LZ4F_createDecompressionContext() failed: ") +
+                     LZ4F_getErrorName(ret));
+}
+
+// -----------------------------------------------------------------------------
+Lz4Decompressor::~Lz4Decompressor()
+{
+    LZ4F_freeDecompressionContext(m_ctx);
+}
+
+// -----------------------------------------------------------------------------
+size_t Lz4Decompressor::decompress(unsigned char *buf, size_t len)
+{
+    size_t outlen = 0;
+
+    while (!m_end && outlen == 0) {
+        if (!fillInput())
+            throw KError("Unexpected end of lz4 data.");
+
+        size_t inlen = m_inputLen - m_inputPos;
+        outlen = len;
+        size_t ret = LZ4F_decompress(m_ctx, buf, &outlen,
+                                     m_input + m_inputPos, &inlen, NULL);
+        m_inputPos += inlen;
+
+        if (LZ4F_isError(ret))
+            throw KError(string("lz4 decompression failed: ") +
+                         LZ4F_getErrorName(ret));
+        if (ret == 0)
+            m_end = true;
+    }
+
+    return outlen;
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Legacy LZ4 format (lz4 -l), which is used for compressed kernels.
+ *
+ * The magic number is followed by blocks, each prefixed by its 32-bit
+ * little-endian compressed size. Every block except the last one
+ * decompresses to exactly 8 MiB. There is no end marker, so the stream
+ * ends at the end of the file or at the first invalid block size (the
+ * kernel build appends the uncompressed size as a trailer).
+ */
+class Lz4LegacyDecompressor : public Decompressor {
+
+    public:
+        Lz4LegacyDecompressor(int fd, off_t offset);
+
+    protected:
+        size_t decompress(unsigned char *buf, size_t len);
+
+    private:
+        std::vector<char> m_block;
+        std::vector<char> m_data;
+        size_t m_dataPos, m_dataLen;
+        bool m_end;
+
+        bool readRaw(void *buf, size_t len);
+};
+
+// -----------------------------------------------------------------------------
+Lz4LegacyDecompressor::Lz4LegacyDecompressor(int fd, off_t offset)
+    : Decompressor(FMT_LZ4_LEGACY, fd, offset),
+      m_dataPos(0), m_dataLen(0), m_end(false)
+{
+    // skip the magic number
+    m_offset += sizeof lz4_legacy_magic;
+}
+
+// -----------------------------------------------------------------------------
+bool Lz4LegacyDecompressor::readRaw(void *buf, size_t len)
+{
+    char *p = static_cast<char *>(buf);
+    while (len) {
+        if (!fillInput())
+            return false;
+        size_t chunk = m_inputLen - m_inputPos;
+        if (chunk > len)
+            chunk = len;
+        memcpy(p, m_input + m_inputPos, chunk);
+        m_inputPos += chunk;
+        p += chunk;
+        len -= chunk;
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+size_t Lz4LegacyDecompressor::decompress(unsigned char *buf, size_t len)
+{
+    while (!m_end && m_dataPos == m_dataLen) {
+        uint32_t blocksize;
+        if (!readRaw(&blocksize, sizeof blocksize)) {
+            m_end = true;
+            break;
+        }
+        blocksize = le32toh(blocksize);
+
+        // concatenated streams repeat the magic number
+        if (memcmp(&blocksize, lz4_legacy_magic, sizeof blocksize) == 0)
+            continue;
+        if (blocksize == 0 ||
+            blocksize > unsigned(LZ4_compressBound(LZ4_LEGACY_BLOCK))) {
+            m_end = true;
+            break;
+        }
+
+        m_block.resize(blocksize);
+        if (!readRaw(&m_block[0], blocksize))
+            throw KError("Unexpected end of lz4 data.");
+
+        m_data.resize(LZ4_LEGACY_BLOCK);
+        int ret = LZ4_decompress_safe(&m_block[0], &m_data[0],
+                                      blocksize, LZ4_LEGACY_BLOCK);
+        if (ret < 0)
+            throw KError("lz4 decompression failed.");
+        m_dataPos = 0;
+        m_dataLen = ret;
+    }
+
+    size_t avail = m_dataLen - m_dataPos;
+    if (len > avail)
+        len = avail;
+    memcpy(buf, &m_data[m_dataPos], len);
+    m_dataPos += len;
+    return len;
+}
+
+#endif // HAVE_LIBLZ4
+
+//}}}
+//{{{ Decompressor -------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+Decompressor::Decompressor(Format fmt, int fd, off_t offset)
+    : m_format(fmt), m_fd(fd), m_offset(offset),
+      m_input(new unsigned char[INPUT_SIZE]),
+      m_inputPos(0), m_inputLen(0), m_eof(false)
+{}
+
+// -----------------------------------------------------------------------------
+Decompressor::~Decompressor()
+{
+    delete[] m_input;
+}
+
+// -----------------------------------------------------------------------------
+Decompressor::Format Decompressor::detect(int fd, off_t offset)
+{
+    unsigned char magic[MAGIC_MAX];
+    ssize_t len;
+
+    do {
+        len = pread(fd, magic, sizeof magic, offset);
+    } while (len < 0 && errno == EINTR);
+    if (len < 0)
+        throw KSystemError("Cannot read compression magic", errno);
+
+    return detect(magic, len);
+}
+
+// -----------------------------------------------------------------------------
+Decompressor::Format Decompressor::detect(const void *data, size_t len)
+{
+    const unsigned char *magic = static_cast<const unsigned char *>(data);
+
+#define HAS_MAGIC(m)    (len >= sizeof(m) && !memcmp(magic, m, sizeof(m)))
+    if (HAS_MAGIC(gzip_magic))
+        return FMT_GZIP;
+    else if (HAS_MAGIC(xz_magic))
+        return FMT_XZ;
+    else if (HAS_MAGIC(zstd_magic))
+        return FMT_ZSTD;
+    else if (HAS_MAGIC(lz4_magic))
+        return FMT_LZ4;
+    else if (HAS_MAGIC(lz4_legacy_magic))
+        return FMT_LZ4_LEGACY;
+    else
+        return FMT_NONE;
+#undef HAS_MAGIC
+}
+
+// -----------------------------------------------------------------------------
+bool Decompressor::isSupported(Format fmt)
+{
+    switch (fmt) {
+        case FMT_NONE:
+        case FMT_GZIP:
+            return true;
+
+        case FMT_XZ:
+            return HAVE_LIBLZMA;
+
+        case FMT_ZSTD:
+            return HAVE_LIBZSTD;
+
+        case FMT_LZ4:
+        case FMT_LZ4_LEGACY:
+            return HAVE_LIBLZ4;
+
+        default:
+            return false;
+    }
+}
+
+// -----------------------------------------------------------------------------
+const char *Decompressor::formatName(Format fmt)
+{
+    switch (fmt) {
+        case FMT_NONE:          return "none";
+        case FMT_GZIP:          return "gzip";
+        case FMT_XZ:            return "xz";
+        case FMT_ZSTD:          return "zstd";
+        case FMT_LZ4:
+        case FMT_LZ4_LEGACY:    return "lz4";
+        default:                return "unknown";
+    }
+}
+
+// -----------------------------------------------------------------------------
+Decompressor *Decompressor::open(int fd, off_t offset)
+{
+    Format fmt = detect(fd, offset);
+
+    Debug::debug()->trace("Decompressor::open(%d, %lld): %s",
+                          fd, (long long)offset, formatName(fmt));
+
+    switch (fmt) {
+        case FMT_NONE:
+            return new PlainDecompressor(fd, offset);
+
+        case FMT_GZIP:
+            return new GzipDecompressor(fd, offset);
+
+#if HAVE_LIBLZMA
+        case FMT_XZ:
+            return new XzDecompressor(fd, offset);
+#endif
+
+#if HAVE_LIBZSTD
+        case FMT_ZSTD:
+            return new ZstdDecompressor(fd, offset);
+#endif
+
+#if HAVE_LIBLZ4
+        case FMT_LZ4:
+            return new Lz4Decompressor(fd, offset);
+
+        case FMT_LZ4_LEGACY:
+            return new Lz4LegacyDecompressor(fd, offset);
+#endif
+
+        default:
+            throw KError(string(formatName(fmt)) +
+                         " compression is not supported.");
+    }
+}
+
+// -----------------------------------------------------------------------------
+size_t Decompressor::read(void *buf, size_t len)
+{
+    unsigned char *p = static_cast<unsigned char *>(buf);
+    size_t total = 0;
+
+    while (total < len) {
+        size_t ret = decompress(p + total, len - total);
+        if (!ret)
+            break;
+        total += ret;
+    }
+    return total;
+}
+
+// -----------------------------------------------------------------------------
+void Decompressor::skip(off_t len)
+{
+    unsigned char buf[BUFSIZ];
+
+    while (len > 0) {
+        size_t ret = decompress(buf, len < off_t(sizeof buf)
+                                ? size_t(len) : sizeof buf);
+        if (!ret)
+            break;
+        len -= ret;
+    }
+}
+
+// -----------------------------------------------------------------------------
+bool Decompressor::fillInput()
+{
+    if (m_inputPos < m_inputLen)
+        return true;
+    if (m_eof)
+        return false;
+
+    ssize_t ret;
+    do {
+        ret = pread(m_fd, m_input, INPUT_SIZE, m_offset);
+    } while (ret < 0 && errno == EINTR);
+    if (ret < 0)
+        throw KSystemError("Cannot read compressed data", errno);
+    if (ret == 0) {
+        m_eof = true;
+        return false;
+    }
+
+    m_offset += ret;
+    m_inputPos = 0;
+    m_inputLen = ret;
+    return true;
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,165 @@
+/*
+ * (c) 2026, SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#ifndef DECOMPRESS_H
+#define DECOMPRESS_H
+
+#include <sys/types.h>
+
+#include "global.h"
+
+//{{{ Decompressor -------------------------------------------------------------
+
+/**
+ * Streaming decompression of (a part of) a file.
+ *
+ * The compression format is detected from the magic bytes at the start
+ * offset. Data that is not compressed is passed through unchanged, so
+ * callers need not care whether the file is compressed or not. Reading
+ * stops at the end of the first compressed stream, so any trailing data
+ * (e.g. in a bzImage) is ignored.
+ */
+class Decompressor {
+
+    public:
+        /**
+         * Supported compression formats.
+         */
+        enum Format {
+            FMT_NONE,
+            FMT_GZIP,
+            FMT_XZ,
+            FMT_ZSTD,
+            FMT_LZ4,
+            FMT_LZ4_LEGACY
+        };
+
+        /**
+         * Detect the compression format of the data at @p offset.
+         *
+         * @param[in] fd     file descriptor
+         * @param[in] offset start of the (possibly compressed) data
+         * @return the compression format, or FMT_NONE if the data does
+         *         not start with a known magic
+         * @exception KSystemError if reading from @p fd fails
+         */
+        static Format detect(int fd, off_t offset = 0);
+
+        /**
+         * Detect the compression format of data in memory.
+         *
+         * @param[in] data start of the (possibly compressed) data
+         * @param[in] len  number of valid bytes at @p data
+         * @return the compression format, or FMT_NONE if the data does
+         *         not start with a known magic
+         */
+        static Format detect(const void *data, size_t len);
+
+        /**
+         * Checks whether kdumptool was built with support for a format.
+         *
+         * @param[in] fmt the compression format
+         */
+        static bool isSupported(Format fmt);
+
+        /**
+         * Returns a human-readable name of a format, e.g. "xz".
+         *
+         * @param[in] fmt the compression format
+         */
+        static const char *formatName(Format fmt);
+
+        /**
+         * Create a decompressor for the data at @p offset.
+         *
+         * The file descriptor is not duplicated and must stay open
+         * while the returned object is used. Its file offset is not
+         * changed.
+         *
+         * @param[in] fd     file descriptor
+         * @param[in] offset start of the (possibly compressed) data
+         * @return a new decompressor object that has to be freed
+         *         by the caller
+         * @exception KError if the format is not supported
+         */
+        static Decompressor *open(int fd, off_t offset = 0);
+
+        virtual ~Decompressor();
+
+        /**
+         * Returns the compression format of the stream.
+         */
+        Format format() const
+        { return m_format; }
+
+        /**
+         * Read decompressed data.
+         *
+         * @param[out] buf buffer for the data
+         * @param[in]  len size of @p buf
+         * @return number of bytes stored in @p buf; less than @p len
+         *         only at the end of the stream
+         * @exception KError if the compressed data is corrupted
+         */
+        size_t read(void *buf, size_t len);
+
+        /**
+         * Skip decompressed data.
+         *
+         * Skipping beyond the end of the stream is not an error; the
+         * next read() simply returns zero.
+         *
+         * @param[in] len number of bytes to skip
+         * @exception KError if the compressed data is corrupted
+         */
+        virtual void skip(off_t len);
+
+    protected:
+        Decompressor(Format fmt, int fd, off_t offset);
+
+        /**
+         * Decompress as much data as possible into @p buf.
+         *
+         * @param[out] buf buffer for the data
+         * @param[in]  len size of @p buf
+         * @return number of bytes stored in @p buf, zero at the end of
+         *         the stream
+         */
+        virtual size_t decompress(unsigned char *buf, size_t len) = 0;
+
+        /**
+         * Make sure that there is some compressed input available.
+         *
+         * @return @c false at the end of the file
+         * @exception KSystemError if reading fails
+         */
+        bool fillInput();
+
+        Format m_format;
+        int m_fd;
+        off_t m_offset;
+        unsigned char *m_input;
+        size_t m_inputPos, m_inputLen;
+        bool m_eof;
+};
+
+//}}}
+
+#endif /* DECOMPRESS_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -23,6 +23,7 @@ DEFINE_OPT(MAKEDUMPFILE_OPTIONS, String, "", DUMP)
 DEFINE_OPT(KDUMP_IMMEDIATE_REBOOT, Bool, true, DUMP)
 DEFINE_OPT(KDUMP_TRANSFER, String, "", DUMP)
 DEFINE_OPT(KDUMP_SAVEDIR, String, "/var/log/dump", MKINITRD | DUMP)
+DEFINE_OPT(KDUMP_SAVEDIR_POLICY, String, "legacy", DUMP)
 DEFINE_OPT(KDUMP_KEEP_OLD_DUMPS, Int, 0, DUMP)
 DEFINE_OPT(KDUMP_FREE_DISK_SIZE, Int, 64, DUMP)
 DEFINE_OPT(KDUMP_VERBOSE, Int, 0, KEXEC | DUMP)
@@ -30,6 +31,7 @@ DEFINE_OPT(KDUMP_DUMPLEVEL, Int, 31, DUMP)
 DEFINE_OPT(KDUMP_DUMPFORMAT, String, "compressed", DUMP)
 DEFINE_OPT(KDUMP_CONTINUE_ON_ERROR, Bool, true, DUMP)
 DEFINE_OPT(KDUMP_REQUIRED_PROGRAMS, String, "", MKINITRD)
+DEFINE_OPT(KDUMP_LEAN_INITRD, Bool, false, MKINITRD)
 DEFINE_OPT(KDUMP_PRESCRIPT, String, "", DUMP)
 DEFINE_OPT(KDUMP_POSTSCRIPT, String, "", DUMP)
 DEFINE_OPT(KDUMP_COPY_KERNEL, Bool, "", DUMP)
@@ -43,3 +45,7 @@ DEFINE_OPT(KDUMP_NOTIFICATION_TO, String, "", DUMP)
 DEFINE_OPT(KDUMP_NOTIFICATION_CC, String, "", DUMP)
 DEFINE_OPT(KDUMP_HOST_KEY, String, "", DUMP)
 DEFINE_OPT(KDUMP_SSH_IDENTITY, String, "", MKINITRD)
+DEFINE_OPT(KDUMP_SSH_SPARSE, Bool, false, DUMP)
+DEFINE_OPT(KDUMP_SSH_COMPRESS, String, "", DUMP)
+DEFINE_OPT(KDUMP_SSH_STREAM, String, "", DUMP)
+DEFINE_OPT(KDUMP_SSH_CIPHER, String, "", DUMP)
@@ -19,11 +19,19 @@
 #include <iostream>
 #include <string>
 #include <cerrno>
+#include <cstring>
 #include <memory>
+#include <strings.h>
 #include <sstream>
 #include <algorithm>
 #include <ext/algorithm>
 
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+
 #include "subcommand.h"
 #include "debug.h"
 #include "savedump.h"
@@ -46,18 +54,94 @@ using std::stringstream;
 using std::cerr;
 using std::back_inserter;
 
+// -----------------------------------------------------------------------------
+static void removeTree(int parentfd, const char *name)
+{
+    Debug::debug()->trace("removeTree(%d, %s)", parentfd, name);
+
+    int fd = openat(parentfd, name,
+                    O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0)
+        throw KSystemError("Cannot open " + string(name) + ".", errno);
+    DIR *dirp = fdopendir(fd);
+    if (!dirp) {
+        int err = errno;
+        close(fd);
+        throw KSystemError("Cannot open " + string(name) + ".", err);
+    }
+
+    try {
+        struct dirent *d;
+
+        errno = 0;
+        while ( (d = readdir(dirp)) ) {
+            if (strcmp(d->d_name, ".") == 0 || strcmp(d->d_name, "..") == 0)
+                continue;
+
+            bool isdir = d->d_type == DT_DIR;
+            if (d->d_type == DT_UNKNOWN) {
+                struct stat st;
+                isdir = fstatat(fd, d->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0
+                    && S_ISDIR(st.st_mode);
+            }
+
+            if (isdir)
+                removeTree(fd, d->d_name);
+            else if (unlinkat(fd, d->d_name, 0) != 0)
+                throw KSystemError("Cannot remove " +
+                    string(d->d_name) + ".", errno);
+            errno = 0;
+        }
+        if (errno)
+            throw KSystemError("Cannot read directory " +
+                string(name) + ".", errno);
+    } catch (...) {
+        closedir(dirp);
+        throw;
+    }
+    closedir(dirp);
+
+    if (unlinkat(parentfd, name, AT_REMOVEDIR) != 0)
+        throw KSystemError("Cannot rmdir(" + string(name) + ").", errno);
+}
+
+// -----------------------------------------------------------------------------
+static unsigned long long freeSpace(int dirfd)
+{
+    struct statfs mystatfs;
+    if (fstatfs(dirfd, &mystatfs) != 0)
+        throw KSystemError("fstatfs() failed.", errno);
+    return (unsigned long long)mystatfs.f_bfree * mystatfs.f_bsize;
+}
+
 //{{{ DeleteDumps --------------------------------------------------------------
 
 // -----------------------------------------------------------------------------
 DeleteDumps::DeleteDumps()
-    : m_dryRun(false)
+    : m_dryRun(false), m_enough(true)
 {
     Debug::debug()->trace("DeleteDumps::DeleteDumps()");
 }
 
+// -----------------------------------------------------------------------------
+DeleteDumps::~DeleteDumps()
+{
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
 // -----------------------------------------------------------------------------
 void DeleteDumps::deleteAll()
 {
+    start(0);
+    wait();
+}
+
+// -----------------------------------------------------------------------------
+void DeleteDumps::start(unsigned long long projected)
+{
+    Debug::debug()->trace("DeleteDumps::start(%llu)", projected);
+
     Configuration *config = Configuration::config();
 
     int oldDumps = config->KDUMP_KEEP_OLD_DUMPS.value();
@@ -68,16 +152,76 @@ void DeleteDumps::deleteAll()
         return;
     }
 
+    unsigned long long reserve = 0;
+    int freeSize = config->KDUMP_FREE_DISK_SIZE.value();
+    if (freeSize > 0)
+        reserve = freeSize * 1024ULL * 1024ULL;
+
+    StringVector dirs;
     std::istringstream iss(config->KDUMP_SAVEDIR.value());
     string elem;
-    while (iss >> elem) {
-        RootDirURL url(elem, m_rootdir);
-        deleteOne(url, oldDumps);
+    while (iss >> elem)
+        dirs.push_back(elem);
+
+    // the share of each target depends on the policy, see SaveDump;
+    // the number of split files depends on the CPUs of the kdump
+    // kernel, so with SPLIT the whole dump is expected on each target
+    FileTransfer::Policy policy =
+        FileTransfer::parsePolicy(config->KDUMP_SAVEDIR_POLICY.value());
+    unsigned long files = 1;
+    if (strcasecmp(config->KDUMP_DUMPFORMAT.value().c_str(), "elf") != 0 &&
+        !config->kdumptoolContainsFlag("SINGLE")) {
+        if (config->kdumptoolContainsFlag("SPLIT") &&
+            !config->kdumptoolContainsFlag("NOSPLIT"))
+            files = 0;
+        else if (policy == FileTransfer::POLICY_STRIPE)
+            files = dirs.size();
+    }
+
+    m_targets.clear();
+    for (size_t i = 0; i < dirs.size(); ++i) {
+        RootDirURL url(dirs[i], m_rootdir);
+        unsigned long long needed = FileTransfer::targetSize(
+            policy, files, i, dirs.size(), projected);
+        planOne(url, oldDumps, needed + reserve);
+    }
+    if (m_targets.empty())
+        return;
+
+    m_enough = false;
+    m_error = nullptr;
+    try {
+        m_thread = std::thread(&DeleteDumps::run, this);
+    } catch (const std::system_error &e) {
+        Debug::debug()->dbg("Cannot start thread: %s", e.what());
+        run();
+    }
+}
+
+// -----------------------------------------------------------------------------
+void DeleteDumps::waitForSpace()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_enough)
+        m_cond.wait(lock);
+}
+
+// -----------------------------------------------------------------------------
+void DeleteDumps::wait()
+{
+    if (m_thread.joinable())
+        m_thread.join();
+
+    if (m_error) {
+        std::exception_ptr error = m_error;
+        m_error = nullptr;
+        std::rethrow_exception(error);
     }
 }
 
 // -----------------------------------------------------------------------------
-void DeleteDumps::deleteOne(const RootDirURL &url, int oldDumps)
+void DeleteDumps::planOne(const RootDirURL &url, int oldDumps,
+                          unsigned long long needed)
 {
     if (url.getProtocol() != URLParser::PROT_FILE) {
         cerr << "Deletion of old dump only on local disk." << endl;
@@ -104,18 +248,57 @@ void DeleteDumps::deleteOne(const RootDirURL &url, int oldDumps)
 
     Debug::debug()->dbg("Deleting the oldest %d entries.", deleteItems);
 
-    StringVector toDelete;
-    std::copy_n(contents.begin(), deleteItems, back_inserter(toDelete));
+    Target target;
+    target.dir = dir;
+    std::copy_n(contents.begin(), deleteItems,
+                back_inserter(target.dumps));
+    target.next = 0;
+    target.needed = needed;
+    m_targets.push_back(target);
+}
+
+// -----------------------------------------------------------------------------
+void DeleteDumps::run()
+{
+    try {
+        std::vector<Target>::iterator it;
 
-    for (StringVector::const_iterator it = toDelete.begin();
-            it != toDelete.end(); ++it) {
-        Debug::debug()->info("Deleting %s.", (*it).c_str());
-        if (!m_dryRun) {
-            FilePath fp = dir;
-            fp.appendPath(*it);
-            fp.rmdir(true);
+        // first make room for the new dump, oldest dumps first
+        for (it = m_targets.begin(); it != m_targets.end(); ++it) {
+            FileDescriptor dirfd(it->dir, O_RDONLY | O_DIRECTORY);
+            while (it->next < it->dumps.size() &&
+                   freeSpace(dirfd) < it->needed)
+                deleteNext(*it, dirfd);
         }
+        notify();
+
+        // the rest can be deleted while the dump is saved
+        for (it = m_targets.begin(); it != m_targets.end(); ++it) {
+            FileDescriptor dirfd(it->dir, O_RDONLY | O_DIRECTORY);
+            while (it->next < it->dumps.size())
+                deleteNext(*it, dirfd);
+        }
+    } catch (...) {
+        m_error = std::current_exception();
     }
+    notify();
+}
+
+// -----------------------------------------------------------------------------
+void DeleteDumps::deleteNext(Target &target, int dirfd)
+{
+    const string &name = target.dumps[target.next++];
+    Debug::debug()->info("Deleting %s.", name.c_str());
+    if (!m_dryRun)
+        removeTree(dirfd, name.c_str());
+}
+
+// -----------------------------------------------------------------------------
+void DeleteDumps::notify()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_enough = true;
+    m_cond.notify_all();
 }
 
 //}}}
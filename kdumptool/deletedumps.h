@@ -19,8 +19,16 @@
 #ifndef DELETE_DUMP_H
 #define DELETE_DUMP_H
 
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include "subcommand.h"
 #include "rootdirurl.h"
+#include "fileutil.h"
+#include "stringvector.h"
 
 class Transfer;
 
@@ -28,6 +36,11 @@ class Transfer;
 
 /**
  * Delete old dumps from disk.
+ *
+ * Deletion can run in a background thread while the new dump is saved.
+ * The oldest dumps are deleted first, and waitForSpace() returns as soon
+ * as each target has room for the new dump; the remaining old dumps are
+ * deleted concurrently with the save.
  */
 class DeleteDumps {
     protected:
@@ -37,8 +50,43 @@ class DeleteDumps {
     public:
         DeleteDumps();
 
+        /**
+         * Waits for a running background deletion.
+         */
+        virtual ~DeleteDumps();
+
+        /**
+         * Delete all old dumps and wait until this is finished.
+         *
+         * @throw KError on any error.
+         */
         void deleteAll();
 
+        /**
+         * Start deleting old dumps in a background thread.
+         *
+         * @param[in] projected projected size of the new dump in bytes;
+         *            the oldest dumps are deleted first until the part
+         *            of the dump that is written to a target (according
+         *            to KDUMP_SAVEDIR_POLICY) plus KDUMP_FREE_DISK_SIZE
+         *            is free on that target
+         * @throw KError if the dump directories cannot be listed
+         */
+        void start(unsigned long long projected);
+
+        /**
+         * Wait until there is room for the new dump on all targets, or
+         * until no more dumps can be deleted.
+         */
+        void waitForSpace();
+
+        /**
+         * Wait until the background deletion is finished.
+         *
+         * @throw KError if deleting a dump failed.
+         */
+        void wait();
+
         const std::string& rootDir() const
         { return m_rootdir; }
         void rootDir(const std::string& rootdir)
@@ -50,12 +98,48 @@ class DeleteDumps {
         { m_dryRun = dryRun; }
 
     private:
+        /**
+         * Old dumps in one dump target directory, oldest first.
+         */
+        struct Target {
+            FilePath dir;
+            StringVector dumps;
+            size_t next;
+            unsigned long long needed;
+        };
+
+        std::vector<Target> m_targets;
+        std::thread m_thread;
+        std::mutex m_mutex;
+        std::condition_variable m_cond;
+        bool m_enough;
+        std::exception_ptr m_error;
+
+	/**
+	 * Helper function to find the old dumps in one dump target
+	 * directory.
+	 *
+	 * @throw KError on any error.
+	 */
+	void planOne(const RootDirURL &url, int oldDumps,
+	             unsigned long long needed);
+
+	/**
+	 * Body of the background thread.
+	 */
+	void run();
+
 	/**
-	 * Helper function to delete one dump target directory.
+	 * Delete the next (oldest) dump of a target.
 	 *
 	 * @throw KError on any error.
 	 */
-	void deleteOne(const RootDirURL &url, int oldDumps);
+	void deleteNext(Target &target, int dirfd);
+
+	/**
+	 * Wake up waitForSpace().
+	 */
+	void notify();
 };
 
 //}}}
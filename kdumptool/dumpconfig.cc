@@ -43,7 +43,7 @@ const char *DumpConfig::usage_names[] = {
 // -----------------------------------------------------------------------------
 DumpConfig::DumpConfig()
     : m_format(FMT_SHELL), m_usage((1 << ConfigOption::USE_MAX) - 1),
-      m_nodefault(false)
+      m_nodefault(false), m_requirements(false)
 {
     string formatlist;
     for (size_t i = 0; i < sizeof(format_names)/sizeof(format_names[0]); ++i) {
@@ -70,6 +70,9 @@ DumpConfig::DumpConfig()
 
     m_options.push_back(new FlagOption("nodefault", 'n', &m_nodefault,
 	"Omit variables which have their default values"));
+
+    m_options.push_back(new FlagOption("requirements", 'r', &m_requirements,
+	"Also show what the configuration requires"));
 }
 
 // -----------------------------------------------------------------------------
@@ -156,6 +159,14 @@ void DumpConfig::execute()
         cout << (*it)->name() << "=" << qs->quoted() << delim;
     }
 
+    // derived values for the initrd setup scripts
+    if (m_requirements) {
+        cout << "kdump_needs_network="
+             << (config->needsNetwork() ? "yes" : "no") << delim;
+        cout << "kdump_needs_makedumpfile="
+             << (config->needsMakedumpfile() ? "yes" : "no") << delim;
+    }
+
     delete qs;
 }
 
@@ -65,6 +65,7 @@ class DumpConfig : public Subcommand {
 	StringOption *m_usageOption;
 
 	bool m_nodefault;
+	bool m_requirements;
 
 	static const char *format_names[];
 	static const char *usage_names[];
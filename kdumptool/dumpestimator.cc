@@ -0,0 +1,254 @@
+/*
+ * (c) 2026, SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <strings.h>
+#include <unistd.h>
+#include <elf.h>
+
+#include <zlib.h>
+
+#include "global.h"
+
+#if HAVE_LIBZSTD
+#   include <zstd.h>
+#endif // HAVE_LIBZSTD
+#if HAVE_LIBLZ4
+#   include <lz4.h>
+#endif // HAVE_LIBLZ4
+
+#include "debug.h"
+#include "dumpestimator.h"
+
+using std::string;
+
+/* size of a page descriptor in the kdump-compressed format */
+#define PAGE_DESC_SIZE          24
+
+// -----------------------------------------------------------------------------
+static bool isZeroPage(const std::vector<unsigned char> &page)
+{
+    for (size_t i = 0; i < page.size(); ++i)
+        if (page[i])
+            return false;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+static size_t zlibSize(const std::vector<unsigned char> &page)
+{
+    // makedumpfile -c uses the fastest compression level
+    uLongf len = compressBound(page.size());
+    std::vector<Bytef> out(len);
+    if (compress2(out.data(), &len, page.data(), page.size(),
+                  Z_BEST_SPEED) != Z_OK)
+        return page.size();
+    return len;
+}
+
+// -----------------------------------------------------------------------------
+static size_t zstdSize(const std::vector<unsigned char> &page)
+{
+#if HAVE_LIBZSTD
+    std::vector<char> out(ZSTD_compressBound(page.size()));
+    size_t len = ZSTD_compress(out.data(), out.size(),
+                               page.data(), page.size(), 1);
+    return ZSTD_isError(len) ? page.size() : len;
+#else
+    return zlibSize(page);
+#endif
+}
+
+// -----------------------------------------------------------------------------
+static size_t fastSize(const std::vector<unsigned char> &page)
+{
+    // LZ4 is in the same class as LZO and snappy
+#if HAVE_LIBLZ4
+    std::vector<char> out(LZ4_compressBound(page.size()));
+    int len = LZ4_compress_default(
+        reinterpret_cast<const char *>(page.data()), out.data(),
+        page.size(), out.size());
+    return len > 0 ? size_t(len) : page.size();
+#else
+    return zlibSize(page);
+#endif
+}
+
+//{{{ DumpEstimator ------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+DumpEstimator::DumpEstimator(const VmcoreIndex &index, size_t pagesize)
+    : m_pagesize(pagesize), m_phnum(index.phnum()),
+      m_filePages(0), m_holePages(0),
+      m_sampled(0), m_sampledZero(0), m_compressed(FMT_ZSTD + 1, 0)
+{
+    Debug::debug()->trace("DumpEstimator::DumpEstimator(%zu)", pagesize);
+
+    if (!m_pagesize)
+        throw KError("Invalid page size.");
+
+    const std::vector<VmcoreIndex::LoadRange> &loads = index.loadRanges();
+    for (std::vector<VmcoreIndex::LoadRange>::const_iterator it =
+             loads.begin(); it != loads.end(); ++it) {
+        Segment seg;
+        seg.offset = it->offset;
+        seg.pages = (it->filesz + m_pagesize - 1) / m_pagesize;
+        m_filePages += seg.pages;
+        if (seg.pages)
+            m_segments.push_back(seg);
+
+        // memory beyond the file size is zero-filled
+        unsigned long long mempages =
+            (it->memsz + m_pagesize - 1) / m_pagesize;
+        if (mempages > seg.pages)
+            m_holePages += mempages - seg.pages;
+    }
+
+    Debug::debug()->dbg("%llu pages in file, %llu pages not in file",
+                        m_filePages, m_holePages);
+}
+
+// -----------------------------------------------------------------------------
+void DumpEstimator::sample(int fd, unsigned count, unsigned seed)
+{
+    Debug::debug()->trace("DumpEstimator::sample(%d, %u, %u)",
+                          fd, count, seed);
+
+    if (!m_filePages)
+        return;
+
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<unsigned long long>
+        dist(0, m_filePages - 1);
+    std::vector<unsigned char> page(m_pagesize);
+
+    for (unsigned i = 0; i < count; ++i) {
+        unsigned long long pfn = dist(rng);
+        std::vector<Segment>::const_iterator seg = m_segments.begin();
+        while (pfn >= seg->pages)
+            pfn -= (seg++)->pages;
+
+        // the last page of a segment may be partial
+        std::fill(page.begin(), page.end(), 0);
+        off_t offset = seg->offset + pfn * m_pagesize;
+        ssize_t bytes_read;
+        do {
+            bytes_read = pread(fd, page.data(), page.size(), offset);
+        } while (bytes_read < 0 && errno == EINTR);
+        if (bytes_read < 0)
+            throw KSystemError("Cannot read dump page", errno);
+
+        ++m_sampled;
+        if (isZeroPage(page)) {
+            ++m_sampledZero;
+            continue;
+        }
+
+        size_t zlib = zlibSize(page);
+        size_t fast = fastSize(page);
+        m_compressed[FMT_NONE] += m_pagesize;
+        m_compressed[FMT_ELF] += m_pagesize;
+        m_compressed[FMT_ZLIB] += std::min(zlib, m_pagesize);
+        m_compressed[FMT_LZO] += std::min(fast, m_pagesize);
+        m_compressed[FMT_SNAPPY] += std::min(fast, m_pagesize);
+        m_compressed[FMT_ZSTD] += std::min(zstdSize(page), m_pagesize);
+    }
+
+    Debug::debug()->dbg("Sampled %u pages, %u zero pages",
+                        m_sampled, m_sampledZero);
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long DumpEstimator::zeroPages() const
+{
+    unsigned long long ret = m_holePages;
+    if (m_sampled)
+        ret += m_filePages * m_sampledZero / m_sampled;
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long DumpEstimator::estimate(int dumplevel, Format format) const
+{
+    if (format == FMT_NONE)
+        return 0;
+
+    unsigned long long total = totalPages();
+    unsigned long long zero = zeroPages();
+    unsigned long long nonzero = total - zero;
+    bool excludeZero = dumplevel & DUMPLEVEL_ZERO;
+
+    if (format == FMT_ELF) {
+        // pages beyond the file size are not written
+        unsigned long long pages = excludeZero
+            ? nonzero
+            : total - m_holePages;
+        return m_pagesize + m_phnum * sizeof(Elf64_Phdr) +
+            pages * m_pagesize;
+    }
+
+    unsigned long long kept = excludeZero ? nonzero : total;
+    unsigned long long avg = m_pagesize;
+    if (m_sampled > m_sampledZero)
+        avg = m_compressed[format] / (m_sampled - m_sampledZero);
+
+    // header, sub-header and two bitmaps
+    unsigned long long bitmap = (total + 7) / 8;
+    bitmap = (bitmap + m_pagesize - 1) / m_pagesize * m_pagesize;
+    unsigned long long ret = 2 * m_pagesize + 2 * bitmap;
+
+    ret += kept * PAGE_DESC_SIZE + nonzero * avg;
+
+    // all zero pages share one copy
+    if (!excludeZero && zero)
+        ret += m_pagesize;
+
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+DumpEstimator::Format DumpEstimator::parseFormat(const string &name)
+{
+    static const struct {
+        const char *name;
+        Format format;
+    } formats[] = {
+        { "none", FMT_NONE },
+        { "elf", FMT_ELF },
+        { "compressed", FMT_ZLIB },
+        { "lzo", FMT_LZO },
+        { "snappy", FMT_SNAPPY },
+        { "zstd", FMT_ZSTD },
+    };
+
+    for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); ++i)
+        if (strcasecmp(name.c_str(), formats[i].name) == 0)
+            return formats[i].format;
+
+    throw KError("Unknown dump format: " + name + ".");
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,145 @@
+/*
+ * (c) 2026, SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#ifndef DUMPESTIMATOR_H
+#define DUMPESTIMATOR_H
+
+#include <string>
+#include <vector>
+
+#include "global.h"
+#include "vmcoreindex.h"
+
+/* dump level bit for zero pages (see makedumpfile -d) */
+#define DUMPLEVEL_ZERO          1
+#define DUMPLEVEL_MAX           31
+
+/* number of pages read by DumpEstimator::sample() */
+#define DUMPESTIMATOR_SAMPLES   256
+
+//{{{ DumpEstimator ------------------------------------------------------------
+
+/**
+ * Estimates the size of a saved dump before it is written.
+ *
+ * The number of pages is taken from the PT_LOAD segments of the dump.
+ * A few randomly chosen pages are read to estimate the fraction of zero
+ * pages and the compression ratio of the remaining pages.
+ *
+ * Only zero pages can be recognized by their contents. Exclusion of
+ * cache, user and free pages (dump level bits 2 to 16) is not taken into
+ * account, so the estimate is an upper bound for such dump levels.
+ */
+class DumpEstimator {
+
+    public:
+        /**
+         * Output formats (see KDUMP_DUMPFORMAT).
+         */
+        enum Format {
+            FMT_NONE,
+            FMT_ELF,
+            FMT_ZLIB,
+            FMT_LZO,
+            FMT_SNAPPY,
+            FMT_ZSTD
+        };
+
+        /**
+         * Creates a new estimator.
+         *
+         * @param[in] index headers of the dump
+         * @param[in] pagesize page size of the crashed kernel
+         */
+        DumpEstimator(const VmcoreIndex &index, size_t pagesize);
+
+        /**
+         * Read random pages of the dump.
+         *
+         * @param[in] fd file descriptor of the dump
+         * @param[in] count number of pages to read
+         * @param[in] seed seed for the random number generator
+         * @exception KError if reading the dump fails
+         */
+        void sample(int fd, unsigned count, unsigned seed);
+
+        /**
+         * Returns the total number of pages in the dump.
+         */
+        unsigned long long totalPages() const
+        { return m_filePages + m_holePages; }
+
+        /**
+         * Returns the number of sampled pages.
+         */
+        unsigned sampledPages() const
+        { return m_sampled; }
+
+        /**
+         * Returns the estimated number of zero pages.
+         */
+        unsigned long long zeroPages() const;
+
+        /**
+         * Estimate the size of the saved dump.
+         *
+         * @param[in] dumplevel makedumpfile dump level
+         * @param[in] format output format
+         * @return estimated size in bytes
+         */
+        unsigned long long estimate(int dumplevel, Format format) const;
+
+        /**
+         * Convert a KDUMP_DUMPFORMAT value.
+         *
+         * @param[in] name value of KDUMP_DUMPFORMAT (case-insensitive)
+         * @exception KError if the format is unknown
+         */
+        static Format parseFormat(const std::string &name);
+
+        /**
+         * Checks whether all pages excluded by a dump level can be
+         * recognized, i.e. whether estimate() is more than an upper bound.
+         *
+         * @param[in] dumplevel makedumpfile dump level
+         */
+        static bool isMeasurable(int dumplevel)
+        { return (dumplevel & ~DUMPLEVEL_ZERO) == 0; }
+
+    private:
+        struct Segment {
+            unsigned long long offset;
+            unsigned long long pages;
+        };
+
+        size_t m_pagesize;
+        size_t m_phnum;
+        std::vector<Segment> m_segments;
+        unsigned long long m_filePages;
+        unsigned long long m_holePages;
+
+        unsigned m_sampled;
+        unsigned m_sampledZero;
+        std::vector<unsigned long long> m_compressed;
+};
+
+//}}}
+
+#endif /* DUMPESTIMATOR_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -18,6 +18,11 @@
  */
 #include <string>
 #include <cstring>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
 
 #include "global.h"
 
@@ -146,6 +151,7 @@ static void smtp_monitor_cb(const char *buf, int buflen, int writing, void *arg)
     delete[] mybuffer;
 }
 
+//{{{ Email --------------------------------------------------------------------
 
 // -----------------------------------------------------------------------------
 Email::Email(const string &from)
@@ -238,6 +244,19 @@ void Email::send()
     if (ret == 0)
         throw KSmtpError("smtp_set_server() failed.", ret);
 
+    // do not wait for a stalled server longer than for the network
+    long timeout = config->KDUMP_NET_TIMEOUT.value() * 1000L;
+    if (timeout > 0) {
+        static const int which[] = {
+            Timeout_GREETING, Timeout_ENVELOPE, Timeout_DATA,
+            Timeout_TRANSFER, Timeout_DATA2
+        };
+        for (size_t i = 0; i < sizeof(which) / sizeof(which[0]); ++i)
+            smtp_set_timeout(session,
+                             which[i] | Timeout_OVERRIDE_RFC2822_MINIMUM,
+                             timeout);
+    }
+
     // use STARTLS
     // TODO: need to investigate why that does not work
     //smtp_starttls_enable(session, Starttls_ENABLED);
@@ -336,6 +355,73 @@ void Email::send()
         auth_destroy_context(authctx);
 }
 
+//}}}
+//{{{ MailQueue ----------------------------------------------------------------
+
+struct MailQueue::Shared {
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::deque<Email> queue;
+    bool running;
+
+    Shared()
+        : running(false)
+    { }
+};
+
+// -----------------------------------------------------------------------------
+MailQueue::MailQueue()
+    : m_shared(std::make_shared<Shared>())
+{
+}
+
+// -----------------------------------------------------------------------------
+void MailQueue::post(const Email &email)
+{
+    Debug::debug()->trace("MailQueue::post()");
+
+    std::lock_guard<std::mutex> lock(m_shared->mutex);
+    m_shared->queue.push_back(email);
+    if (!m_shared->running) {
+        std::thread(run, m_shared).detach();
+        m_shared->running = true;
+    }
+}
+
+// -----------------------------------------------------------------------------
+void MailQueue::run(std::shared_ptr<Shared> shared)
+{
+    std::unique_lock<std::mutex> lock(shared->mutex);
+    while (!shared->queue.empty()) {
+        Email email = shared->queue.front();
+        shared->queue.pop_front();
+        lock.unlock();
+
+        try {
+            email.send();
+            Debug::debug()->dbg("Email sent.");
+        } catch (const std::exception &err) {
+            Debug::debug()->info("Email failed: %s", err.what());
+        }
+
+        lock.lock();
+    }
+    shared->running = false;
+    shared->cond.notify_all();
+}
+
+// -----------------------------------------------------------------------------
+bool MailQueue::wait(int timeout)
+{
+    Debug::debug()->trace("MailQueue::wait(%d)", timeout);
+
+    std::unique_lock<std::mutex> lock(m_shared->mutex);
+    return m_shared->cond.wait_for(lock, std::chrono::seconds(timeout),
+                                   [this] { return !m_shared->running; });
+}
+
+//}}}
+
 #endif // HAVE_LIBESMTP
 
 // vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
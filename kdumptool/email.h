@@ -23,6 +23,8 @@
 #   include <libesmtp.h>
 #endif // HAVE_LIBESMTP
 
+#include <memory>
+
 #include "global.h"
 #include "stringvector.h"
 
@@ -125,6 +127,46 @@ class Email {
          std::string m_body;
 };
 
+//}}}
+//{{{ MailQueue ----------------------------------------------------------------
+
+/**
+ * Sends emails in the background, in the order they were posted.
+ *
+ * The sender thread is detached. If the caller stops waiting, the thread
+ * keeps trying until the process exits, but the caller is never blocked
+ * longer than it asks for.
+ */
+class MailQueue {
+
+    public:
+        /**
+         * Creates an empty queue.
+         */
+        MailQueue();
+
+        /**
+         * Queue an email. A sender thread is started if none is running.
+         *
+         * @param[in] email the email to send
+         */
+        void post(const Email &email);
+
+        /**
+         * Wait until all queued emails have been sent or have failed.
+         *
+         * @param[in] timeout max time to wait (in seconds)
+         * @return @c true if the queue is empty, @c false on timeout
+         */
+        bool wait(int timeout);
+
+    private:
+        struct Shared;
+        static void run(std::shared_ptr<Shared> shared);
+
+        std::shared_ptr<Shared> m_shared;
+};
+
 //}}}
 
 #endif // HAVE_LIBESMTP
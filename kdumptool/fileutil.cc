@@ -25,6 +25,7 @@
 #include <cstdlib>
 #include <libgen.h>
 #include <dirent.h>
+#include <fstream>
 #include <sstream>
 #include <algorithm>
 #include <typeinfo>
@@ -115,6 +116,42 @@ void FileUtil::mount(const std::string &device, const std::string &mountpoint,
     }
 }
 
+// -----------------------------------------------------------------------------
+bool FileUtil::saveCacheFile(const string &path, const string &contents)
+{
+    Debug::debug()->trace("FileUtil::saveCacheFile(%s)", path.c_str());
+
+    if (FilePath(DEFAULT_DUMP).exists()) {
+        Debug::debug()->dbg("Not updating %s in the kdump environment",
+                            path.c_str());
+        return false;
+    }
+
+    FilePath cachefile(path);
+    string tmpfile = path + ".tmp" + StringUtil::number2string(getpid());
+
+    try {
+        FilePath(cachefile.dirName()).mkdir(true);
+
+        std::ofstream fout(tmpfile.c_str());
+        if (!fout)
+            throw KSystemError("Cannot create " + tmpfile, errno);
+        fout << contents;
+        fout.close();
+        if (!fout)
+            throw KSystemError("Cannot write " + tmpfile, errno);
+
+        if (rename(tmpfile.c_str(), path.c_str()) != 0)
+            throw KSystemError("Cannot rename " + tmpfile, errno);
+    } catch (KError &e) {
+        Debug::debug()->dbg("Cannot update cache: %s", e.what());
+        unlink(tmpfile.c_str());
+        return false;
+    }
+
+    return true;
+}
+
 // -----------------------------------------------------------------------------
 void FileUtil::umount(const std::string &mountpoint)
 {
@@ -94,6 +94,20 @@ class FileUtil {
           * @exception KError if the mount did not succeed.
           */
          static void umount(const std::string &device);
+
+         /**
+          * Replaces a cache file atomically by writing a temporary file
+          * and renaming it. Caches are best-effort, so a read-only file
+          * system or missing permissions are not fatal. Nothing is written
+          * in the kdump environment (where /proc/vmcore exists), because
+          * the cache would be lost with the next reboot anyway.
+          *
+          * @param[in] path the cache file
+          * @param[in] contents the new contents of the cache file
+          * @return @c true if the cache file has been written
+          */
+         static bool saveCacheFile(const std::string &path,
+                                   const std::string &contents);
 };
 
 //}}}
@@ -18,6 +18,13 @@
  */
 #include <iostream>
 #include <string>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <system_error>
+#include <thread>
+#include <vector>
 #include <zlib.h>
 #include <libelf.h>
 #include <gelf.h>
@@ -28,11 +35,10 @@
 #include "debug.h"
 #include "findkernel.h"
 #include "util.h"
-#include "kerneltool.h"
+#include "kernelinfo.h"
 #include "configuration.h"
 #include "fileutil.h"
 #include "stringutil.h"
-#include "kconfig.h"
 #include "stringvector.h"
 #include "kernelpath.h"
 
@@ -54,6 +60,11 @@ using std::list;
  */
 #define MAXCPUS_KDUMP 1024
 
+/**
+ * Maximum number of threads used to inspect candidate kernel images.
+ */
+#define MAX_INSPECT_THREADS 4
+
 //{{{ FindKernel ---------------------------------------------------------------
 
 // -----------------------------------------------------------------------------
@@ -132,15 +143,21 @@ void FindKernel::execute()
 // -----------------------------------------------------------------------------
 bool FindKernel::suitableForKdump(const string &kernelImage, bool strict)
 {
-    KernelTool kt(kernelImage);
+    KernelInfo info(kernelImage);
+    return suitableForKdump(kernelImage, info, strict);
+}
 
+// -----------------------------------------------------------------------------
+bool FindKernel::suitableForKdump(const string &kernelImage,
+                                  const KernelInfo &info, bool strict)
+{
     // if that's not a special kdump kernel, it must be relocatable
     // TODO: check about start address, don't trust the naming
     if (isKdumpKernel(kernelImage)) {
         Debug::debug()->dbg("%s is kdump kernel, no need for relocatable check",
             kernelImage.c_str());
     } else {
-        bool relocatable = kt.isRelocatable();
+        bool relocatable = info.isRelocatable();
         Debug::debug()->dbg("%s is %s", kernelImage.c_str(),
             relocatable ? "relocatable" : "not relocatable");
         if (!relocatable) {
@@ -148,24 +165,15 @@ bool FindKernel::suitableForKdump(const string &kernelImage, bool strict)
         }
     }
 
-    Kconfig *kconfig = kt.retrieveKernelConfig();
-    KconfigValue kv;
-    bool isxen;
+    if (!info.hasConfig())
+        throw KError("Cannot retrieve the kernel configuration of " +
+                     kernelImage + ".");
 
     // Avoid Xenlinux kernels, because they do not run on bare metal
-    kv = kconfig->get("CONFIG_X86_64_XEN");
-    isxen = (kv.getType() == KconfigValue::T_TRISTATE &&
-             kv.getTristateValue() == KconfigValue::ON);
-    if (!isxen) {
-        kv = kconfig->get("CONFIG_X86_XEN");
-        isxen = (kv.getType() == KconfigValue::T_TRISTATE &&
-                 kv.getTristateValue() == KconfigValue::ON);
-    }
-    if (isxen) {
+    if (info.isXen()) {
         Debug::debug()->dbg("%s is a Xen kernel. Avoid.",
             kernelImage.c_str());
-	delete kconfig;
-	return false;
+        return false;
     }
 
     if (strict) {
@@ -174,28 +182,21 @@ bool FindKernel::suitableForKdump(const string &kernelImage, bool strict)
         // avoid large number of CPUs on x86 since that increases
         // memory size constraints of the capture kernel
         if (arch == "i386" || arch == "x86_64") {
-            kv = kconfig->get("CONFIG_NR_CPUS");
-            if (kv.getType() == KconfigValue::T_INTEGER &&
-                    kv.getIntValue() > MAXCPUS_KDUMP) {
+            if (info.nrCpus() > MAXCPUS_KDUMP) {
                 Debug::debug()->dbg("NR_CPUS of %s is %d >= %d. Avoid.",
-                    kernelImage.c_str(), kv.getIntValue(), MAXCPUS_KDUMP);
-                delete kconfig;
+                    kernelImage.c_str(), info.nrCpus(), MAXCPUS_KDUMP);
                 return false;
             }
         }
 
         // avoid realtime kernels
-        kv = kconfig->get("CONFIG_PREEMPT_RT");
-        if (kv.getType() != KconfigValue::T_INVALID) {
+        if (info.isPreemptRT()) {
             Debug::debug()->dbg("%s is realtime kernel. Avoid.",
                 kernelImage.c_str());
-            delete kconfig;
             return false;
         }
     }
 
-    delete kconfig;
-
     return true;
 }
 
@@ -222,6 +223,68 @@ FilePath FindKernel::findForVersion(const string &kernelver)
     return "";
 }
 
+// -----------------------------------------------------------------------------
+namespace {
+
+/**
+ * Result of inspecting one candidate kernel image.
+ */
+struct Inspection {
+    std::unique_ptr<KernelInfo> info;
+    std::exception_ptr error;
+};
+
+}
+
+// -----------------------------------------------------------------------------
+static void inspectWorker(const StringVector &images,
+                          std::vector<Inspection> &results,
+                          std::atomic<size_t> &next)
+{
+    size_t i;
+    while ((i = next++) < images.size()) {
+        try {
+            results[i].info.reset(new KernelInfo(images[i]));
+        } catch (...) {
+            results[i].error = std::current_exception();
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+static void inspectKernels(const StringVector &images,
+                           std::vector<Inspection> &results)
+{
+    Debug::debug()->trace("inspectKernels(%lu images)",
+                          (unsigned long)images.size());
+
+    results.resize(images.size());
+
+    size_t nthreads = std::thread::hardware_concurrency();
+    if (nthreads > MAX_INSPECT_THREADS)
+        nthreads = MAX_INSPECT_THREADS;
+    if (nthreads > images.size())
+        nthreads = images.size();
+
+    // the calling thread is one of the workers
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < nthreads; ++i) {
+        try {
+            threads.push_back(std::thread(inspectWorker, std::cref(images),
+                                          std::ref(results), std::ref(next)));
+        } catch (const std::system_error &e) {
+            Debug::debug()->dbg("Cannot start thread: %s", e.what());
+            break;
+        }
+    }
+    inspectWorker(images, results, next);
+
+    for (std::vector<std::thread>::iterator it = threads.begin();
+         it != threads.end(); ++it)
+        it->join();
+}
+
 // -----------------------------------------------------------------------------
 FilePath FindKernel::findKernelAuto()
 {
@@ -232,83 +295,63 @@ FilePath FindKernel::findKernelAuto()
     
     // $(uname -r) == KERNELVERSION
     // KERNELVERSION := BASEVERSION + '-' + FLAVOUR
-
-    // 1. Use BASEVERSION-kdump
     StringVector elements = runningkernel.split('-');
     elements[elements.size()-1] = "kdump";
-    string testkernel = elements.join('-');
-    Debug::debug()->dbg("---------------");
-    Debug::debug()->dbg("findKernelAuto: Trying %s", testkernel.c_str());
-    FilePath testkernelimage = findForVersion(testkernel);
-    if (testkernelimage.size() > 0 && suitableForKdump(testkernelimage, true)) {
-        return testkernelimage;
-    }
-
-    // 2. Use kdump
-    testkernel = "kdump";
-    Debug::debug()->dbg("---------------");
-    Debug::debug()->dbg("findKernelAuto: Trying %s", testkernel.c_str());
-    testkernelimage = findForVersion(testkernel);
-    if (testkernelimage.size() > 0 && suitableForKdump(testkernelimage, true)) {
-        return testkernelimage;
-    }
-
-    // 3. Use KERNELVERSION
-    testkernel = runningkernel;
-    Debug::debug()->dbg("---------------");
-    Debug::debug()->dbg("findKernelAuto: Trying %s", testkernel.c_str());
-    testkernelimage = findForVersion(testkernel);
-    if (testkernelimage.size() > 0 && suitableForKdump(testkernelimage, true)) {
-        return testkernelimage;
-    }
-
-    // 4. Use BASEVERSION-default
-    elements = runningkernel.split('-');
-    elements[elements.size()-1] = "default";
-    testkernel = elements.join('-');
-    Debug::debug()->dbg("---------------");
-    Debug::debug()->dbg("findKernelAuto: Trying %s", testkernel.c_str());
-    testkernelimage = findForVersion(testkernel);
-    if (testkernelimage.size() > 0 && suitableForKdump(testkernelimage, true)) {
-        return testkernelimage;
-    }
-
-    // 5. Use ""
-    testkernel = "";
-    Debug::debug()->dbg("---------------");
-    Debug::debug()->dbg("findKernelAuto: Trying %s", testkernel.c_str());
-    testkernelimage = findForVersion(testkernel);
-    if (testkernelimage.size() > 0 && suitableForKdump(testkernelimage, true)) {
-        return testkernelimage;
-    }
-
-    // 6. Use KERNELVERSION unstrict
-    testkernel = runningkernel;
-    Debug::debug()->dbg("---------------");
-    Debug::debug()->dbg("findKernelAuto: Trying %s", testkernel.c_str());
-    testkernelimage = findForVersion(testkernel);
-    if (testkernelimage.size() > 0 && suitableForKdump(testkernelimage, false)) {
-        return testkernelimage;
-    }
-
-    // 7. Use BASEVERSION-default unstrict
-    elements = runningkernel.split('-');
+    string basekdump = elements.join('-');
     elements[elements.size()-1] = "default";
-    testkernel = elements.join('-');
-    Debug::debug()->dbg("---------------");
-    Debug::debug()->dbg("findKernelAuto: Trying %s", testkernel.c_str());
-    testkernelimage = findForVersion(testkernel);
-    if (testkernelimage.size() > 0 && suitableForKdump(testkernelimage, false)) {
-        return testkernelimage;
+    string basedefault = elements.join('-');
+
+    // candidates in the order of preference
+    const struct {
+        string version;
+        bool strict;
+    } candidates[] = {
+        { basekdump, true },        // 1. Use BASEVERSION-kdump
+        { "kdump", true },          // 2. Use kdump
+        { runningkernel, true },    // 3. Use KERNELVERSION
+        { basedefault, true },      // 4. Use BASEVERSION-default
+        { "", true },               // 5. Use ""
+        { runningkernel, false },   // 6. Use KERNELVERSION unstrict
+        { basedefault, false },     // 7. Use BASEVERSION-default unstrict
+        { "", false },              // 8. Use "" unstrict
+    };
+    const size_t ncandidates = sizeof(candidates) / sizeof(candidates[0]);
+
+    // Find the images and inspect each of them only once, because the
+    // same image is often reached by several candidates (e.g. /boot/vmlinuz
+    // is a symlink to the image of the running kernel).
+    FilePath testkernelimage[ncandidates];
+    size_t inspection[ncandidates];
+    StringVector images;
+    for (size_t i = 0; i < ncandidates; ++i) {
+        testkernelimage[i] = findForVersion(candidates[i].version);
+        if (testkernelimage[i].empty())
+            continue;
+
+        string canonical = testkernelimage[i].getCanonicalPath();
+        inspection[i] = std::find(images.begin(), images.end(), canonical)
+            - images.begin();
+        if (inspection[i] == images.size())
+            images.push_back(canonical);
     }
 
-    // 8. Use "" unstrict
-    testkernel = "";
-    Debug::debug()->dbg("---------------");
-    Debug::debug()->dbg("findKernelAuto: Trying %s", testkernel.c_str());
-    testkernelimage = findForVersion(testkernel);
-    if (testkernelimage.size() > 0 && suitableForKdump(testkernelimage, false)) {
-        return testkernelimage;
+    std::vector<Inspection> results;
+    inspectKernels(images, results);
+
+    for (size_t i = 0; i < ncandidates; ++i) {
+        Debug::debug()->dbg("---------------");
+        Debug::debug()->dbg("findKernelAuto: Trying %s%s",
+            candidates[i].version.c_str(),
+            candidates[i].strict ? "" : " (unstrict)");
+        if (testkernelimage[i].empty())
+            continue;
+
+        const Inspection &result = results[inspection[i]];
+        if (result.error)
+            std::rethrow_exception(result.error);
+        if (suitableForKdump(testkernelimage[i], *result.info,
+                             candidates[i].strict))
+            return testkernelimage[i];
     }
 
     return "";
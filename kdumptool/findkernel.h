@@ -23,6 +23,8 @@
 #include "fileutil.h"
 #include "subcommand.h"
 
+class KernelInfo;
+
 //{{{ FindKernel ---------------------------------------------------------------
 
 /**
@@ -76,6 +78,19 @@ class FindKernel : public Subcommand {
          */
         bool suitableForKdump(const std::string &kernelImage, bool strict);
 
+        /**
+         * Checks if a kernel image is suitable for kdump, using the
+         * already retrieved properties of the image.
+         *
+         * @param[in] kernelImage full path to the kernel image
+         * @param[in] info properties of @p kernelImage
+         * @param[in] strict see above
+         * @return @c true if the kernel is suited, @c false otherwise
+         * @exception KError if the kernel configuration is not available
+         */
+        bool suitableForKdump(const std::string &kernelImage,
+                              const KernelInfo &info, bool strict);
+
         /**
          * Checks if the given kernel image is a kdump kernel. Currently
          * only name matching is done.
@@ -99,7 +114,8 @@ class FindKernel : public Subcommand {
 
         /**
          * Automatically finds a suitable kdump kernel. See kdump(5) for
-         * documentation which kernel is taken.
+         * documentation which kernel is taken. All candidate images are
+         * inspected up front, concurrently and each only once.
          *
          * @return the full path to the kernel image
          * @exception KError on any error
@@ -30,6 +30,7 @@
 //{{{ Constants ----------------------------------------------------------------
 
 #define DEFAULT_DUMP        "/proc/vmcore"
+#define DEFAULT_CACHE_DIR   "/var/cache/kdump"
 #define PATH_SEPARATOR      "/"
 
 //}}}
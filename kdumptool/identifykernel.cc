@@ -24,7 +24,7 @@
 #include "debug.h"
 #include "identifykernel.h"
 #include "util.h"
-#include "kerneltool.h"
+#include "kernelinfo.h"
 
 using std::string;
 using std::cout;
@@ -35,12 +35,14 @@ using std::endl;
 
 // -----------------------------------------------------------------------------
 IdentifyKernel::IdentifyKernel()
-    : m_checkRelocatable(false), m_checkType(false)
+    : m_checkRelocatable(false), m_checkType(false), m_printBuildId(false)
 {
     m_options.push_back(new FlagOption("relocatable", 'r', &m_checkRelocatable,
         "Check if the kernel is relocatable"));
     m_options.push_back(new FlagOption("type", 't', &m_checkType,
         "Print the type of the kernel"));
+    m_options.push_back(new FlagOption("build-id", 'b', &m_printBuildId,
+        "Print the GNU build-id of the kernel"));
 }
 
 // -----------------------------------------------------------------------------
@@ -54,8 +56,8 @@ void IdentifyKernel::parseArgs(const StringVector &args)
 {
     Debug::debug()->trace(__FUNCTION__);
 
-    if (!m_checkType && !m_checkRelocatable)
-        throw KError("You have to specify either the -r or the -t flag.");
+    if (!m_checkType && !m_checkRelocatable && !m_printBuildId)
+        throw KError("You have to specify the -r, -t or -b flag.");
 
     if (args.size() != 1)
         throw KError("You have to specify the kernel image for the "
@@ -71,10 +73,10 @@ void IdentifyKernel::execute()
 {
     Debug::debug()->trace(__FUNCTION__);
 
-    KernelTool kt(m_kernelImage);
+    KernelInfo info(m_kernelImage);
 
     if (m_checkType) {
-        switch (kt.getKernelType()) {
+        switch (info.getKernelType()) {
             case KernelTool::KT_X86:
                 cout << "x86" << endl;
                 break;
@@ -84,6 +86,15 @@ void IdentifyKernel::execute()
             case KernelTool::KT_ELF_GZ:
                 cout << "ELF gzip" << endl;
                 break;
+            case KernelTool::KT_ELF_XZ:
+                cout << "ELF xz" << endl;
+                break;
+            case KernelTool::KT_ELF_ZSTD:
+                cout << "ELF zstd" << endl;
+                break;
+            case KernelTool::KT_ELF_LZ4:
+                cout << "ELF lz4" << endl;
+                break;
             case KernelTool::KT_S390:
                 cout << "S390" << endl;
                 break;
@@ -96,13 +107,19 @@ void IdentifyKernel::execute()
     }
 
     if (m_checkRelocatable) {
-        if (kt.isRelocatable())
+        if (info.isRelocatable())
             cout << "Relocatable" << endl;
         else {
             cout << "Not relocatable" << endl;
             setErrorCode(NOT_RELOCATABLE);
         }
     }
+
+    if (m_printBuildId) {
+        if (info.getBuildId().empty())
+            throw KError("The kernel image has no build-id.");
+        cout << info.getBuildId() << endl;
+    }
 }
 
 //}}}
@@ -77,6 +77,7 @@ class IdentifyKernel : public Subcommand {
     private:
         bool m_checkRelocatable;
         bool m_checkType;
+        bool m_printBuildId;
         std::string m_kernelImage;
 };
 
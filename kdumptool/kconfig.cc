@@ -24,6 +24,7 @@
 #include <cstring>
 #include <memory>
 #include <cerrno>
+#include <algorithm>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -225,27 +226,24 @@ void Kconfig::readFromConfig(const string &configFile)
     Debug::debug()->trace("Kconfig::readFromConfig(%s)", configFile.c_str());
 
     gzFile fp;
-    char line[BUFSIZ];
+    char buffer[BUFSIZ];
+    int len;
+    string config;
 
     fp = gzopen(configFile.c_str(), "r");
     if (!fp) {
         throw KError(string("Opening '") + configFile + string("' failed."));
     }
 
-    try {
-        while (gzgets(fp, line, BUFSIZ) != NULL) {
-            string name;
-            KconfigValue val = KconfigValue::fromString(line, name);
-            if (val.getType() != KconfigValue::T_INVALID) {
-                m_configs[name] = val;
-            }
-        }
-    } catch (...) {
-        gzclose(fp);
-        throw;
+    while ((len = gzread(fp, buffer, sizeof buffer)) > 0)
+        config.append(buffer, len);
+    gzclose(fp);
+
+    if (len < 0) {
+        throw KError(string("Reading '") + configFile + string("' failed."));
     }
 
-    gzclose(fp);
+    readFromString(config);
 }
 
 // -----------------------------------------------------------------------------
@@ -253,17 +251,7 @@ void Kconfig::readFromKernel(const KernelTool &kt)
 {
     Debug::debug()->trace("Kconfig::readFromKernel(%s)", kt.toString().c_str());
 
-    stringstream ss;
-    ss << kt.extractKernelConfig();
-
-    string line;
-    while (getline(ss, line)) {
-        string name;
-        KconfigValue val = KconfigValue::fromString(line, name);
-        if (val.getType() != KconfigValue::T_INVALID) {
-            m_configs[name] = val;
-        }
-    }
+    readFromString(kt.extractKernelConfig());
 }
 
 // -----------------------------------------------------------------------------
@@ -271,15 +259,159 @@ void Kconfig::readFromKernel(const string &kernelImage)
 {
     Debug::debug()->trace("Kconfig::readFromKernel(%s)", kernelImage.c_str());
 
-    stringstream ss;
     KernelTool kt(kernelImage);
     return readFromKernel(kt);
 }
 
 // -----------------------------------------------------------------------------
-KconfigValue Kconfig::get(const string &option)
+void Kconfig::readFromString(const string &config)
+{
+    m_config = config;
+    buildIndex();
+}
+
+// -----------------------------------------------------------------------------
+namespace {
+
+/**
+ * Orders index entries by option name. Entries with the same name keep
+ * their relative order (with std::stable_sort), so the last one is the
+ * one that takes effect, like in the kernel build.
+ */
+class EntryNameLess {
+    public:
+        EntryNameLess(const char *base)
+            : m_base(base)
+        { }
+
+        template <typename E>
+        bool operator()(const E &a, const E &b) const
+        {
+            return compare(m_base + a.name, a.nameLen,
+                           m_base + b.name, b.nameLen) < 0;
+        }
+
+        static int compare(const char *a, size_t alen,
+                           const char *b, size_t blen)
+        {
+            int ret = memcmp(a, b, alen < blen ? alen : blen);
+            if (ret == 0 && alen != blen)
+                ret = alen < blen ? -1 : 1;
+            return ret;
+        }
+
+    private:
+        const char *m_base;
+};
+
+}
+
+// -----------------------------------------------------------------------------
+void Kconfig::buildIndex()
+{
+    static const char notSet[] = "is not set";
+    const char *base = m_config.data();
+    const char *end = base + m_config.size();
+    const char *line = base;
+
+    m_index.clear();
+    while (line < end) {
+        const char *eol = static_cast<const char *>(
+            memchr(line, '\n', end - line));
+        if (!eol)
+            eol = end;
+
+        size_t len = eol - line;
+        Entry e;
+        e.line = line - base;
+        e.lineLen = len;
+
+        if (len == 0) {
+            // empty line
+        } else if (line[0] == '#') {
+            // comment unless it is "# CONFIG_FOO is not set"
+            if (memmem(line, len, notSet, sizeof(notSet) - 1)) {
+                if (len < 3 || line[1] != ' ' || !isalpha(line[2]))
+                    throw KError("Invalid line: '" + string(line, len) + "'.");
+                const char *name = line + 2;
+                const char *space = static_cast<const char *>(
+                    memchr(name, ' ', eol - name));
+                e.name = name - base;
+                e.nameLen = space - name;
+                m_index.push_back(e);
+            }
+        } else {
+            const char *equal = static_cast<const char *>(
+                memchr(line, '=', len));
+            if (!equal)
+                throw KError("Invalid line: '" + string(line, len) + "'.");
+            if (equal + 1 == eol)
+                throw KError("There must be at least one character after =: '"
+                             + string(line, len) + "'.");
+            e.name = line - base;
+            e.nameLen = equal - line;
+            m_index.push_back(e);
+        }
+
+        line = eol + 1;
+    }
+
+    // sort by name and keep only the last entry for each option
+    EntryNameLess less(base);
+    std::stable_sort(m_index.begin(), m_index.end(), less);
+
+    std::vector<Entry>::iterator out = m_index.begin();
+    for (std::vector<Entry>::iterator it = m_index.begin();
+         it != m_index.end(); ++it) {
+        std::vector<Entry>::iterator next = it + 1;
+        if (next != m_index.end() && !less(*it, *next))
+            continue;
+        *out++ = *it;
+    }
+    m_index.erase(out, m_index.end());
+
+    Debug::debug()->dbg("Kconfig: %lu options",
+                        (unsigned long)m_index.size());
+}
+
+// -----------------------------------------------------------------------------
+const Kconfig::Entry *Kconfig::find(const string &option) const
+{
+    const char *base = m_config.data();
+    size_t lo = 0, hi = m_index.size();
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const Entry &e = m_index[mid];
+        int cmp = EntryNameLess::compare(base + e.name, e.nameLen,
+                                         option.data(), option.size());
+        if (cmp == 0)
+            return &e;
+        else if (cmp < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return NULL;
+}
+
+// -----------------------------------------------------------------------------
+KconfigValue Kconfig::get(const string &option) const
+{
+    const Entry *e = find(option);
+    if (!e)
+        return KconfigValue();
+
+    string name;
+    return KconfigValue::fromString(m_config.substr(e->line, e->lineLen), name);
+}
+
+// -----------------------------------------------------------------------------
+string Kconfig::getLine(const string &option) const
 {
-    return m_configs[option];
+    const Entry *e = find(option);
+    return e ? m_config.substr(e->line, e->lineLen) : string();
 }
 
 //}}}
@@ -21,6 +21,8 @@
 
 #include <iostream>
 #include <ctime>
+#include <string>
+#include <vector>
 
 #include "global.h"
 #include "kerneltool.h"
@@ -141,6 +143,11 @@ std::ostream& operator<<(std::ostream& os, const KconfigValue& v);
 
 /**
  * Represents the kernel configuration (.config).
+ *
+ * The configuration is kept as a raw text buffer. Reading it only builds
+ * a sorted index of option names, and values are parsed on demand by
+ * get(), because callers typically query only a handful of options out
+ * of many thousands.
  */
 class Kconfig {
 
@@ -180,6 +187,15 @@ class Kconfig {
          */
         void readFromKernel(const KernelTool &kt);
 
+        /**
+         * Reads the configuration from a string in .config format.
+         * Any previously read configuration is replaced.
+         *
+         * @param[in] config the configuration text
+         * @exception KError if the configuration contains invalid lines
+         */
+        void readFromString(const std::string &config);
+
         /**
          * Returns the configuration value for a specific option.
          *
@@ -190,10 +206,46 @@ class Kconfig {
          * @return the configuration option value, the function returns
          *         a KconfigValue with type T_INVALID.
          */
-        KconfigValue get(const std::string &option);
+        KconfigValue get(const std::string &option) const;
+
+        /**
+         * Returns the line of the configuration which sets an option,
+         * e.g. "CONFIG_NR_CPUS=64" or "# CONFIG_SMP is not set".
+         *
+         * @param[in] option the name of the option (see get())
+         * @return the line without the trailing newline, or an empty
+         *         string if the option is not present
+         */
+        std::string getLine(const std::string &option) const;
+
+        /**
+         * Returns the number of options in the configuration.
+         */
+        size_t size() const
+        { return m_index.size(); }
 
     private:
-        std::map<std::string, KconfigValue> m_configs;
+        struct Entry {
+            size_t name, nameLen;
+            size_t line, lineLen;
+        };
+
+        /**
+         * Build m_index from m_config.
+         *
+         * @exception KError if the configuration contains invalid lines
+         */
+        void buildIndex();
+
+        /**
+         * Find the index entry for @p option.
+         *
+         * @return the entry, or @c NULL if the option is not present
+         */
+        const Entry *find(const std::string &option) const;
+
+        std::string m_config;
+        std::vector<Entry> m_index;
 };
 
 //}}}
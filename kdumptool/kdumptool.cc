@@ -30,6 +30,9 @@
 #include "util.h"
 #include "configuration.h"
 #include "optionparser.h"
+#include "fileutil.h"
+#include "kernelinfo.h"
+#include "configparser.h"
 #include "config.h"
 
 using std::list;
@@ -65,6 +68,11 @@ KdumpTool::KdumpTool()
 KdumpTool::~KdumpTool()
 {
     Debug::debug()->trace("KdumpTool::~KdumpTool()");
+
+    // cache updates are written once, when all work is done
+    KernelInfo::flushCache();
+    ShellConfigParser::flushCache();
+
     delete m_subcommand;
 }
 
@@ -99,6 +107,11 @@ void KdumpTool::parseCommandline(int argc, char *argv[])
     StringOption configFileOption(
         "configfile", 'F', &m_configfile,
         "Use the specified configuration file instead of " DEFAULT_CONFIG);
+    string cacheDir;
+    StringOption cacheDirOption(
+        "cachedir", 'C', &cacheDir,
+        "Use the specified cache directory instead of " DEFAULT_CACHE_DIR
+        " (empty to disable caching)");
 
     // add global options
     optionParser.addGlobalOption(&helpOption);
@@ -107,6 +120,7 @@ void KdumpTool::parseCommandline(int argc, char *argv[])
     optionParser.addGlobalOption(&debugOption);
     optionParser.addGlobalOption(&logFileOption);
     optionParser.addGlobalOption(&configFileOption);
+    optionParser.addGlobalOption(&cacheDirOption);
 
     optionParser.addSubcommands(m_subcommandList);
 
@@ -132,6 +146,19 @@ void KdumpTool::parseCommandline(int argc, char *argv[])
     } else if (debugEnabled)
         Debug::debug()->setStderrLevel(Debug::DL_TRACE);
 
+    // caches
+    if (cacheDirOption.isSet()) {
+        FilePath kernels, config;
+        if (!cacheDir.empty()) {
+            kernels = cacheDir;
+            kernels.appendPath("kernels");
+            config = cacheDir;
+            config.appendPath("config");
+        }
+        KernelInfo::setCacheFile(kernels);
+        ShellConfigParser::setCacheFile(config);
+    }
+
     // get subcommand
     m_subcommand = optionParser.getSubcommand();
     if (!m_subcommand)
@@ -179,6 +206,20 @@ void KdumpTool::printVersion()
     cerr << "disabled";
 #endif
 
+    cerr << " - ";
+
+    // kernel decompression
+    cerr << "Kernel compression: gzip";
+#if HAVE_LIBLZMA
+    cerr << " xz";
+#endif
+#if HAVE_LIBZSTD
+    cerr << " zstd";
+#endif
+#if HAVE_LIBLZ4
+    cerr << " lz4";
+#endif
+
     cerr << endl;
 }
 
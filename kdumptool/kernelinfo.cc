@@ -0,0 +1,298 @@
+/*
+ * (c) 2026, SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include <cerrno>
+#include <fstream>
+#include <memory>
+#include <sstream>
+
+#include <sys/stat.h>
+
+#include "global.h"
+#include "debug.h"
+#include "kernelinfo.h"
+#include "kconfig.h"
+#include "kernelpath.h"
+#include "fileutil.h"
+
+using std::string;
+using std::ifstream;
+using std::istringstream;
+using std::ostringstream;
+using std::unique_ptr;
+
+// First line of the cache file; bump the version if the format changes
+#define CACHE_SIGNATURE "# kdump kernel cache v4"
+
+//{{{ KernelInfo ---------------------------------------------------------------
+
+string KernelInfo::m_cacheFile(KERNELINFO_CACHE);
+bool KernelInfo::m_cacheLoaded;
+bool KernelInfo::m_cacheDirty;
+std::map<string, KernelInfo::Data> KernelInfo::m_cache;
+std::mutex KernelInfo::m_cacheMutex;
+
+// -----------------------------------------------------------------------------
+static bool isTristateOn(Kconfig *kconfig, const string &name)
+{
+    KconfigValue kv = kconfig->get(name);
+    return kv.getType() == KconfigValue::T_TRISTATE &&
+        kv.getTristateValue() == KconfigValue::ON;
+}
+
+// -----------------------------------------------------------------------------
+KernelInfo::KernelInfo(const string &image)
+    : m_cached(false)
+{
+    Debug::debug()->trace("KernelInfo::KernelInfo(%s)", image.c_str());
+
+    struct stat st;
+    if (stat(image.c_str(), &st) != 0)
+        throw KSystemError("Cannot stat " + image, errno);
+
+    m_data.dev = st.st_dev;
+    m_data.ino = st.st_ino;
+    m_data.size = st.st_size;
+    m_data.mtime_sec = st.st_mtim.tv_sec;
+    m_data.mtime_nsec = st.st_mtim.tv_nsec;
+
+    // the config file in /boot takes precedence over the image
+    m_data.config_size = -1;
+    m_data.config_mtime_sec = -1;
+    m_data.config_mtime_nsec = -1;
+    KernelPath kpath(image);
+    if (!kpath.version().empty() &&
+        stat(kpath.configPath().c_str(), &st) == 0) {
+        m_data.config_size = st.st_size;
+        m_data.config_mtime_sec = st.st_mtim.tv_sec;
+        m_data.config_mtime_nsec = st.st_mtim.tv_nsec;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_cacheMutex);
+        loadCache();
+        std::map<string, Data>::const_iterator it = m_cache.find(image);
+        if (it != m_cache.end() && sameFiles(it->second, m_data)) {
+            m_data = it->second;
+            m_cached = true;
+            Debug::debug()->dbg("Kernel image %s found in cache",
+                                image.c_str());
+            return;
+        }
+    }
+
+    // the expensive part runs without holding the lock
+    compute(image);
+
+    std::lock_guard<std::mutex> lock(m_cacheMutex);
+    m_cache[image] = m_data;
+    m_cacheDirty = true;
+}
+
+// -----------------------------------------------------------------------------
+bool KernelInfo::sameFiles(const Data &cached, const Data &current)
+{
+    return cached.dev == current.dev &&
+        cached.ino == current.ino &&
+        cached.size == current.size &&
+        cached.mtime_sec == current.mtime_sec &&
+        cached.mtime_nsec == current.mtime_nsec &&
+        cached.config_size == current.config_size &&
+        cached.config_mtime_sec == current.config_mtime_sec &&
+        cached.config_mtime_nsec == current.config_mtime_nsec;
+}
+
+// -----------------------------------------------------------------------------
+bool KernelInfo::isRelocatable() const
+{
+    if (m_data.type == KernelTool::KT_NONE)
+        throw KError("Invalid kernel type.");
+    return m_data.relocatable;
+}
+
+// -----------------------------------------------------------------------------
+void KernelInfo::compute(const string &image)
+{
+    Debug::debug()->trace("KernelInfo::compute(%s)", image.c_str());
+
+    KernelTool kt(image);
+
+    m_data.type = kt.getKernelType();
+    m_data.relocatable = false;
+    m_data.hasConfig = false;
+    m_data.nrCpus = -1;
+    m_data.preemptRT = false;
+    m_data.xen = false;
+    m_data.configRelocatable = false;
+    m_data.buildId.clear();
+    if (m_data.type == KernelTool::KT_NONE) {
+        m_data.arch = "unknown";
+        return;
+    }
+
+    m_data.arch = kt.getArch();
+
+    // a missing build-id does not make the image unusable
+    try {
+        m_data.buildId = kt.getBuildId();
+    } catch (KError &e) {
+        Debug::debug()->dbg("%s: %s", image.c_str(), e.what());
+    }
+
+    // the configuration is retrieved only once, because that may
+    // require decompressing the whole image
+    unique_ptr<Kconfig> kconfig;
+    try {
+        kconfig.reset(kt.retrieveKernelConfig());
+    } catch (KError &e) {
+        Debug::debug()->dbg("%s: %s (assume non-relocatable)",
+                            image.c_str(), e.what());
+        Kconfig empty;
+        m_data.relocatable = kt.isRelocatable(empty);
+        return;
+    }
+
+    m_data.relocatable = kt.isRelocatable(*kconfig);
+    m_data.hasConfig = true;
+
+    KconfigValue kv = kconfig->get("CONFIG_NR_CPUS");
+    if (kv.getType() == KconfigValue::T_INTEGER)
+        m_data.nrCpus = kv.getIntValue();
+
+    kv = kconfig->get("CONFIG_PREEMPT_RT");
+    m_data.preemptRT = (kv.getType() != KconfigValue::T_INVALID);
+
+    m_data.xen = isTristateOn(kconfig.get(), "CONFIG_X86_64_XEN") ||
+        isTristateOn(kconfig.get(), "CONFIG_X86_XEN");
+    m_data.configRelocatable =
+        isTristateOn(kconfig.get(), "CONFIG_RELOCATABLE");
+}
+
+// -----------------------------------------------------------------------------
+void KernelInfo::setCacheFile(const string &path)
+{
+    std::lock_guard<std::mutex> lock(m_cacheMutex);
+    m_cacheFile = path;
+    m_cacheLoaded = false;
+    m_cacheDirty = false;
+    m_cache.clear();
+}
+
+// -----------------------------------------------------------------------------
+void KernelInfo::flushCache()
+{
+    std::lock_guard<std::mutex> lock(m_cacheMutex);
+    if (m_cacheDirty)
+        saveCache();
+    m_cacheDirty = false;
+}
+
+// -----------------------------------------------------------------------------
+void KernelInfo::loadCache()
+{
+    if (m_cacheLoaded)
+        return;
+    m_cacheLoaded = true;
+
+    if (m_cacheFile.empty())
+        return;
+
+    Debug::debug()->trace("KernelInfo::loadCache(): %s", m_cacheFile.c_str());
+
+    ifstream fin(m_cacheFile.c_str());
+    if (!fin)
+        return;
+
+    string line;
+    if (!getline(fin, line) || line != CACHE_SIGNATURE) {
+        Debug::debug()->dbg("Ignoring %s: unknown format",
+                            m_cacheFile.c_str());
+        return;
+    }
+
+    // Each line has the form:
+    //   dev ino size mtime_sec mtime_nsec
+    //   config_size config_mtime_sec config_mtime_nsec type relocatable
+    //   arch hasconfig nr_cpus preempt_rt xen config_relocatable
+    //   build_id path
+    // where build_id is "-" if the image has no build-id
+    while (getline(fin, line)) {
+        istringstream ss(line);
+        Data data;
+        int type, relocatable, hasConfig, preemptRT, xen, configRelocatable;
+        string buildId, path;
+
+        ss >> data.dev >> data.ino >> data.size
+           >> data.mtime_sec >> data.mtime_nsec
+           >> data.config_size >> data.config_mtime_sec
+           >> data.config_mtime_nsec
+           >> type >> relocatable >> data.arch
+           >> hasConfig >> data.nrCpus >> preemptRT >> xen
+           >> configRelocatable >> buildId;
+        if (!ss || ss.get() != ' ' || !getline(ss, path) || path.empty() ||
+            type < KernelTool::KT_ELF || type > KernelTool::KT_NONE) {
+            Debug::debug()->dbg("Ignoring malformed cache line: %s",
+                                line.c_str());
+            continue;
+        }
+
+        data.type = KernelTool::KernelType(type);
+        data.relocatable = relocatable;
+        data.hasConfig = hasConfig;
+        data.preemptRT = preemptRT;
+        data.xen = xen;
+        data.configRelocatable = configRelocatable;
+        data.buildId = (buildId == "-") ? string() : buildId;
+        m_cache[path] = data;
+    }
+}
+
+// -----------------------------------------------------------------------------
+void KernelInfo::saveCache()
+{
+    if (m_cacheFile.empty())
+        return;
+
+    Debug::debug()->trace("KernelInfo::saveCache(): %s", m_cacheFile.c_str());
+
+    ostringstream ss;
+    ss << CACHE_SIGNATURE << '\n';
+    for (std::map<string, Data>::const_iterator it = m_cache.begin();
+         it != m_cache.end(); ++it) {
+        const Data &d = it->second;
+
+        if (!FilePath(it->first).exists())
+            continue;
+
+        ss << d.dev << ' ' << d.ino << ' ' << d.size << ' '
+           << d.mtime_sec << ' ' << d.mtime_nsec << ' '
+           << d.config_size << ' ' << d.config_mtime_sec << ' '
+           << d.config_mtime_nsec << ' '
+           << int(d.type) << ' ' << int(d.relocatable) << ' '
+           << d.arch << ' ' << int(d.hasConfig) << ' '
+           << d.nrCpus << ' ' << int(d.preemptRT) << ' '
+           << int(d.xen) << ' ' << int(d.configRelocatable) << ' '
+           << (d.buildId.empty() ? "-" : d.buildId) << ' '
+           << it->first << '\n';
+    }
+    FileUtil::saveCacheFile(m_cacheFile, ss.str());
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
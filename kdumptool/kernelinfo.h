@@ -0,0 +1,205 @@
+/*
+ * (c) 2026, SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#ifndef KERNELINFO_H
+#define KERNELINFO_H
+
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "global.h"
+#include "kerneltool.h"
+
+/**
+ * Default location of the persistent kernel image cache.
+ */
+#define KERNELINFO_CACHE DEFAULT_CACHE_DIR "/kernels"
+
+//{{{ KernelInfo ---------------------------------------------------------------
+
+/**
+ * Properties of a kernel image which are needed to decide whether the
+ * image can be used for kdump.
+ *
+ * Finding these properties may require decompressing the whole image
+ * and parsing the embedded kernel configuration, so the results are
+ * kept in a persistent cache. Cache entries are keyed by the image path
+ * and validated against the device, inode, size and modification time
+ * of the file, and against the size and modification time of the
+ * matching config file in /boot (which is preferred over the embedded
+ * configuration). New entries are written by flushCache(). The cache is
+ * best-effort: if it cannot be read or written, the properties are
+ * simply computed again.
+ *
+ * Objects for different images may be created concurrently from several
+ * threads.
+ */
+class KernelInfo {
+
+    public:
+        /**
+         * Get the properties of a kernel image.
+         *
+         * @param[in] image path to the kernel image
+         *
+         * @exception KError if the image cannot be read
+         */
+        KernelInfo(const std::string &image);
+
+        /**
+         * Returns the type of the kernel image.
+         */
+        KernelTool::KernelType getKernelType() const
+        { return m_data.type; }
+
+        /**
+         * Checks if the kernel is relocatable.
+         *
+         * @exception KError if the file is not a kernel image
+         */
+        bool isRelocatable() const;
+
+        /**
+         * Returns the architecture of the kernel image.
+         */
+        const std::string &getArch() const
+        { return m_data.arch; }
+
+        /**
+         * Checks whether the kernel configuration could be retrieved.
+         * All the configuration values below are meaningful only if
+         * this function returns @c true.
+         */
+        bool hasConfig() const
+        { return m_data.hasConfig; }
+
+        /**
+         * Returns CONFIG_NR_CPUS, or -1 if it is not set.
+         */
+        int nrCpus() const
+        { return m_data.nrCpus; }
+
+        /**
+         * Checks whether CONFIG_PREEMPT_RT is set.
+         */
+        bool isPreemptRT() const
+        { return m_data.preemptRT; }
+
+        /**
+         * Checks whether this is a Xenlinux kernel
+         * (CONFIG_X86_64_XEN or CONFIG_X86_XEN).
+         */
+        bool isXen() const
+        { return m_data.xen; }
+
+        /**
+         * Checks whether CONFIG_RELOCATABLE is set.
+         */
+        bool isConfigRelocatable() const
+        { return m_data.configRelocatable; }
+
+        /**
+         * Returns the GNU build-id of the image, or an empty string if
+         * the image has none (e.g. a bzImage).
+         */
+        const std::string &getBuildId() const
+        { return m_data.buildId; }
+
+        /**
+         * Checks whether the properties were taken from the cache.
+         */
+        bool fromCache() const
+        { return m_cached; }
+
+        /**
+         * Set the location of the persistent cache. An empty path
+         * disables the persistent cache.
+         *
+         * @param[in] path path to the cache file
+         */
+        static void setCacheFile(const std::string &path);
+
+        /**
+         * Write the persistent cache if any entries have been added.
+         */
+        static void flushCache();
+
+    protected:
+        struct Data {
+            unsigned long long dev, ino, size;
+            long long mtime_sec, mtime_nsec;
+            // size and mtime of the config file; -1 if there is none
+            long long config_size, config_mtime_sec, config_mtime_nsec;
+            KernelTool::KernelType type;
+            bool relocatable;
+            std::string arch;
+            bool hasConfig;
+            int nrCpus;
+            bool preemptRT;
+            bool xen;
+            bool configRelocatable;
+            std::string buildId;
+        };
+
+        /**
+         * Compute the properties from the kernel image.
+         *
+         * @param[in] image path to the kernel image
+         *
+         * @exception KError if the image cannot be read
+         */
+        void compute(const std::string &image);
+
+        /**
+         * Load the cache file (once per process).
+         * The caller must hold m_cacheMutex.
+         */
+        static void loadCache();
+
+        /**
+         * Checks whether a cache entry matches the files.
+         *
+         * @param[in] cached the cache entry
+         * @param[in] current file properties of the image and config
+         */
+        static bool sameFiles(const Data &cached, const Data &current);
+
+        /**
+         * Write the cache file, replacing the old one atomically.
+         * Entries for images which no longer exist are dropped.
+         * The caller must hold m_cacheMutex.
+         */
+        static void saveCache();
+
+    private:
+        Data m_data;
+        bool m_cached;
+
+        static std::string m_cacheFile;
+        static bool m_cacheLoaded;
+        static bool m_cacheDirty;
+        static std::map<std::string, Data> m_cache;
+        static std::mutex m_cacheMutex;
+};
+
+//}}}
+
+#endif /* KERNELINFO_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -22,6 +22,7 @@
 #include <memory>
 #include <sstream>
 #include <list>
+#include <map>
 
 #include <unistd.h>
 #include <sys/types.h>
@@ -33,6 +34,8 @@
 #include <gelf.h>
 
 #include "kerneltool.h"
+#include "bootheader.h"
+#include "decompress.h"
 #include "util.h"
 #include "global.h"
 #include "debug.h"
@@ -47,49 +50,6 @@ using std::unique_ptr;
 using std::stringstream;
 using std::list;
 
-/* x86 boot header for bzImage */
-#define X86_HEADER_OFF_START        0x202
-#define X86_HEADER_OFF_VERSION      0x0206
-#define X86_HEADER_OFF_RELOCATABLE  0x0234
-#define X86_HEADER_OFF_MAGIC        0x53726448
-#define X86_HEADER_RELOCATABLE_VER  0x0205
-
-/* S/390 VM boot image */
-#define S390_HEADER_OFF_IPLSTART    4
-#define S390_HEADER_SIZE_IPLSTART   4
-static const unsigned char S390_HEADER[] = {
-  0x00, 0x08, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00,
-  0x02, 0x00, 0x00, 0x18, 0x60, 0x00, 0x00, 0x50,
-  0x02, 0x00, 0x00, 0x68, 0x60, 0x00, 0x00, 0x50,
-  0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40,
-  0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40,
-  0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40,
-  0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40,
-  0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40,
-  0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40,
-  0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40,
-  0x02, 0x00, 0x00, 0xf0, 0x60, 0x00, 0x00, 0x50,
-  0x02, 0x00, 0x01, 0x40, 0x60, 0x00, 0x00, 0x50,
-  0x02, 0x00, 0x01, 0x90, 0x60, 0x00, 0x00, 0x50,
-  0x02, 0x00, 0x01, 0xe0, 0x60, 0x00, 0x00, 0x50,
-  0x02, 0x00, 0x02, 0x30, 0x60, 0x00, 0x00, 0x50,
-  0x02, 0x00, 0x02, 0x80, 0x60, 0x00, 0x00, 0x50,
-  0x02, 0x00, 0x02, 0xd0, 0x60, 0x00, 0x00, 0x50,
-  0x02, 0x00, 0x03, 0x20, 0x60, 0x00, 0x00, 0x50,
-  0x02, 0x00, 0x03, 0x70, 0x60, 0x00, 0x00, 0x50,
-  0x02, 0x00, 0x03, 0xc0, 0x60, 0x00, 0x00, 0x50,
-  0x02, 0x00, 0x04, 0x10, 0x60, 0x00, 0x00, 0x50,
-  0x02, 0x00, 0x04, 0x60, 0x60, 0x00, 0x00, 0x50,
-  0x02, 0x00, 0x04, 0xb0, 0x60, 0x00, 0x00, 0x50,
-  0x02, 0x00, 0x05, 0x00, 0x60, 0x00, 0x00, 0x50,
-  0x02, 0x00, 0x05, 0x50, 0x60, 0x00, 0x00, 0x50,
-  0x02, 0x00, 0x05, 0xa0, 0x60, 0x00, 0x00, 0x50,
-  0x02, 0x00, 0x05, 0xf0, 0x60, 0x00, 0x00, 0x50,
-  0x02, 0x00, 0x06, 0x40, 0x60, 0x00, 0x00, 0x50,
-  0x02, 0x00, 0x06, 0x90, 0x60, 0x00, 0x00, 0x50,
-  0x02, 0x00, 0x06, 0xe0, 0x20, 0x00, 0x00, 0x50,
-};
-
 #define MAGIC_START         "IKCFG_ST"
 #define MAGIC_END           "IKCFG_ED"
 #define MAGIC_LEN           8
@@ -97,9 +57,186 @@ static const unsigned char S390_HEADER[] = {
 const static unsigned char magic_start[] = MAGIC_START;
 const static unsigned char magic_end[] = MAGIC_END;
 
+/* gzip magic, compression method "deflate" and no flags */
+const static unsigned char gzip_magic[] = { 0x1f, 0x8b, 0x08, 0x00 };
+
+/* size of the decompressed chunks read from the kernel image */
+#define IKCONFIG_CHUNK      (64 * 1024)
+
+/* upper limit for the size of an uncompressed kernel configuration */
+#define IKCONFIG_MAX        (16 * 1024 * 1024)
+
+/* upper limit for ELF program headers and note segments read for build-id */
+#define ELF_NOTES_MAX       (64 * 1024)
+
+// -----------------------------------------------------------------------------
+/**
+ * Incremental extractor of the embedded kernel configuration.
+ *
+ * The (decompressed) kernel image is fed in chunks. The stream is
+ * searched for the IKCFG_ST marker, and the gzip data that follows
+ * it is inflated on the fly until the end of the gzip stream. If the
+ * IKCFG_ED marker is seen first, the embedded data is truncated. In
+ * either case, the rest of the image need not be read.
+ */
+class IKconfigStream {
+
+    public:
+        IKconfigStream();
+        ~IKconfigStream();
+
+        /**
+         * Process the next chunk of the kernel image.
+         *
+         * @param[in] data the data bytes
+         * @param[in] len the size of @p data
+         * @return @c true if the configuration is complete
+         * @exception KError if the embedded data is invalid
+         */
+        bool feed(const unsigned char *data, size_t len);
+
+        /**
+         * Checks if the IKCFG_ST marker has been seen.
+         */
+        bool found() const
+        { return m_state != SEARCH; }
+
+        /**
+         * Returns the extracted configuration.
+         */
+        const string &config() const
+        { return m_config; }
+
+    private:
+        enum { SEARCH, INFLATE, DONE } m_state;
+        unsigned char m_carry[MAGIC_LEN - 1];
+        size_t m_carrylen;
+        z_stream m_zstream;
+        size_t m_used;
+        string m_config;
+
+        const unsigned char *findMarker(const unsigned char *data, size_t len,
+                                        const unsigned char *marker);
+        void inflateData(const unsigned char *data, size_t len);
+};
+
+// -----------------------------------------------------------------------------
+IKconfigStream::IKconfigStream()
+    : m_state(SEARCH), m_carrylen(0), m_used(0)
+{
+    memset(&m_zstream, 0, sizeof m_zstream);
+}
+
+// -----------------------------------------------------------------------------
+IKconfigStream::~IKconfigStream()
+{
+    if (m_state != SEARCH)
+        inflateEnd(&m_zstream);
+}
+
+// -----------------------------------------------------------------------------
+const unsigned char *IKconfigStream::findMarker(const unsigned char *data,
+                                                size_t len,
+                                                const unsigned char *marker)
+{
+    const unsigned char *ret = NULL;
+
+    // the marker may span the previous chunk and this one
+    unsigned char joined[2 * (MAGIC_LEN - 1)];
+    size_t head = len < MAGIC_LEN - 1 ? len : MAGIC_LEN - 1;
+    memcpy(joined, m_carry, m_carrylen);
+    memcpy(joined + m_carrylen, data, head);
+    const void *pos = memmem(joined, m_carrylen + head, marker, MAGIC_LEN);
+    if (pos)
+        ret = data + (static_cast<const unsigned char *>(pos) - joined) +
+            MAGIC_LEN - m_carrylen;
+    else {
+        pos = memmem(data, len, marker, MAGIC_LEN);
+        if (pos)
+            ret = static_cast<const unsigned char *>(pos) + MAGIC_LEN;
+    }
+
+    // keep the tail for the next chunk
+    if (len >= MAGIC_LEN - 1) {
+        m_carrylen = MAGIC_LEN - 1;
+        memcpy(m_carry, data + len - m_carrylen, m_carrylen);
+    } else {
+        size_t keep = MAGIC_LEN - 1 - len;
+        if (keep > m_carrylen)
+            keep = m_carrylen;
+        memmove(m_carry, m_carry + m_carrylen - keep, keep);
+        memcpy(m_carry + keep, data, len);
+        m_carrylen = keep + len;
+    }
+
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+bool IKconfigStream::feed(const unsigned char *data, size_t len)
+{
+    if (m_state == SEARCH) {
+        const unsigned char *start = findMarker(data, len, magic_start);
+        if (!start)
+            return false;
+
+        Debug::debug()->dbg("Found IKCONFIG marker");
+
+        // 16 + MAX_WBITS: parse (and verify) the gzip header and trailer
+        if (inflateInit2(&m_zstream, 16 + MAX_WBITS) != Z_OK)
+            throw KError("inflateInit2() failed");
+        m_state = INFLATE;
+        m_carrylen = 0;
+
+        len -= start - data;
+        data = start;
+    }
+
+    if (m_state == INFLATE) {
+        const unsigned char *end = findMarker(data, len, magic_end);
+        if (end) {
+            end -= MAGIC_LEN;
+            len = end > data ? end - data : 0;
+        }
+        inflateData(data, len);
+        if (end && m_state != DONE)
+            throw KError("Cannot read IKCONFIG.");
+    }
+
+    return m_state == DONE;
+}
+
+// -----------------------------------------------------------------------------
+void IKconfigStream::inflateData(const unsigned char *data, size_t len)
+{
+    m_zstream.next_in = const_cast<Bytef *>(data);
+    m_zstream.avail_in = len;
+
+    do {
+        if (m_config.size() - m_used < IKCONFIG_CHUNK) {
+            if (m_config.size() >= IKCONFIG_MAX)
+                throw KError("The kernel configuration is too large.");
+            m_config.resize(m_config.size() + IKCONFIG_CHUNK);
+        }
+        m_zstream.next_out = reinterpret_cast<Bytef *>(&m_config[m_used]);
+        m_zstream.avail_out = m_config.size() - m_used;
+
+        int ret = inflate(&m_zstream, Z_NO_FLUSH);
+        m_used = m_config.size() - m_zstream.avail_out;
+        if (ret == Z_STREAM_END) {
+            m_config.resize(m_used);
+            m_state = DONE;
+            break;
+        } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            throw KError("Failed to uncompress the kernel configuration ("
+                + StringUtil::number2string(ret) + ").");
+        }
+    } while (m_zstream.avail_in > 0 || m_zstream.avail_out == 0);
+}
+
 // -----------------------------------------------------------------------------
 KernelTool::KernelTool(const std::string &image)
-    : m_kernel(image), m_fd(-1)
+    : m_kernel(image), m_fd(-1), m_typeKnown(false)
 {
     Debug::debug()->trace("KernelTool::KernelTool(%s)", image.c_str());
 
@@ -107,11 +244,19 @@ KernelTool::KernelTool(const std::string &image)
     if (m_fd < 0) {
         throw KSystemError("Opening of " + image + " failed.", errno);
     }
+
+    try {
+        m_header.reset(new BootHeader(m_fd));
+    } catch (...) {
+        close(m_fd);
+        throw;
+    }
 }
 
 // -----------------------------------------------------------------------------
 KernelTool::~KernelTool()
 {
+    m_header.reset();
     close(m_fd);
     m_fd = -1;
 }
@@ -119,27 +264,54 @@ KernelTool::~KernelTool()
 // -----------------------------------------------------------------------------
 KernelTool::KernelType KernelTool::getKernelType() const
 {
-    if (Util::isElfFile(m_fd)) {
-        if (Util::isGzipFile(m_fd))
-            return KT_ELF_GZ;
-        else
-            return KT_ELF;
-    } else if (Util::isX86(Util::getArch())) {
+    if (!m_typeKnown) {
+        m_type = findKernelType();
+        m_typeKnown = true;
+    }
+    return m_type;
+}
+
+// -----------------------------------------------------------------------------
+KernelTool::KernelType KernelTool::findKernelType() const
+{
+    Decompressor::Format fmt = m_header->compression();
+    bool isElf = (fmt == Decompressor::FMT_NONE)
+        ? m_header->format() == BootHeader::BH_ELF
+        : Util::isElfFile(m_fd);
+
+    if (isElf) {
+        switch (fmt) {
+            case Decompressor::FMT_GZIP:
+                return KT_ELF_GZ;
+            case Decompressor::FMT_XZ:
+                return KT_ELF_XZ;
+            case Decompressor::FMT_ZSTD:
+                return KT_ELF_ZSTD;
+            case Decompressor::FMT_LZ4:
+            case Decompressor::FMT_LZ4_LEGACY:
+                return KT_ELF_LZ4;
+            default:
+                return KT_ELF;
+        }
+    }
+
+    string arch = Util::getArch();
+    if (Util::isX86(arch)) {
         if (isX86Kernel())
             return KT_X86;
         else
             return KT_NONE;
-    } else if (Util::getArch() == "s390x") {
+    } else if (arch == "s390x") {
         if (isS390Kernel())
             return KT_S390;
         else
             return KT_NONE;
-    } else if (Util::getArch() == "aarch64") {
+    } else if (arch == "aarch64") {
         if (isAarch64Kernel())
             return KT_AARCH64;
         else
             return KT_NONE;
-    } else      
+    } else
         return KT_NONE;
 }
 
@@ -149,6 +321,9 @@ bool KernelTool::isRelocatable() const
     switch (getKernelType()) {
         case KernelTool::KT_ELF:
         case KernelTool::KT_ELF_GZ:
+        case KernelTool::KT_ELF_XZ:
+        case KernelTool::KT_ELF_ZSTD:
+        case KernelTool::KT_ELF_LZ4:
             return elfIsRelocatable();
 
         case KernelTool::KT_X86:
@@ -168,210 +343,277 @@ bool KernelTool::isRelocatable() const
 }
 
 // -----------------------------------------------------------------------------
-bool KernelTool::isX86Kernel() const
+bool KernelTool::isRelocatable(const Kconfig &kconfig) const
 {
-    unsigned char buffer[BUFSIZ];
-
-    /* check the magic number */
-    off_t off_ret = lseek(m_fd, X86_HEADER_OFF_START, SEEK_SET);
-    if (off_ret == (off_t)-1) {
-        throw KSystemError("IdentifyKernel::isX86Kernel: lseek to "
-            "X86_HEADER_OFF_START failed", errno);
-    }
+    switch (getKernelType()) {
+        case KernelTool::KT_ELF:
+        case KernelTool::KT_ELF_GZ:
+        case KernelTool::KT_ELF_XZ:
+        case KernelTool::KT_ELF_ZSTD:
+        case KernelTool::KT_ELF_LZ4:
+            return elfIsRelocatable(&kconfig);
 
-    int ret = read(m_fd, buffer, 4);
-    if (ret != 4) {
-        throw KSystemError("IdentifyKernel::isX86Kernel: read of magic "
-            "start failed", errno);
+        default:
+            return isRelocatable();
     }
+}
 
-    return *((uint32_t *)buffer) == X86_HEADER_OFF_MAGIC;
+// -----------------------------------------------------------------------------
+bool KernelTool::isX86Kernel() const
+{
+    return m_header->format() == BootHeader::BH_X86;
 }
 
 // -----------------------------------------------------------------------------
 bool KernelTool::isS390Kernel() const
 {
-    unsigned char buffer[sizeof(S390_HEADER)];
-
-    /* check the magic number */
-    if (lseek(m_fd, 0, SEEK_SET) == (off_t)-1) {
-        throw KSystemError("IdentifyKernel::isS390Kernel: lseek to "
-            "file start failed", errno);
-    }
-
-    int ret = read(m_fd, buffer, sizeof(buffer));
-    if (ret < 0) {
-        throw KSystemError("IdentifyKernel::isS390Kernel: read of magic "
-            "start failed", errno);
-    } else if (ret < (int)sizeof(buffer))
-        return false;
-
-    /* the iplstart address varies, so ignore it */
-    memcpy(buffer + S390_HEADER_OFF_IPLSTART,
-           S390_HEADER + S390_HEADER_OFF_IPLSTART,
-           S390_HEADER_SIZE_IPLSTART);
-
-    return memcmp(buffer, S390_HEADER, sizeof(S390_HEADER)) == 0;
+    return m_header->format() == BootHeader::BH_S390;
 }
 
 // -----------------------------------------------------------------------------
 bool KernelTool::isAarch64Kernel() const
 {
-    struct {
-        uint32_t code0;         /* Executable code */
-        uint32_t code1;         /* Executable code */
-        uint64_t text_offset;   /* Image load offset, little endian */
-        uint64_t image_size;    /* Effective Image size, little endian */
-        uint64_t flags;         /* kernel flags, little endian */
-        uint64_t res2;          /* reserved */
-        uint64_t res3;          /* reserved */
-        uint64_t res4;          /* reserved */
-        uint32_t magic;         /* Magic number, little endian, "ARM\x64" */
-        uint32_t res5;          /* reserved (used for PE COFF offset) */
-    } buffer;
-
-    /* check the magic number */
-    if (lseek(m_fd, 0, SEEK_SET) == (off_t)-1) {
-        throw KSystemError("IdentifyKernel::isAarch64Kernel: lseek to "
-            "file start failed", errno);
-    }
+    return m_header->format() == BootHeader::BH_AARCH64;
+}
 
-    int ret = read(m_fd, &buffer, sizeof(buffer));
-    if (ret < 0) {
-        throw KSystemError("IdentifyKernel::isAarch64Kernel: read of magic "
-            "start failed", errno);
-    } else if (ret < (int)sizeof(buffer))
-        return false;
+// -----------------------------------------------------------------------------
+bool KernelTool::x86isRelocatable() const
+{
+    if (!isX86Kernel()) {
+        throw KError("This is not a kernel image");
+    }
 
-    return buffer.magic == 0x644d5241; /* little endian "ARM\x64" */
+    return m_header->isRelocatable();
 }
 
 // -----------------------------------------------------------------------------
-bool KernelTool::x86isRelocatable() const
+string KernelTool::getArch() const
 {
-    unsigned char buffer[BUFSIZ];
+    switch (getKernelType()) {
+        case KernelTool::KT_ELF:
+        case KernelTool::KT_ELF_GZ:
+        case KernelTool::KT_ELF_XZ:
+        case KernelTool::KT_ELF_ZSTD:
+        case KernelTool::KT_ELF_LZ4:
+            return elfArch();
 
-    // check the magic number
-    off_t off_ret = lseek(m_fd, X86_HEADER_OFF_START, SEEK_SET);
-    if (off_ret == (off_t)-1) {
-        throw KSystemError("IdentifyKernel::checkArchFileX86: lseek to "
-            "X86_HEADER_OFF_START failed", errno);
-    }
+        case KernelTool::KT_X86:
+            return Util::getArch();
 
-    int ret = read(m_fd, buffer, 4);
-    if (ret != 4) {
-        throw KSystemError("IdentifyKernel::checkArchFileX86: read of magic "
-            "start failed", errno);
-    }
+        case KernelTool::KT_S390:
+            return "s390x";
 
-    if (*((uint32_t *)buffer) != X86_HEADER_OFF_MAGIC) {
-        throw KError("This is not a kernel image");
-    }
+        case KernelTool::KT_AARCH64:
+            return "aarch64";
 
-    // check the version
-    off_ret = lseek(m_fd, X86_HEADER_OFF_VERSION, SEEK_SET);
-    if (off_ret == (off_t)-1) {
-        throw KSystemError("IdentifyKernel::checkArchFileX86: lseek to "
-            "X86_HEADER_OFF_VERSION failed", errno);
+        default:
+            throw KError("Invalid kernel type.");
     }
+}
 
-    ret = read(m_fd, buffer, 2);
-    if (ret != 2) {
-        throw KSystemError("IdentifyKernel::checkArchFileX86: read of version"
-            " failed", errno);
-    }
+// -----------------------------------------------------------------------------
+string KernelTool::elfArch() const
+{
+    union {
+        unsigned char e_ident[EI_NIDENT];
+        Elf32_Ehdr hdr32;
+        Elf64_Ehdr hdr64;
+    } hdr;
 
-    // older versions are not relocatable
-    if (*((uint16_t *)buffer) < X86_HEADER_RELOCATABLE_VER) {
-        return false;
+    unique_ptr<Decompressor> data(Decompressor::open(m_fd));
+    size_t len = data->read(&hdr, sizeof hdr);
+    if (len < EI_NIDENT) {
+        throw KError("check_elf_file: Failed to read");
     }
 
-    // and check if the kernel is compiled to be relocatable
-    off_ret = lseek(m_fd, X86_HEADER_OFF_RELOCATABLE, SEEK_SET);
-    if (off_ret == (off_t)-1) {
-        throw KSystemError("IdentifyKernel::checkArchFileX86: lseek to "
-            "X86_HEADER_OFF_RELOCATABLE failed", errno);
+    unsigned short machine;
+    if (hdr.e_ident[EI_CLASS] == ELFCLASS32) {
+        if (len < sizeof(Elf32_Ehdr)) {
+            throw KError("Couldn't read ELF header");
+        }
+        machine = hdr.hdr32.e_machine;
+    } else if (hdr.e_ident[EI_CLASS] == ELFCLASS64) {
+        if (len < sizeof(Elf64_Ehdr)) {
+            throw KError("Couldn't read ELF header");
+        }
+        machine = hdr.hdr64.e_machine;
+    } else {
+        throw KError("elfIsRelocatable(): Invalid ELF class");
     }
 
-    ret = read(m_fd, buffer, 1);
-    if (ret != 1) {
-        throw KSystemError("IdentifyKernel::checkArchFileX86: read of "
-            "relocatable bit failed", errno);
-    }
+    if (hdr.e_ident[EI_DATA] == ELFDATA2LSB)
+        machine = le16toh(machine);
+    else if (hdr.e_ident[EI_DATA] == ELFDATA2MSB)
+        machine = be16toh(machine);
+    else
+        throw KError("elfIsRelocatable(): Invalid ELF data encoding");
 
-    return !!buffer[0];
+    return archFromElfMachine(machine);
 }
 
 // -----------------------------------------------------------------------------
-bool KernelTool::elfIsRelocatable() const
+static inline uint16_t elf16(uint16_t val, bool msb)
 {
-    unsigned char e_ident[EI_NIDENT];
+    return msb ? be16toh(val) : le16toh(val);
+}
 
-    off_t oret = lseek(m_fd, 0, SEEK_SET);
-    if (oret == off_t(-1)) {
-        throw KSystemError("lseek() failed", errno);
-    }
+static inline uint32_t elf32(uint32_t val, bool msb)
+{
+    return msb ? be32toh(val) : le32toh(val);
+}
 
-    gzFile fp = gzdopen(dup(m_fd), "r");
-    if (!fp) {
-        throw KSystemError("check_elf_file: Failed to open file", errno);
-    }
+static inline uint64_t elf64(uint64_t val, bool msb)
+{
+    return msb ? be64toh(val) : le64toh(val);
+}
 
-    int ret = gzread(fp, e_ident, EI_NIDENT);
-    if (ret != EI_NIDENT) {
-        gzclose(fp);
-        throw KSystemError("check_elf_file: Failed to read", errno);
-    }
+// -----------------------------------------------------------------------------
+static string findBuildIdNote(const unsigned char *buf, size_t len, bool msb)
+{
+    static const char hexdigits[] = "0123456789abcdef";
+    size_t pos = 0;
+
+    while (len - pos >= sizeof(Elf32_Nhdr)) {
+        const Elf32_Nhdr *nhdr =
+            reinterpret_cast<const Elf32_Nhdr *>(buf + pos);
+        uint32_t namesz = elf32(nhdr->n_namesz, msb);
+        uint32_t descsz = elf32(nhdr->n_descsz, msb);
+        uint32_t type = elf32(nhdr->n_type, msb);
+        pos += sizeof(Elf32_Nhdr);
+
+        size_t namealign = (size_t(namesz) + 3) & ~size_t(3);
+        size_t descalign = (size_t(descsz) + 3) & ~size_t(3);
+        if (len - pos < namealign || len - pos - namealign < descalign)
+            break;
 
-    if (gzseek(fp, 0, SEEK_SET) == (off_t)-1) {
-        gzclose(fp);
-        throw KSystemError("Seek failed", errno);
+        if (type == NT_GNU_BUILD_ID && namesz == sizeof(ELF_NOTE_GNU) &&
+            !memcmp(buf + pos, ELF_NOTE_GNU, sizeof(ELF_NOTE_GNU))) {
+            const unsigned char *desc = buf + pos + namealign;
+            string ret;
+            for (uint32_t i = 0; i < descsz; ++i) {
+                ret.push_back(hexdigits[desc[i] >> 4]);
+                ret.push_back(hexdigits[desc[i] & 0xf]);
+            }
+            return ret;
+        }
+
+        pos += namealign + descalign;
     }
 
-    unsigned short machine;
-    string arch;
-    if (e_ident[EI_CLASS] == ELFCLASS32) {
-        Elf32_Ehdr hdr;
-
-        ret = gzread(fp, (unsigned char *)&hdr, sizeof(Elf32_Ehdr));
-        if (ret != sizeof(Elf32_Ehdr)) {
-            gzclose(fp);
-            throw KSystemError("Couldn't read ELF header", errno);
-        }
+    return string();
+}
 
-	if (e_ident[EI_DATA] == ELFDATA2LSB)
-	    machine = le16toh(hdr.e_machine);
-	else if (e_ident[EI_DATA] == ELFDATA2MSB)
-	    machine = be16toh(hdr.e_machine);
-	else
-	    throw KError("elfIsRelocatable(): Invalid ELF data encoding");
+// -----------------------------------------------------------------------------
+string KernelTool::getBuildId() const
+{
+    Debug::debug()->trace("KernelTool::getBuildId(%s)", m_kernel.c_str());
 
-    } else if (e_ident[EI_CLASS] == ELFCLASS64) {
-        Elf64_Ehdr hdr;
+    switch (getKernelType()) {
+        case KernelTool::KT_ELF:
+        case KernelTool::KT_ELF_GZ:
+        case KernelTool::KT_ELF_XZ:
+        case KernelTool::KT_ELF_ZSTD:
+        case KernelTool::KT_ELF_LZ4:
+            break;
 
-        ret = gzread(fp, (unsigned char *)&hdr, sizeof(Elf64_Ehdr));
-        if (ret != sizeof(Elf64_Ehdr)) {
-            gzclose(fp);
-            throw KSystemError("Couldn't read ELF header", errno);
+        default:
+            return string();
+    }
+
+    union {
+        unsigned char e_ident[EI_NIDENT];
+        Elf32_Ehdr hdr32;
+        Elf64_Ehdr hdr64;
+    } hdr;
+
+    unique_ptr<Decompressor> data(Decompressor::open(m_fd));
+    off_t pos = data->read(&hdr, sizeof hdr);
+
+    bool msb = hdr.e_ident[EI_DATA] == ELFDATA2MSB;
+    bool is64 = hdr.e_ident[EI_CLASS] == ELFCLASS64;
+    off_t phoff;
+    size_t phentsize, phnum;
+    if (is64) {
+        if (pos < off_t(sizeof(Elf64_Ehdr)))
+            throw KError("Couldn't read ELF header");
+        phoff = elf64(hdr.hdr64.e_phoff, msb);
+        phentsize = elf16(hdr.hdr64.e_phentsize, msb);
+        phnum = elf16(hdr.hdr64.e_phnum, msb);
+    } else {
+        if (pos < off_t(sizeof(Elf32_Ehdr)))
+            throw KError("Couldn't read ELF header");
+        phoff = elf32(hdr.hdr32.e_phoff, msb);
+        phentsize = elf16(hdr.hdr32.e_phentsize, msb);
+        phnum = elf16(hdr.hdr32.e_phnum, msb);
+    }
+
+    if (phnum == PN_XNUM || phoff < pos ||
+        phentsize < (is64 ? sizeof(Elf64_Phdr) : sizeof(Elf32_Phdr)) ||
+        phentsize * phnum > ELF_NOTES_MAX) {
+        Debug::debug()->dbg("Unusual program headers, no build-id");
+        return string();
+    }
+
+    // program headers
+    unique_ptr<unsigned char[]> buf(new unsigned char[ELF_NOTES_MAX]);
+    data->skip(phoff - pos);
+    pos = phoff;
+    size_t len = phentsize * phnum;
+    if (data->read(buf.get(), len) != len)
+        throw KError("Couldn't read ELF program headers");
+    pos += len;
+
+    // note segments, sorted by file offset
+    std::map<off_t, size_t> notes;
+    for (size_t i = 0; i < phnum; ++i) {
+        const unsigned char *p = buf.get() + i * phentsize;
+        if (is64) {
+            const Elf64_Phdr *phdr = reinterpret_cast<const Elf64_Phdr *>(p);
+            if (elf32(phdr->p_type, msb) == PT_NOTE)
+                notes[elf64(phdr->p_offset, msb)] =
+                    elf64(phdr->p_filesz, msb);
+        } else {
+            const Elf32_Phdr *phdr = reinterpret_cast<const Elf32_Phdr *>(p);
+            if (elf32(phdr->p_type, msb) == PT_NOTE)
+                notes[elf32(phdr->p_offset, msb)] =
+                    elf32(phdr->p_filesz, msb);
         }
+    }
 
-	if (e_ident[EI_DATA] == ELFDATA2LSB)
-	    machine = le16toh(hdr.e_machine);
-	else if (e_ident[EI_DATA] == ELFDATA2MSB)
-	    machine = be16toh(hdr.e_machine);
-	else
-	    throw KError("elfIsRelocatable(): Invalid ELF data encoding");
-    } else {
-        throw KError("elfIsRelocatable(): Invalid ELF class");
+    for (std::map<off_t, size_t>::const_iterator it = notes.begin();
+         it != notes.end(); ++it) {
+        if (it->first < pos || it->second > ELF_NOTES_MAX)
+            continue;
+
+        data->skip(it->first - pos);
+        pos = it->first;
+        len = data->read(buf.get(), it->second);
+        pos += len;
+
+        string ret = findBuildIdNote(buf.get(), len, msb);
+        if (!ret.empty()) {
+            Debug::debug()->dbg("Build-id: %s", ret.c_str());
+            return ret;
+        }
     }
-    arch = archFromElfMachine(machine);
 
-    gzclose(fp);
+    return string();
+}
+
+// -----------------------------------------------------------------------------
+bool KernelTool::elfIsRelocatable(const Kconfig *kconfig) const
+{
+    string arch = elfArch();
 
     Debug::debug()->dbg("Detected arch %s", arch.c_str());
 
-    return isArchAlwaysRelocatable(arch) ||
-      (hasConfigRelocatable(arch) && isConfigRelocatable());
+    if (isArchAlwaysRelocatable(arch))
+        return true;
+    if (!hasConfigRelocatable(arch))
+        return false;
+    return kconfig
+        ? isConfigRelocatable(*kconfig)
+        : isConfigRelocatable();
 }
 
 // -----------------------------------------------------------------------------
@@ -390,16 +632,22 @@ bool KernelTool::hasConfigRelocatable(const string &machine) const
 bool KernelTool::isConfigRelocatable() const
 {
     try {
-    Kconfig *kconfig = retrieveKernelConfig();
-    KconfigValue kv = kconfig->get("CONFIG_RELOCATABLE");
-    return (kv.getType() == KconfigValue::T_TRISTATE &&
-	    kv.getTristateValue() == KconfigValue::ON);
+    unique_ptr<Kconfig> kconfig(retrieveKernelConfig());
+    return isConfigRelocatable(*kconfig);
     } catch (KError &e) {
 	Debug::debug()->dbg("%s (assume non-relocatable)", e.what());
 	return false;
     }
 }
 
+// -----------------------------------------------------------------------------
+bool KernelTool::isConfigRelocatable(const Kconfig &kconfig)
+{
+    KconfigValue kv = kconfig.get("CONFIG_RELOCATABLE");
+    return (kv.getType() == KconfigValue::T_TRISTATE &&
+	    kv.getTristateValue() == KconfigValue::ON);
+}
+
 // -----------------------------------------------------------------------------
 string KernelTool::archFromElfMachine(unsigned long long et_machine) const
 {
@@ -444,47 +692,27 @@ Kconfig *KernelTool::retrieveKernelConfig() const
 }
 
 // -----------------------------------------------------------------------------
-string KernelTool::extractFromIKconfigBuffer(const char *buffer, size_t buflen)
-    const
+string KernelTool::extractKernelConfigAt(off_t offset) const
 {
-    Debug::debug()->trace("Kconfig::extractFromIKconfigBuffer(%p, %d)",
-        buffer, buflen);
-
-    ssize_t uncompressed_len = buflen * 20;
-    unique_ptr<Bytef[]> uncompressed(new Bytef[uncompressed_len]);
+    Debug::debug()->trace("KernelTool::extractKernelConfigAt(%lld)",
+        (long long)offset);
 
-    z_stream stream;
-    stream.next_in = (Bytef *)buffer;
-    stream.avail_in = buflen;
-
-    stream.next_out = (Bytef *)uncompressed.get();
-    stream.avail_out = uncompressed_len;
-
-    stream.zalloc = NULL;
-    stream.zfree = NULL;
-    stream.opaque = NULL;
-
-    int ret = inflateInit2(&stream, -MAX_WBITS);
-    if (ret != Z_OK) {
-        throw KError("inflateInit2() failed");
-    }
-
-    ret = inflate(&stream, Z_FINISH);
-    if (ret != Z_STREAM_END) {
-        throw KError("inflate() failed");
-    }
+    unique_ptr<Decompressor> data(Decompressor::open(m_fd, offset));
 
-    ret = inflateEnd(&stream);
-    if (ret != Z_OK) {
-        throw KError("Failed to uncompress the kernel configuration ("
-            + StringUtil::number2string(ret) + ").");
-    }
+    IKconfigStream ikconfig;
+    unique_ptr<unsigned char[]> buffer(new unsigned char[IKCONFIG_CHUNK]);
+    size_t chars_read;
+    bool done = false;
+    while (!done &&
+           (chars_read = data->read(buffer.get(), IKCONFIG_CHUNK)) > 0)
+        done = ikconfig.feed(buffer.get(), chars_read);
 
-    uncompressed_len = stream.total_out;
+    if (!ikconfig.found())
+        throw KError("Cannot read configuration from " + m_kernel + ".");
+    if (!done)
+        throw KError("Cannot read IKCONFIG.");
 
-    stringstream ss;
-    uncompressed.get()[uncompressed_len] = '\0';
-    return string((const char *)uncompressed.get());
+    return ikconfig.config();
 }
 
 // -----------------------------------------------------------------------------
@@ -492,64 +720,7 @@ string KernelTool::extractKernelConfigELF() const
 {
     Debug::debug()->trace("Kconfig::extractKernelConfigELF()");
 
-    off_t oret = lseek(m_fd, 0, SEEK_SET);
-    if (oret == off_t(-1)) {
-        throw KSystemError("lseek() failed", errno);
-    }
-
-    gzFile fp = gzdopen(dup(m_fd), "r");
-    if (!fp) {
-        throw KError(string("Opening '") + m_kernel + string("' failed."));
-    }
-
-    // we overlap the reads, that way searching for the pattern is easier
-    unsigned char buffer[BUFSIZ];
-    memset(buffer, 0, BUFSIZ);
-
-    // search for the begin and end offests first
-    off_t fileoffset = 0;
-    ssize_t chars_read;
-    off_t begin_offset = -1, end_offset = -1;
-    while ((chars_read = gzread(fp, buffer+MAGIC_LEN, BUFSIZ-MAGIC_LEN)) > 0) {
-        if (begin_offset < 0) {
-            ssize_t pos = Util::findBytes(buffer, BUFSIZ, magic_start, MAGIC_LEN);
-            if (pos > 0) {
-                begin_offset = fileoffset + pos - MAGIC_LEN;
-            }
-        } else if (end_offset < 0) {
-            ssize_t pos = Util::findBytes(buffer, BUFSIZ, magic_end, MAGIC_LEN);
-            if (pos > 0) {
-                end_offset = fileoffset + pos - MAGIC_LEN;
-            }
-        } else {
-            break;
-        }
-        fileoffset += chars_read;
-        memmove(buffer, buffer+BUFSIZ-MAGIC_LEN, MAGIC_LEN);
-    }
-
-    if (begin_offset < 0 || end_offset < 0) {
-        gzclose(fp);
-        throw KError("Cannot read configuration from " + m_kernel + ".");
-    }
-
-    // we need to read after the MAGIC_START and the gzip header
-    begin_offset += MAGIC_LEN + 10;
-
-    // read the configuration to a buffer
-    if (gzseek(fp, begin_offset, SEEK_SET) == -1) {
-        throw KError("gzseek() failed.");
-    }
-    ssize_t kernelconfig_len = end_offset - begin_offset;
-    unique_ptr<char[]> kernelconfig(new char[kernelconfig_len]);
-
-    chars_read = gzread(fp, kernelconfig.get(), kernelconfig_len);
-    gzclose(fp);
-    if (chars_read != kernelconfig_len) {
-        throw KError("Cannot read IKCONFIG.");
-    }
-
-    return extractFromIKconfigBuffer(kernelconfig.get(), kernelconfig_len);
+    return extractKernelConfigAt(0);
 }
 
 // -----------------------------------------------------------------------------
@@ -557,96 +728,41 @@ string KernelTool::extractKernelConfigbzImage() const
 {
     Debug::debug()->trace("Kconfig::extractKernelConfigbzImage()");
 
+    // newer boot protocols tell where the compressed kernel is
+    off_t payload = m_header->payloadOffset();
+    if (payload >= 0) {
+        Decompressor::Format fmt = m_header->payloadCompression();
+        Debug::debug()->dbg("bzImage payload at 0x%llx (%s)",
+            (unsigned long long)payload, Decompressor::formatName(fmt));
+        if (fmt != Decompressor::FMT_NONE)
+            return extractKernelConfigAt(payload);
+    }
+
     // that script helped me a lot
     // http://www.cs.caltech.edu/~weixl/research/fast-mon/scripts/extract-ikconfig
 
-    unsigned char searchfor[4] = { 0x1f, 0x8b, 0x08, 0x0 };
-    unsigned char buffer[BUFSIZ];
-    ssize_t chars_read;
-
-    off_t oret = lseek(m_fd, 0, SEEK_SET);
-    if (oret == (off_t)-1) {
-        throw KSystemError("lseek() failed", errno);
-    }
-
-    // because of overlapping
-    memset(buffer, 0, BUFSIZ);
+    const size_t magic_len = sizeof gzip_magic;
+    unique_ptr<unsigned char[]> buffer(new unsigned char[IKCONFIG_CHUNK]);
 
+    // the first gzip header is the compressed kernel
     off_t fileoffset = 0;
-    off_t begin_offset = 0;
-    while ((chars_read = read(m_fd, buffer+4, BUFSIZ-4)) > 0) {
-        ssize_t pos = Util::findBytes(buffer, BUFSIZ, searchfor, 4);
-        if (pos > 0) {
-            begin_offset = fileoffset + pos - MAGIC_LEN;
-            break;
-        }
-        memmove(buffer, buffer+BUFSIZ-MAGIC_LEN, MAGIC_LEN);
-        fileoffset += chars_read;
-    }
-
-    if (begin_offset == 0) {
-        throw KError("Magic 0x1f 0x8b 0x08 0x0 not found.");
-    }
-
-    begin_offset += 4;
-
-    off_t ret = lseek(m_fd, begin_offset, SEEK_SET);
-    if (ret == (off_t)-1) {
-        throw KSystemError("lseek() failed", errno);
-    }
-
-    gzFile fp = gzdopen(dup(m_fd), "r");
-    if (!fp) {
-        throw KError("gzdopen() failed");
-    }
-
-    // we overlap the reads, that way searching for the pattern is easier
-    memset(buffer, 0, BUFSIZ);
-
-    // search for the begin and end offests first
-    off_t end_offset = 0;
-    begin_offset = 0;
-    fileoffset = 0;
-    while ((chars_read = gzread(fp, buffer+MAGIC_LEN, BUFSIZ-MAGIC_LEN)) > 0) {
-        if (begin_offset == 0) {
-            ssize_t pos = Util::findBytes(buffer, BUFSIZ, magic_start, MAGIC_LEN);
-            if (pos > 0) {
-                begin_offset = fileoffset + pos - MAGIC_LEN;
-            }
-        } else if (end_offset == 0) {
-            ssize_t pos = Util::findBytes(buffer, BUFSIZ, magic_end, MAGIC_LEN);
-            if (pos > 0) {
-                end_offset = fileoffset + pos - MAGIC_LEN;
-            }
-        } else {
-            break;
+    ssize_t pos = -1;
+    while (pos < 0) {
+        ssize_t chars_read = pread(m_fd, buffer.get(), IKCONFIG_CHUNK,
+                                   fileoffset);
+        if (chars_read < 0) {
+            throw KSystemError("Cannot read " + m_kernel, errno);
+        } else if (chars_read < (ssize_t)magic_len) {
+            throw KError("Magic 0x1f 0x8b 0x08 0x0 not found.");
         }
-        fileoffset += chars_read;
-        memmove(buffer, buffer+BUFSIZ-MAGIC_LEN, MAGIC_LEN);
-    }
 
-    if (begin_offset < 0 || end_offset < 0) {
-        gzclose(fp);
-        throw KError("Cannot read configuration from " + m_kernel + ".");
-    }
-
-    // we need to read after the MAGIC_START and the gzip header
-    begin_offset += MAGIC_LEN + 10;
-
-    // read the configuration to a buffer
-    if (gzseek(fp, begin_offset, SEEK_SET) == -1) {
-        throw KError("gzseek() failed.");
-    }
-    ssize_t kernelconfig_len = end_offset - begin_offset;
-    unique_ptr<char[]> kernelconfig(new char[kernelconfig_len]);
-
-    chars_read = gzread(fp, kernelconfig.get(), kernelconfig_len);
-    gzclose(fp);
-    if (chars_read != kernelconfig_len) {
-        throw KError("Cannot read IKCONFIG.");
+        pos = Util::findBytes(buffer.get(), chars_read,
+                              gzip_magic, magic_len);
+        if (pos < 0)
+            fileoffset += chars_read - (magic_len - 1);
     }
 
-    return extractFromIKconfigBuffer(kernelconfig.get(), kernelconfig_len);
+    return extractKernelConfigAt(fileoffset + pos);
 }
 
 // -----------------------------------------------------------------------------
@@ -657,6 +773,9 @@ string KernelTool::extractKernelConfig() const
     switch (getKernelType()) {
         case KernelTool::KT_ELF:
         case KernelTool::KT_ELF_GZ:
+        case KernelTool::KT_ELF_XZ:
+        case KernelTool::KT_ELF_ZSTD:
+        case KernelTool::KT_ELF_LZ4:
         case KernelTool::KT_S390:
         case KernelTool::KT_AARCH64:
             return extractKernelConfigELF();
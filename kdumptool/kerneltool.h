@@ -19,12 +19,16 @@
 #ifndef KERNELTOOL_H
 #define KERNELTOOL_H
 
+#include <memory>
 #include <string>
 
+#include <sys/types.h>
+
 #include "global.h"
 #include "fileutil.h"
 
 class Kconfig;
+class BootHeader;
 
 //{{{ KernelTool ---------------------------------------------------------------
 
@@ -40,6 +44,9 @@ class KernelTool {
         enum KernelType {
             KT_ELF,
             KT_ELF_GZ,
+            KT_ELF_XZ,
+            KT_ELF_ZSTD,
+            KT_ELF_LZ4,
             KT_X86,
             KT_S390,
             KT_AARCH64,
@@ -75,6 +82,44 @@ class KernelTool {
          */
         bool isRelocatable() const;
 
+        /**
+         * Checks if a kernel is relocatable, taking CONFIG_RELOCATABLE from
+         * an already retrieved kernel configuration instead of retrieving
+         * it again.
+         *
+         * @param[in] kconfig the kernel configuration (an empty one if
+         *            it cannot be retrieved)
+         * @return @c true if the kernel is relocatable, @c false otherwise
+         */
+        bool isRelocatable(const Kconfig &kconfig) const;
+
+        /**
+         * Returns the architecture of the kernel image. For ELF images,
+         * it is taken from the ELF header; for other image formats, it
+         * is implied by the format.
+         *
+         * @return the architecture as string such as "x86_64"
+         * @exception KError if the file is not a kernel image
+         */
+        std::string getArch() const;
+
+        /**
+         * Returns the GNU build-id of an ELF kernel image (which may be
+         * compressed) or of a separate debuginfo file.
+         *
+         * @return the build-id as lowercase hex string, or an empty
+         *         string if the image has no build-id note
+         * @exception KError if reading of the kernel image fails
+         */
+        std::string getBuildId() const;
+
+        /**
+         * Returns the parsed headers of the kernel image, e.g. to get
+         * the version string of a bzImage.
+         */
+        const BootHeader &getBootHeader() const
+        { return *m_header; }
+
         /**
          * Extracts the kernel configuration from a kernel image. The kernel
          * image can be of type ELF, ELF.gz and bzImage.
@@ -146,12 +191,31 @@ class KernelTool {
          */
         bool isConfigRelocatable() const;
 
+        /**
+         * Checks if a kernel configuration has CONFIG_RELOCATABLE=y.
+         *
+         * @param[in] kconfig the kernel configuration
+         * @return @c true if configured with CONFIG_RELOCATABLE=y.
+         *         @c false otherwise
+         */
+        static bool isConfigRelocatable(const Kconfig &kconfig);
+
         /**
          * Checks if a ELF kernel image is relocatable.
          *
+         * @param[in] kconfig the kernel configuration, or @c NULL to
+         *            retrieve it if needed
          * @return @c true if the ELF kernel is relocatable, @c false otherwise
          */
-        bool elfIsRelocatable() const;
+        bool elfIsRelocatable(const Kconfig *kconfig = NULL) const;
+
+        /**
+         * Returns the architecture of an ELF kernel image.
+         *
+         * @return the architecture as string such as "i386"
+         * @exception KError if the ELF header cannot be read
+         */
+        std::string elfArch() const;
 
         /**
          * Checks if the kernel is a x86 kernel.
@@ -203,18 +267,31 @@ class KernelTool {
         std::string extractKernelConfigbzImage() const;
 
         /**
-         * Extracts the kernel configuration from a IKCONFIG buffer.
+         * Extracts the kernel configuration from the (possibly compressed)
+         * data at a given offset in the kernel image. The image data is
+         * read only up to the end of the embedded configuration.
          *
-         * @param[in] buffer the buffer with the data bytes
-         * @param[in] buflen the size of the buffer
+         * @param[in] offset offset of the data in the kernel image
          * @return the configuration string
-         * @exception KError if the buffer contains invalid data
+         * @exception KError if reading of the kernel image failed or
+         *            the embedded configuration is invalid
+         */
+        std::string extractKernelConfigAt(off_t offset) const;
+
+        /**
+         * Determines the kernel type. Called once by getKernelType().
+         *
+         * @return the kernel type
+         * @exception KError if reading of the kernel image failed
          */
-        std::string extractFromIKconfigBuffer(const char *buffer, size_t buflen) const;
+        KernelType findKernelType() const;
 
     private:
         FilePath m_kernel;
         int m_fd;
+        std::unique_ptr<BootHeader> m_header;
+        mutable KernelType m_type;
+        mutable bool m_typeKnown;
 };
 
 //}}}
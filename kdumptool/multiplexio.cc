@@ -19,47 +19,144 @@
 
 #include <cerrno>
 #include <poll.h>
+#include <unistd.h>
+#include <sys/epoll.h>
 
 #include "global.h"
 #include "multiplexio.h"
 
+/* maximum number of events returned by one epoll_wait() call */
+#define MULTIPLEXIO_EVENTS      16
+
 //{{{ MultiplexIO --------------------------------------------------------------
 
+// -----------------------------------------------------------------------------
+static uint32_t epollEvents(short events)
+{
+    uint32_t ret = 0;
+    if (events & POLLIN)
+	ret |= EPOLLIN;
+    if (events & POLLOUT)
+	ret |= EPOLLOUT;
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+MultiplexIO::MultiplexIO(void)
+    : m_active(0)
+{
+    m_epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epfd < 0)
+	throw KSystemError("epoll_create1() failed", errno);
+}
+
+// -----------------------------------------------------------------------------
+MultiplexIO::~MultiplexIO()
+{
+    close(m_epfd);
+}
+
 // -----------------------------------------------------------------------------
 int MultiplexIO::add(int fd, short events)
 {
-    if (fd >= 0)
+    int idx = m_fds.size();
+    bool always = false;
+
+    if (fd >= 0) {
+	struct epoll_event ev;
+	ev.events = epollEvents(events);
+	ev.data.u32 = idx;
+	if (epoll_ctl(m_epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+	    // regular files are always ready
+	    if (errno != EPERM)
+		throw KSystemError("epoll_ctl() failed", errno);
+	    always = true;
+	}
 	++m_active;
+    }
 
     struct pollfd poll;
     poll.fd = fd;
     poll.events = events;
+    poll.revents = 0;
     m_fds.push_back(poll);
+    m_always.push_back(always);
+
+    return idx;
+}
+
+// -----------------------------------------------------------------------------
+void MultiplexIO::setEvents(int idx, short events)
+{
+    struct pollfd &poll = m_fds.at(idx);
 
-    return m_fds.size() - 1;
+    if (poll.fd >= 0 && !m_always[idx] && events != poll.events) {
+	// a descriptor without events is removed from the epoll set,
+	// so that hangups are not reported for it either
+	struct epoll_event ev;
+	ev.events = epollEvents(events);
+	ev.data.u32 = idx;
+	int op = !poll.events ? EPOLL_CTL_ADD :
+	    !events ? EPOLL_CTL_DEL : EPOLL_CTL_MOD;
+	if (epoll_ctl(m_epfd, op, poll.fd, &ev) < 0)
+	    throw KSystemError("epoll_ctl() failed", errno);
+    }
+    poll.events = events;
 }
 
 // -----------------------------------------------------------------------------
 void MultiplexIO::deactivate(int idx)
 {
-    if (m_fds[idx].fd >= 0)
+    if (m_fds[idx].fd >= 0) {
 	--m_active;
+	if (!m_always[idx])
+	    epoll_ctl(m_epfd, EPOLL_CTL_DEL, m_fds[idx].fd, NULL);
+    }
     m_fds[idx].fd = -1;
+    m_fds[idx].revents = 0;
 }
 
 // -----------------------------------------------------------------------------
 int MultiplexIO::monitor(int timeout)
 {
-    int ret;
+    int ret = 0;
 
+    for (size_t i = 0; i < m_fds.size(); ++i) {
+	m_fds[i].revents = 0;
+	if (m_fds[i].fd >= 0 && m_always[i]) {
+	    m_fds[i].revents = m_fds[i].events & (POLLIN | POLLOUT);
+	    if (m_fds[i].revents)
+		++ret;
+	}
+    }
+    if (ret)
+	timeout = 0;
+
+    struct epoll_event events[MULTIPLEXIO_EVENTS];
+    int nev;
     do {
-	ret = poll(m_fds.data(), m_fds.size(), timeout);
-    } while (ret < 0 && errno == EINTR);
+	nev = epoll_wait(m_epfd, events, MULTIPLEXIO_EVENTS, timeout);
+    } while (nev < 0 && errno == EINTR);
 
-    if (ret < 0)
-	throw KSystemError("poll() failed", errno);
+    if (nev < 0)
+	throw KSystemError("epoll_wait() failed", errno);
 
-    return ret;
+    for (int i = 0; i < nev; ++i) {
+	struct pollfd &poll = m_fds[events[i].data.u32];
+	// not monitored any more
+	if (poll.fd < 0)
+	    continue;
+	if (events[i].events & EPOLLIN)
+	    poll.revents |= POLLIN;
+	if (events[i].events & EPOLLOUT)
+	    poll.revents |= POLLOUT;
+	if (events[i].events & EPOLLHUP)
+	    poll.revents |= POLLHUP;
+	if (events[i].events & EPOLLERR)
+	    poll.revents |= POLLERR;
+    }
+
+    return ret + nev;
 }
 
 //}}}
@@ -26,18 +26,36 @@
 
 //{{{ MultiplexIO --------------------------------------------------------------
 
+/**
+ * Wait for events on a set of file descriptors.
+ *
+ * The implementation uses epoll(7), so the cost of waiting does not depend
+ * on the number of monitored file descriptors. File descriptors which
+ * cannot be monitored with epoll (regular files) are always reported as
+ * ready, like poll(2) does.
+ */
 class MultiplexIO {
 
 	std::vector<struct pollfd> m_fds;
+	std::vector<bool> m_always;
 	int m_active;
+	int m_epfd;
 
     public:
 	/**
-	 * Trivial constructor.
+	 * Create the epoll instance.
+	 *
+	 * @exception KSystemError if epoll_create1() fails
 	 */
-	MultiplexIO(void)
-            : m_active(0)
-        {}
+	MultiplexIO(void);
+
+	/**
+	 * Close the epoll instance.
+	 */
+	~MultiplexIO();
+
+	MultiplexIO(const MultiplexIO &) = delete;
+	MultiplexIO &operator=(const MultiplexIO &) = delete;
 
 	/**
 	 * Add a file descriptor to monitor.
@@ -45,15 +63,28 @@ class MultiplexIO {
 	 * @param[in] fd file descriptor
 	 * @param[in] events to be watched, see poll(2)
 	 * @returns corresponding index in the poll vector
+	 * @exception KSystemError if the descriptor cannot be added
 	 */
 	int add(int fd, short events);
 
 	/**
 	 * Get a reference to a pollfd.
+	 *
+	 * The @c revents member is updated by monitor().
 	 */
         struct pollfd const &at(int idx) const
         { return m_fds.at(idx); }
 
+	/**
+	 * Change the events watched on a file descriptor.
+	 *
+	 * @param[in] idx index in the poll vector
+	 * @param[in] events to be watched, see poll(2); zero stops
+	 *            watching the descriptor until events are set again
+	 * @exception KSystemError if the epoll set cannot be changed
+	 */
+	void setEvents(int idx, short events);
+
 	/**
 	 * Remove a monitored file descriptor.
 	 *
@@ -100,7 +100,7 @@ void StringOption::setValue(const char *arg)
 IntOption::IntOption(const string &name, char letter,
                      int *value,
                      const string &description)
-    : Option(name, letter, description)
+    : Option(name, letter, description), m_value(value)
 {}
 
 /* -------------------------------------------------------------------------- */
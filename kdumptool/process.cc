@@ -25,6 +25,7 @@
 #include <cerrno>
 #include <unistd.h>
 #include <poll.h>
+#include <cstring>
 #include <typeinfo>
 
 #include "process.h"
@@ -43,6 +44,12 @@ using std::make_shared;
 using std::shared_ptr;
 using std::unique_ptr;
 
+/* pipe buffer size for file descriptor and buffer redirections */
+#define PROCESS_PIPE_SIZE       (1024*1024)
+
+/* size of a read buffer if splice() cannot be used */
+#define PROCESS_COPY_SIZE       (64*1024)
+
 //{{{ SubProcess ---------------------------------------------------------------
 
 // -----------------------------------------------------------------------------
@@ -214,6 +221,11 @@ void SubProcessPipe::prepare()
     close();
     if (pipe2(m_pipefd, O_CLOEXEC) < 0)
         throw KSystemError("Cannot create subprocess pipe", errno);
+
+    // the limit for unprivileged users is in /proc/sys/fs/pipe-max-size
+    if (m_size && fcntl(m_pipefd[0], F_SETPIPE_SZ, m_size) < 0)
+        Debug::debug()->dbg("Cannot set pipe size to %zu: %s",
+                            m_size, strerror(errno));
 }
 
 // -----------------------------------------------------------------------------
@@ -316,8 +328,8 @@ void IStream::handleEvents(MultiplexIO &io)
 	bufptr += cnt;
 
 	if (m_input->eof()) {
-            m_pipe->close();
 	    io.deactivate(pollidx);
+            m_pipe->close();
 	}
     }
 }
@@ -371,13 +383,325 @@ void OStream::handleEvents(MultiplexIO &io)
 	    cnt = 0;
 
 	if (!cnt) {
-            m_pipe->close();
 	    io.deactivate(pollidx);
+            m_pipe->close();
 	}
 	m_output->write(buf, cnt);
     }
 }
 
+//}}}
+//{{{ FdCopy -------------------------------------------------------------------
+
+/**
+ * Copies data between a pipe to the child and a file descriptor of the
+ * parent. Only one side is monitored at a time: the source while data
+ * can be moved, the destination while it is full. Both descriptors are
+ * non-blocking, so a slow source or destination never stalls the other
+ * descriptors of the MultiplexIO.
+ */
+class FdCopy : public ProcessFilter::IO {
+    public:
+	FdCopy(int fd, std::shared_ptr<SubProcessPipe> &&pipe, int otherfd)
+            : ProcessFilter::IO(fd, std::move(pipe)),
+              m_otherfd(otherfd), m_splice(true), m_bufptr(0), m_bufend(0)
+	{ }
+
+        virtual void handleEvents(MultiplexIO &io);
+
+    protected:
+        void setupCopy(MultiplexIO &io, int srcfd, int dstfd);
+
+	int m_otherfd;
+
+    private:
+        void waitForOutput(MultiplexIO &io, bool output);
+        void writeBuffer(MultiplexIO &io);
+        void finish(MultiplexIO &io);
+
+	int m_srcfd, m_dstfd;
+	int srcidx, dstidx;
+        bool m_splice;
+        std::vector<char> m_buf;
+        size_t m_bufptr, m_bufend;
+};
+
+// -----------------------------------------------------------------------------
+void FdCopy::setupCopy(MultiplexIO &io, int srcfd, int dstfd)
+{
+    m_srcfd = srcfd;
+    m_dstfd = dstfd;
+    Util::setNonBlocking(srcfd);
+    Util::setNonBlocking(dstfd);
+    srcidx = io.add(srcfd, POLLIN);
+    dstidx = io.add(dstfd, POLLOUT);
+    waitForOutput(io, false);
+}
+
+// -----------------------------------------------------------------------------
+void FdCopy::waitForOutput(MultiplexIO &io, bool output)
+{
+    io.setEvents(srcidx, output ? 0 : POLLIN);
+    io.setEvents(dstidx, output ? POLLOUT : 0);
+}
+
+// -----------------------------------------------------------------------------
+void FdCopy::finish(MultiplexIO &io)
+{
+    io.deactivate(srcidx);
+    io.deactivate(dstidx);
+    m_pipe->close();
+}
+
+// -----------------------------------------------------------------------------
+void FdCopy::writeBuffer(MultiplexIO &io)
+{
+    ssize_t cnt = write(m_dstfd, m_buf.data() + m_bufptr,
+                        m_bufend - m_bufptr);
+    if (cnt < 0) {
+        if (errno != EAGAIN && errno != EINTR)
+            throw KSystemError("Cannot write redirected data", errno);
+    } else
+        m_bufptr += cnt;
+
+    waitForOutput(io, m_bufptr < m_bufend);
+}
+
+// -----------------------------------------------------------------------------
+void FdCopy::handleEvents(MultiplexIO &io)
+{
+    ssize_t cnt;
+
+    // finished
+    if (io.at(srcidx).fd < 0)
+        return;
+
+    // the destination can take more data
+    if (io.at(dstidx).revents & (POLLOUT | POLLERR)) {
+        if (m_bufptr < m_bufend)
+            writeBuffer(io);
+        else
+            waitForOutput(io, false);
+        return;
+    }
+
+    if (!(io.at(srcidx).revents & (POLLIN | POLLHUP | POLLERR)))
+        return;
+
+    if (m_splice) {
+        cnt = splice(m_srcfd, NULL, m_dstfd, NULL, PROCESS_PIPE_SIZE,
+                     SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (cnt > 0 || (cnt < 0 && errno == EINTR))
+            return;
+        if (cnt == 0) {
+            finish(io);
+            return;
+        }
+        // the destination is full
+        if (errno == EAGAIN) {
+            waitForOutput(io, true);
+            return;
+        }
+        if (errno != EINVAL)
+            throw KSystemError("Cannot splice redirected data", errno);
+
+        // e.g. a file opened with O_APPEND, or a socket
+        Debug::debug()->dbg("splice() not supported for fd %d", m_otherfd);
+        m_splice = false;
+        m_buf.resize(PROCESS_COPY_SIZE);
+    }
+
+    cnt = read(m_srcfd, m_buf.data(), m_buf.size());
+    if (cnt < 0) {
+        if (errno == EAGAIN || errno == EINTR)
+            return;
+        throw KSystemError("Cannot read redirected data", errno);
+    }
+    if (cnt == 0) {
+        finish(io);
+        return;
+    }
+    m_bufptr = 0;
+    m_bufend = cnt;
+    writeBuffer(io);
+}
+
+//}}}
+//{{{ IFd ----------------------------------------------------------------------
+
+class IFd : public FdCopy {
+    public:
+	IFd(int fd, int srcfd)
+            : FdCopy(fd, make_shared<ParentToChildPipe>(PROCESS_PIPE_SIZE),
+                     srcfd)
+	{ }
+
+        virtual void setupIO(MultiplexIO &io)
+        { setupCopy(io, m_otherfd, m_pipe->writeEnd()); }
+};
+
+//}}}
+//{{{ OFd ----------------------------------------------------------------------
+
+class OFd : public FdCopy {
+    public:
+	OFd(int fd, int dstfd)
+            : FdCopy(fd, make_shared<ChildToParentPipe>(PROCESS_PIPE_SIZE),
+                     dstfd)
+	{ }
+
+        virtual void setupIO(MultiplexIO &io)
+        { setupCopy(io, m_pipe->readEnd(), m_otherfd); }
+};
+
+//}}}
+//{{{ IBuffer ------------------------------------------------------------------
+
+class IBuffer : public ProcessFilter::IO {
+    public:
+	IBuffer(int fd, const char *data, size_t len)
+            : ProcessFilter::IO(fd,
+                                make_shared<ParentToChildPipe>(
+                                    PROCESS_PIPE_SIZE)),
+              m_ptr(data), m_end(data + len)
+	{ }
+
+        virtual void setupIO(MultiplexIO &io);
+        virtual void handleEvents(MultiplexIO &io);
+
+    private:
+        const char *m_ptr, *m_end;
+	int pollidx;
+};
+
+// -----------------------------------------------------------------------------
+void IBuffer::setupIO(MultiplexIO &io)
+{
+    Util::setNonBlocking(m_pipe->writeEnd());
+    pollidx = io.add(m_pipe->writeEnd(), POLLOUT);
+}
+
+// -----------------------------------------------------------------------------
+void IBuffer::handleEvents(MultiplexIO &io)
+{
+    const struct pollfd &poll = io.at(pollidx);
+
+    if (!(poll.revents & (POLLOUT | POLLERR)))
+        return;
+
+    if (m_ptr < m_end) {
+        ssize_t cnt = write(poll.fd, m_ptr, m_end - m_ptr);
+        if (cnt < 0) {
+            if (errno == EAGAIN || errno == EINTR)
+                return;
+            throw KSystemError("Cannot send data to input pipe", errno);
+        }
+        m_ptr += cnt;
+    }
+
+    if (m_ptr >= m_end) {
+        io.deactivate(pollidx);
+        m_pipe->close();
+    }
+}
+
+//}}}
+//{{{ OBuffer ------------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+OBuffer::OBuffer(int fd, string *buffer)
+    : ProcessFilter::IO(fd, make_shared<ChildToParentPipe>(PROCESS_PIPE_SIZE)),
+      m_buffer(buffer), pollidx(-1)
+{ }
+
+// -----------------------------------------------------------------------------
+void OBuffer::setupIO(MultiplexIO &io)
+{
+    Util::setNonBlocking(m_pipe->readEnd());
+    pollidx = io.add(m_pipe->readEnd(), POLLIN);
+}
+
+// -----------------------------------------------------------------------------
+void OBuffer::handleEvents(MultiplexIO &io)
+{
+    const struct pollfd &poll = io.at(pollidx);
+
+    if (!(poll.revents & (POLLIN | POLLHUP | POLLERR)))
+        return;
+
+    // read directly into the string storage
+    size_t oldsize = m_buffer->size();
+    m_buffer->resize(oldsize + PROCESS_COPY_SIZE);
+    ssize_t cnt = read(poll.fd, &(*m_buffer)[oldsize], PROCESS_COPY_SIZE);
+    m_buffer->resize(oldsize + max(cnt, ssize_t(0)));
+
+    if (cnt < 0) {
+        if (errno == EAGAIN || errno == EINTR)
+            return;
+        throw KSystemError("Cannot get data from output pipe", errno);
+    }
+    if (cnt == 0) {
+        io.deactivate(pollidx);
+        m_pipe->close();
+    }
+}
+
+//}}}
+//{{{ OArea --------------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+OArea::OArea(int fd)
+    : ProcessFilter::IO(fd, make_shared<ChildToParentPipe>(PROCESS_PIPE_SIZE)),
+      m_area(NULL), m_size(0), m_filled(0), pollidx(-1)
+{ }
+
+// -----------------------------------------------------------------------------
+void OArea::setArea(char *area, size_t size)
+{
+    m_area = area;
+    m_size = size;
+    m_filled = 0;
+}
+
+// -----------------------------------------------------------------------------
+void OArea::setupIO(MultiplexIO &io)
+{
+    Util::setNonBlocking(m_pipe->readEnd());
+    pollidx = io.add(m_pipe->readEnd(), POLLIN);
+}
+
+// -----------------------------------------------------------------------------
+void OArea::handleEvents(MultiplexIO &io)
+{
+    if (pollidx < 0 || !isOpen())
+        return;
+
+    const struct pollfd &poll = io.at(pollidx);
+
+    if (!m_area || !(poll.revents & (POLLIN | POLLHUP | POLLERR)))
+        return;
+
+    ssize_t cnt = read(poll.fd, m_area, m_size);
+    if (cnt < 0) {
+        if (errno == EAGAIN || errno == EINTR)
+            return;
+        throw KSystemError("Cannot get data from output pipe", errno);
+    }
+    if (cnt == 0)
+        close(io);
+    else
+        m_filled = cnt;
+    m_area = NULL;
+}
+
+// -----------------------------------------------------------------------------
+void OArea::close(MultiplexIO &io)
+{
+    if (pollidx >= 0 && isOpen())
+        io.deactivate(pollidx);
+    m_pipe->close();
+}
+
 //}}}
 //{{{ ProcessFilter ------------------------------------------------------------
 
@@ -401,6 +725,34 @@ void ProcessFilter::setOutput(int fd, ostream *stream)
     setIO(io);
 }
 
+// -----------------------------------------------------------------------------
+void ProcessFilter::setInputFD(int fd, int srcfd)
+{
+    unique_ptr<IO> io(new IFd(fd, srcfd));
+    setIO(io);
+}
+
+// -----------------------------------------------------------------------------
+void ProcessFilter::setOutputFD(int fd, int dstfd)
+{
+    unique_ptr<IO> io(new OFd(fd, dstfd));
+    setIO(io);
+}
+
+// -----------------------------------------------------------------------------
+void ProcessFilter::setInputBuffer(int fd, const char *data, size_t len)
+{
+    unique_ptr<IO> io(new IBuffer(fd, data, len));
+    setIO(io);
+}
+
+// -----------------------------------------------------------------------------
+void ProcessFilter::setOutputBuffer(int fd, string *buffer)
+{
+    unique_ptr<IO> io(new OBuffer(fd, buffer));
+    setIO(io);
+}
+
 // -----------------------------------------------------------------------------
 void ProcessFilter::setStdin(std::istream *stream)
 {
@@ -21,6 +21,7 @@
 
 #include <stdint.h>
 #include <map>
+#include <string>
 #include <memory>
 
 #include "global.h"
@@ -88,10 +89,18 @@ class SubProcessPipe : public SubProcessFD {
     protected:
 
         int m_pipefd[2];
+        size_t m_size;
 
     public:
 
-        SubProcessPipe()
+        /**
+         * Prepare a new pipe.
+         *
+         * @param[in] size requested pipe buffer size (see F_SETPIPE_SZ
+         *            in fcntl(2)), or zero for the system default
+         */
+        SubProcessPipe(size_t size = 0)
+            : m_size(size)
         { m_pipefd[0] = m_pipefd[1] = -1; }
 
         ~SubProcessPipe();
@@ -129,6 +138,10 @@ class ParentToChildPipe : public SubProcessPipe {
 
     public:
 
+        ParentToChildPipe(size_t size = 0)
+            : SubProcessPipe(size)
+        { }
+
         void finalizeParent();
         void finalizeChild(int fd);
 };
@@ -143,6 +156,10 @@ class ChildToParentPipe : public SubProcessPipe {
 
     public:
 
+        ChildToParentPipe(size_t size = 0)
+            : SubProcessPipe(size)
+        { }
+
         void finalizeParent();
         void finalizeChild(int fd);
 };
@@ -312,6 +329,50 @@ class ProcessFilter {
          */
         void setOutput(int fd, std::ostream *stream);
 
+        /**
+         * Redirect input in the subprocess from a file descriptor.
+         *
+         * The data is moved with splice(2) if possible, so it is not
+         * copied to user space. The descriptor is switched to
+         * non-blocking mode, but it is not closed.
+         *
+	 * @param[in] fd file descriptor in child
+         * @param[in] srcfd file descriptor to read from
+         */
+        void setInputFD(int fd, int srcfd);
+
+        /**
+         * Redirect output from the subprocess to a file descriptor.
+         *
+         * The data is moved with splice(2) if possible, so it is not
+         * copied to user space. The descriptor is switched to
+         * non-blocking mode, but it is not closed.
+         *
+	 * @param[in] fd file descriptor in child
+         * @param[in] dstfd file descriptor to write to
+         */
+        void setOutputFD(int fd, int dstfd);
+
+        /**
+         * Redirect input in the subprocess from a memory buffer.
+         *
+	 * @param[in] fd file descriptor in child
+         * @param[in] data the input data; must stay valid until
+         *            execute() returns
+         * @param[in] len length of @c data
+         */
+        void setInputBuffer(int fd, const char *data, size_t len);
+
+        /**
+         * Append output from the subprocess to a string.
+         *
+         * The data is read directly into the string storage.
+         *
+	 * @param[in] fd file descriptor in child
+         * @param[in] buffer the string to append to
+         */
+        void setOutputBuffer(int fd, std::string *buffer);
+
 	/**
 	 * setInput/setOutput shortcuts for stdin, stdout and stderr.
 	 *
@@ -376,6 +437,12 @@ class ProcessFilter::IO {
 	 */
         virtual void handleEvents(MultiplexIO &io) = 0;
 
+	/**
+	 * Returns @c true until the parent end of the pipe is closed.
+	 */
+        bool isOpen() const
+        { return m_pipe->readEnd() >= 0 || m_pipe->writeEnd() >= 0; }
+
     protected:
 	/**
 	 * Desired file descriptor in the child.
@@ -388,6 +455,79 @@ class ProcessFilter::IO {
         std::shared_ptr<SubProcessPipe> m_pipe;
 };
 
+//}}}
+//{{{ OBuffer ------------------------------------------------------------------
+
+/**
+ * Appends the output of the child to a string.
+ */
+class OBuffer : public ProcessFilter::IO {
+    public:
+	/**
+	 * Prepare a new output buffer.
+	 *
+	 * @param[in] fd desired file descriptor in the child
+	 * @param[out] buffer the output is appended to this string
+	 */
+	OBuffer(int fd, std::string *buffer);
+
+        virtual void setupIO(MultiplexIO &io);
+        virtual void handleEvents(MultiplexIO &io);
+
+    private:
+	std::string *m_buffer;
+	int pollidx;
+};
+
+//}}}
+//{{{ OArea --------------------------------------------------------------------
+
+/**
+ * Reads the output of the child directly into a memory area supplied
+ * by the caller. Nothing is read while no area is set, so the child
+ * blocks on a full pipe until the caller is ready for more data.
+ */
+class OArea : public ProcessFilter::IO {
+    public:
+	/**
+	 * Prepare a new output area handler.
+	 *
+	 * @param[in] fd desired file descriptor in the child
+	 */
+	OArea(int fd);
+
+	/**
+	 * Set the area for the next read.
+	 *
+	 * @param[in] area start of the memory area
+	 * @param[in] size size of the memory area
+	 */
+        void setArea(char *area, size_t size);
+
+	/**
+	 * Get the number of bytes stored in the area. The area is reset
+	 * after a read, so this is non-zero only once per setArea().
+	 */
+        size_t filled() const
+        { return m_filled; }
+
+	/**
+	 * Close the pipe before the child has finished writing.
+	 *
+	 * @param[in,out] io IO multiplexer instance
+	 */
+        void close(MultiplexIO &io);
+
+        virtual void setupIO(MultiplexIO &io);
+        virtual void handleEvents(MultiplexIO &io);
+
+    private:
+	char *m_area;
+	size_t m_size;
+	size_t m_filled;
+	int pollidx;
+};
+
 //}}}
 
 #endif /* PROCESS_H */
@@ -22,9 +22,12 @@
 #include "debug.h"
 #include "read_ikconfig.h"
 #include "kerneltool.h"
+#include "kconfig.h"
 #include "util.h"
 
 using std::cout;
+using std::endl;
+using std::string;
 
 //{{{ ReadIKConfig -------------------------------------------------------------
 
@@ -49,10 +52,11 @@ void ReadIKConfig::parseArgs(const StringVector &args)
 {
     Debug::debug()->trace(__FUNCTION__);
 
-    if (args.size() != 1)
+    if (args.size() < 1)
         throw KError("kernel image required.");
 
     m_file = args[0];
+    m_options.assign(args.begin() + 1, args.end());
     Debug::debug()->dbg("file=%s", m_file.c_str());
 }
 
@@ -60,7 +64,20 @@ void ReadIKConfig::parseArgs(const StringVector &args)
 void ReadIKConfig::execute()
 {
     KernelTool kt(m_file);
-    cout << kt.extractKernelConfig();
+
+    if (m_options.empty()) {
+        cout << kt.extractKernelConfig();
+        return;
+    }
+
+    Kconfig kconfig;
+    kconfig.readFromKernel(kt);
+    for (StringVector::const_iterator it = m_options.begin();
+         it != m_options.end(); ++it) {
+        string line = kconfig.getLine(*it);
+        if (!line.empty())
+            cout << line << endl;
+    }
 }
 
 //}}}
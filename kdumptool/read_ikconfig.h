@@ -60,6 +60,7 @@ class ReadIKConfig : public Subcommand {
 
     private:
         std::string m_file;
+        StringVector m_options;
 };
 
 //}}}
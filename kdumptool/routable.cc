@@ -18,6 +18,10 @@
  */
 
 #include <algorithm>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include <string.h>
 
 #include <unistd.h>
@@ -29,6 +33,7 @@
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <poll.h>
 #include <time.h>
 
@@ -36,8 +41,10 @@
 #include "routable.h"
 #include "stringutil.h"
 #include "debug.h"
+#include "multiplexio.h"
 
 using std::min;
+using std::string;
 
 //{{{ NetLink ------------------------------------------------------------------
 
@@ -58,7 +65,10 @@ class NetLink {
 
 	int checkRoute(const struct addrinfo *ai);
 
-	int waitRouteChange(void);
+	bool drain(void);
+
+	int fd(void) const
+	{ return m_fd; }
 
         const char *prefSrc(void) const
         { return m_prefsrc; }
@@ -258,12 +268,32 @@ int NetLink::receive(const RecvCheck &rc)
 }
 
 // -----------------------------------------------------------------------------
-int NetLink::waitRouteChange(void)
+bool NetLink::drain(void)
 {
-    Debug::debug()->trace("waitRouteChange()");
+    bool changed = false;
 
-    RouteRecvCheck rc;
-    return receive(rc);
+    while (1) {
+	ssize_t len = recv(m_fd, m_buffer, m_buflen, MSG_DONTWAIT);
+	if (len < 0) {
+	    if (errno == EAGAIN || errno == EWOULDBLOCK)
+		return changed;
+	    if (errno == EINTR)
+		continue;
+	    // ENOBUFS: messages were lost, so assume a change
+	    if (errno == ENOBUFS)
+		return true;
+	    throw KSystemError("Cannot receive netlink message", errno);
+	}
+	if (!len)
+	    throw KError("EOF on netlink receive");
+
+	struct nlmsghdr *nh;
+	RouteRecvCheck rc;
+	for (nh = (struct nlmsghdr*)m_buffer; NLMSG_OK(nh, len);
+	     nh = NLMSG_NEXT(nh, len))
+	    if (rc.check(NULL, nh))
+		changed = true;
+    }
 }
 
 // -----------------------------------------------------------------------------
@@ -454,11 +484,23 @@ bool Routable::hasRoute(void)
 }
 
 // -----------------------------------------------------------------------------
-bool Routable::resolve(void)
+static int msecsUntil(const struct timespec &ts)
+{
+    struct timespec tsnow;
+    clock_gettime(CLOCK_MONOTONIC, &tsnow);
+    long long msecs = (ts.tv_sec - tsnow.tv_sec) * 1000LL;
+    msecs += (ts.tv_nsec - tsnow.tv_nsec) / 1000000L;
+    return msecs > 0 ? msecs : 0;
+}
+
+// -----------------------------------------------------------------------------
+// Resolve a host name. Returns 0 on success, a getaddrinfo() error code
+// if the name cannot be resolved (yet), or throws on a fatal error.
+static int resolveHost(const string &host, struct addrinfo **ai)
 {
     struct addrinfo hints;
     int res;
-    KString raw_host(m_host);
+    KString raw_host(host);
 
     // remove IPv6 URL bracketing for getaddrinfo
     if (raw_host.size() > 0 &&
@@ -467,16 +509,13 @@ bool Routable::resolve(void)
 
     Debug::debug()->trace("resolve(%s)", raw_host.c_str());
 
-    if (m_ai)
-	freeaddrinfo(m_ai);
-
     memset(&hints, 0, sizeof hints);
     hints.ai_family = AF_UNSPEC;
     hints.ai_socktype = SOCK_RAW;
-    res = getaddrinfo(raw_host.c_str(), NULL, &hints, &m_ai);
+    res = getaddrinfo(raw_host.c_str(), NULL, &hints, ai);
 
     if (res == 0)
-	return true;
+	return 0;
 
     if (res == EAI_SYSTEM)
 	throw KSystemError("Name resolution failed", errno);
@@ -485,44 +524,247 @@ bool Routable::resolve(void)
         res != EAI_AGAIN)
 	throw KGaiError("Name resolution failed", res);
 
-    return false;
+    return res;
+}
+
+//{{{ ResolveJob ---------------------------------------------------------------
+
+/**
+ * Name resolution in a separate thread. An attempt is made regularly until
+ * the hostname can be resolved or the timeout is reached.
+ *
+ * The job is shared between the thread and the caller, so the caller may
+ * stop waiting while getaddrinfo() is still blocked; the thread is detached
+ * and frees the result if nobody takes it.
+ */
+class ResolveJob {
+
+    public:
+	enum State { RUNNING, RESOLVED, FAILED };
+
+	ResolveJob(const string &host, const struct timespec &tstop,
+		   int notifyfd)
+	    : m_host(host), m_tstop(tstop), m_notifyfd(notifyfd),
+	      m_state(RUNNING), m_cancelled(false), m_ai(NULL)
+	{}
+
+	~ResolveJob()
+	{
+	    if (m_ai)
+		freeaddrinfo(m_ai);
+	}
+
+	static void run(std::shared_ptr<ResolveJob> job);
+
+	void cancel()
+	{
+	    std::lock_guard<std::mutex> lock(m_mutex);
+	    m_cancelled = true;
+	    m_notifyfd = -1;
+	}
+
+	State state()
+	{
+	    std::lock_guard<std::mutex> lock(m_mutex);
+	    return m_state;
+	}
+
+	// take ownership of the result
+	struct addrinfo *take()
+	{
+	    std::lock_guard<std::mutex> lock(m_mutex);
+	    struct addrinfo *ai = m_ai;
+	    m_ai = NULL;
+	    return ai;
+	}
+
+	const string &error() const
+	{ return m_error; }
+
+    private:
+	void finish(State state, struct addrinfo *ai);
+
+	string m_host;
+	struct timespec m_tstop;
+	int m_notifyfd;
+
+	std::mutex m_mutex;
+	State m_state;
+	bool m_cancelled;
+	struct addrinfo *m_ai;
+	string m_error;
+};
+
+// -----------------------------------------------------------------------------
+void ResolveJob::finish(State state, struct addrinfo *ai)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_state = state;
+    m_ai = ai;
+    if (m_notifyfd >= 0) {
+	char c = 0;
+	if (write(m_notifyfd, &c, 1) < 0)
+	    Debug::debug()->dbg("Cannot notify resolver: %s",
+				strerror(errno));
+    }
+}
+
+// -----------------------------------------------------------------------------
+void ResolveJob::run(std::shared_ptr<ResolveJob> job)
+{
+    struct addrinfo *ai = NULL;
+    try {
+	while (resolveHost(job->m_host, &ai) != 0) {
+	    int interval;
+	    {
+		std::lock_guard<std::mutex> lock(job->m_mutex);
+		if (job->m_cancelled)
+		    return;
+	    }
+	    interval = msecsUntil(job->m_tstop);
+	    if (interval <= 0) {
+		job->m_error = "Cannot resolve " + job->m_host;
+		job->finish(FAILED, NULL);
+		return;
+	    }
+
+	    // Sleep, at most for 1 second.
+	    struct timespec wait_period;
+	    interval = min(interval, 1000);
+	    wait_period.tv_sec = interval / 1000;
+	    wait_period.tv_nsec = (interval % 1000) * 1000 * 1000;
+	    nanosleep(&wait_period, NULL);
+	}
+    } catch (const std::exception &error) {
+	job->m_error = error.what();
+	job->finish(FAILED, NULL);
+	return;
+    }
+
+    job->finish(RESOLVED, ai);
 }
 
+//}}}
+
 // -----------------------------------------------------------------------------
 bool Routable::check(int timeout)
 {
-    // Resolve the target hostname. An attempt is made regularly until the
-    // hostname can be resolved or a specified timeout for network operations
-    // is reached.
+    std::vector<Routable *> targets(1, this);
+    return checkFirst(targets, timeout) == 0;
+}
+
+// -----------------------------------------------------------------------------
+int Routable::checkFirst(const std::vector<Routable *> &targets, int timeout)
+{
+    enum { RESOLVING, NO_ROUTE, REACHABLE, UNREACHABLE };
+
+    Debug::debug()->trace("Routable::checkFirst(%zu targets, %d)",
+			  targets.size(), timeout);
+
     struct timespec tstop;
     clock_gettime(CLOCK_MONOTONIC, &tstop);
     tstop.tv_sec += timeout;
 
-    while (!resolve()) {
-        struct timespec tsnow;
-        clock_gettime(CLOCK_MONOTONIC, &tsnow);
-        int interval = (tstop.tv_sec - tsnow.tv_sec) * 1000;
-        interval += (tstop.tv_nsec - tsnow.tv_nsec) / 1000000L;
-        if (interval <= 0)
-            return false;
-
-        // Sleep, at most for 1 second.
-        struct timespec wait_period;
-        interval = min(interval, 1000);
-        wait_period.tv_sec = interval / 1000;
-        wait_period.tv_nsec = (interval % 1000) * 1000 * 1000;
-        nanosleep(&wait_period, NULL);
-    }
-
-    // Check there is an existing route.
+    // subscribe before the first check, so no route change is missed
     NetLink nl(RTMGRP_IPV4_ROUTE | RTMGRP_IPV6_ROUTE);
-    nl.setTimeout(timeout);
 
-    while (!hasRoute())
-	if (nl.waitRouteChange() != 0)
-	    return false;
+    // resolver threads wake up the loop through a pipe
+    int notify[2];
+    if (pipe2(notify, O_CLOEXEC | O_NONBLOCK) < 0)
+	throw KSystemError("Cannot create resolver pipe", errno);
+
+    std::vector<std::shared_ptr<ResolveJob> > jobs;
+    std::vector<int> state(targets.size(), RESOLVING);
+    int ret = -1;
+    try {
+	for (size_t i = 0; i < targets.size(); ++i) {
+	    jobs.push_back(std::make_shared<ResolveJob>(
+		targets[i]->m_host, tstop, notify[1]));
+	    std::thread(ResolveJob::run, jobs.back()).detach();
+	}
 
-    return true;
+	MultiplexIO io;
+	int notifyidx = io.add(notify[0], POLLIN);
+	int nlidx = io.add(nl.fd(), POLLIN);
+	bool recheck = false;
+
+	while (1) {
+	    // the first target which is not unreachable decides
+	    size_t i;
+	    for (i = 0; i < targets.size(); ++i)
+		if (state[i] != UNREACHABLE)
+		    break;
+	    if (i >= targets.size())
+		break;
+	    if (state[i] == REACHABLE) {
+		ret = i;
+		break;
+	    }
+
+	    int interval = msecsUntil(tstop);
+	    if (interval <= 0) {
+		// no more waiting for routes, but a name lookup which
+		// is in progress is always finished
+		bool resolving = false;
+		for (i = 0; i < targets.size(); ++i) {
+		    if (state[i] == NO_ROUTE)
+			state[i] = UNREACHABLE;
+		    else if (state[i] == RESOLVING)
+			resolving = true;
+		}
+		if (!resolving)
+		    continue;
+		interval = -1;
+	    }
+
+	    io.monitor(interval);
+
+	    if (io.at(notifyidx).revents) {
+		char buf[64];
+		while (read(notify[0], buf, sizeof buf) > 0)
+		    ;
+		for (i = 0; i < targets.size(); ++i) {
+		    if (state[i] != RESOLVING)
+			continue;
+		    ResolveJob::State js = jobs[i]->state();
+		    if (js == ResolveJob::FAILED) {
+			Debug::debug()->dbg("%s", jobs[i]->error().c_str());
+			state[i] = UNREACHABLE;
+		    } else if (js == ResolveJob::RESOLVED) {
+			if (targets[i]->m_ai)
+			    freeaddrinfo(targets[i]->m_ai);
+			targets[i]->m_ai = jobs[i]->take();
+			state[i] = NO_ROUTE;
+			recheck = true;
+		    }
+		}
+	    }
+
+	    if (io.at(nlidx).revents && nl.drain())
+		recheck = true;
+
+	    if (recheck) {
+		for (i = 0; i < targets.size(); ++i)
+		    if (state[i] == NO_ROUTE && targets[i]->hasRoute())
+			state[i] = REACHABLE;
+		recheck = false;
+	    }
+	}
+    } catch (...) {
+	for (size_t i = 0; i < jobs.size(); ++i)
+	    jobs[i]->cancel();
+	close(notify[0]);
+	close(notify[1]);
+	throw;
+    }
+
+    for (size_t i = 0; i < jobs.size(); ++i)
+	jobs[i]->cancel();
+    close(notify[0]);
+    close(notify[1]);
+
+    Debug::debug()->dbg("Preferred reachable target: %d", ret);
+    return ret;
 }
 
 //}}}
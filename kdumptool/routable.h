@@ -20,6 +20,7 @@
 #define ROUTABLE_H
 
 #include <string>
+#include <vector>
 
 #include "subcommand.h"
 #include "global.h"
@@ -40,18 +41,43 @@ class Routable {
 
 	~Routable();
 
+	Routable(const Routable &) = delete;
+	Routable &operator=(const Routable &) = delete;
+
+	/**
+	 * Wait until the target can be resolved and has a route.
+	 *
+	 * @param[in] timeout max time to wait (in seconds)
+	 * @return @c true if the target is reachable
+	 */
 	bool check(int timeout);
 
+	/**
+	 * Check several targets concurrently.
+	 *
+	 * All host names are resolved in parallel, and one netlink socket
+	 * watches route changes for all of them. The check finishes as soon
+	 * as a target is reachable and all targets before it in @p targets
+	 * are known to be unreachable, i.e. the first reachable target in
+	 * order of preference is found without waiting for the others.
+	 *
+	 * @param[in] targets targets in order of preference
+	 * @param[in] timeout max time to wait (in seconds)
+	 * @return index of the preferred reachable target, or -1
+	 */
+	static int checkFirst(const std::vector<Routable *> &targets,
+			      int timeout);
+
         const std::string& prefsrc(void) const
         { return m_prefsrc; }
 
-    protected:
-	bool resolve(void);
+        const std::string& host(void) const
+        { return m_host; }
 
+    protected:
 	bool hasRoute(void);
 
     private:
-	int m_nlfd;
 	std::string m_host;
         std::string m_prefsrc;
 	struct addrinfo *m_ai;
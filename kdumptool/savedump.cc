@@ -19,11 +19,18 @@
 #include <iostream>
 #include <string>
 #include <list>
+#include <vector>
 #include <strings.h>
 #include <cerrno>
 #include <memory>
 #include <sstream>
 #include <fstream>
+#include <cstring>
+#include <climits>
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
 
 #include "subcommand.h"
 #include "debug.h"
@@ -34,15 +41,19 @@
 #include "transfer.h"
 #include "sshtransfer.h"
 #include "configuration.h"
+#include "configparser.h"
 #include "dataprovider.h"
 #include "progress.h"
 #include "stringutil.h"
 #include "vmcoreinfo.h"
+#include "vmcoreindex.h"
 #include "identifykernel.h"
 #include "email.h"
 #include "routable.h"
 #include "calibrate.h"
 #include "stringvector.h"
+#include "kerneltool.h"
+#include "timeline.h"
 
 using std::string;
 using std::list;
@@ -61,8 +72,11 @@ using std::getenv;
 // -----------------------------------------------------------------------------
 SaveDump::SaveDump()
     : m_dump(DEFAULT_DUMP), m_nomail(false),
-      m_split(0), m_transfer(nullptr), m_usedDirectSave(false),
-      m_useMakedumpfile(false), m_threads(0), m_crashtime(0)
+      m_split(0), m_transfer(nullptr), m_vmcoreIndex(nullptr),
+      m_estimator(nullptr), m_usedDirectSave(false),
+      m_useMakedumpfile(false), m_threads(0), m_crashtime(0),
+      m_pagesize(sysconf(_SC_PAGESIZE)), m_dumplevel(0),
+      m_mailQueue(nullptr)
 {
 }
 
@@ -72,6 +86,26 @@ SaveDump::~SaveDump()
     Debug::debug()->trace("SaveDump::~SaveDump()");
 
     delete m_transfer;
+    delete m_vmcoreIndex;
+
+#if HAVE_LIBESMTP
+    // give pending notifications a bounded time to go out
+    if (m_mailQueue) {
+        int timeout = Configuration::config()->KDUMP_NET_TIMEOUT.value();
+        if (!m_mailQueue->wait(timeout))
+            cerr << "WARNING: Notification email not sent within "
+                 << timeout << " seconds." << endl;
+        delete m_mailQueue;
+    }
+#endif // HAVE_LIBESMTP
+}
+
+// -----------------------------------------------------------------------------
+const VmcoreIndex &SaveDump::vmcoreIndex()
+{
+    if (!m_vmcoreIndex)
+        m_vmcoreIndex = new VmcoreIndex(m_dump);
+    return *m_vmcoreIndex;
 }
 
 // -----------------------------------------------------------------------------
@@ -85,6 +119,7 @@ int SaveDump::create()
         throw KError("The dump file " + m_dump + " does not exist.");
 
     try {
+        TimelinePhase phase("read VMCOREINFO");
         fillVmcoreinfo();
     } catch (const KError &error) {
         Debug::debug()->dbg("Error when reading VMCOREINFO: %s", error.what());
@@ -95,30 +130,67 @@ int SaveDump::create()
     string subdir = StringUtil::formatUnixTime(ISO_DATETIME, m_crashtime);
     RootDirURLVector urlv;
     std::istringstream iss(config->KDUMP_SAVEDIR.value());
+    std::vector<FilePath> elems;
+    std::vector<std::unique_ptr<Routable> > routables;
+    std::vector<Routable *> probes;
     FilePath elem;
     while (iss >> elem) {
         RootDirURL url(elem, m_rootdir);
         if (url.getProtocol() != URLParser::PROT_FILE) {
-            Routable rt(url.getHostname());
-            if (!rt.check(config->KDUMP_NET_TIMEOUT.value())) {
-                cerr << "WARNING: Dump target not reachable" << endl;
-                elem.appendPath(string("unknown-") + subdir);
-            } else
-                elem.appendPath(rt.prefsrc() + '-' + subdir);
+            routables.emplace_back(new Routable(url.getHostname()));
+            probes.push_back(routables.back().get());
         } else
+            routables.emplace_back();
+        elems.push_back(elem);
+    }
+
+    // network targets are checked concurrently; the first reachable
+    // one is moved to the front, because only that one is used
+    int preferred = -1;
+    if (!probes.empty()) {
+        TimelinePhase phase("probe network targets");
+        preferred = Routable::checkFirst(probes,
+                                         config->KDUMP_NET_TIMEOUT.value());
+    }
+
+    int probe = 0;
+    for (size_t i = 0; i < elems.size(); ++i) {
+        elem = elems[i];
+        bool chosen = false;
+        if (!routables[i])
             elem.appendPath(subdir);
-        urlv.push_back(RootDirURL(elem, m_rootdir));
+        else if (probe == preferred) {
+            elem.appendPath(routables[i]->prefsrc() + '-' + subdir);
+            chosen = true;
+        } else {
+            if (preferred < 0 || probe < preferred)
+                cerr << "WARNING: Dump target " << routables[i]->host()
+                     << " not reachable" << endl;
+            elem.appendPath(string("unknown-") + subdir);
+        }
+        if (routables[i])
+            ++probe;
+
+        RootDirURL url(elem, m_rootdir);
+        if (chosen)
+            urlv.insert(urlv.begin(), url);
+        else
+            urlv.push_back(url);
     }
 
     m_transfer = getTransfer(urlv);
 
+    // the crash notice goes out while the dump is saved
+    sendNotification(NOTIFY_CRASH, urlv);
+
     // save the dump
     try {
+        TimelinePhase phase("save dmesg and vmcore");
         saveDump(urlv);
     } catch (const KError &error) {
         ret = 1;
 
-        sendNotification(true, urlv);
+        sendNotification(NOTIFY_FAILED, urlv);
 
         // run checkAndDelete() in any case
         try {
@@ -133,13 +205,15 @@ int SaveDump::create()
             throw;
     }
 
-    // send the email afterwards
-    sendNotification(false, urlv);
+    // send the follow-up
+    if (ret == 0)
+        sendNotification(NOTIFY_SAVED, urlv);
 
     // because we don't know the file size in advance, check
     // afterwards if the disk space is not sufficient and delete
     // the dump again
     try {
+        TimelinePhase phase("check disk space");
         checkAndDelete(urlv);
     } catch (const KError &error) {
         ret = 1;
@@ -151,6 +225,7 @@ int SaveDump::create()
 
     // copy the makedumpfile-R.pl
     try {
+        TimelinePhase phase("copy makedumpfile-R.pl");
         if (!m_usedDirectSave && m_useMakedumpfile)
             copyMakedumpfile();
     } catch (const KError &error) {
@@ -174,6 +249,7 @@ int SaveDump::create()
 
     // generate the README file
     try {
+        TimelinePhase phase("generate README");
         generateInfo();
     } catch (const KError &error) {
         ret = 1;
@@ -186,8 +262,9 @@ int SaveDump::create()
     // copy kernel
     if (m_crashrelease.size() > 0) {
         try {
+            TimelinePhase phase("copy kernel");
             if (config->KDUMP_COPY_KERNEL.value())
-                copyKernel();
+                copyKernel(urlv);
         } catch (const KError &error) {
             ret = 1;
             if (config->KDUMP_CONTINUE_ON_ERROR.value())
@@ -200,6 +277,13 @@ int SaveDump::create()
             "crash kernel release.");
     }
 
+    // the timeline goes last to include all of the above
+    try {
+        saveTimeline();
+    } catch (const KError &error) {
+        cerr << "Cannot save the timeline: " << error.what() << endl;
+    }
+
     return ret;
 }
 
@@ -227,10 +311,14 @@ void SaveDump::saveDump(const RootDirURLVector &urlv)
 
     // Save a copy of dmesg
     try {
-        string directCmdline = "makedumpfile --dump-dmesg " + m_dump;
-	string pipeCmdline = "makedumpfile --dump-dmesg -F " + m_dump;
-	ProcessDataProvider logProvider(
-	    pipeCmdline.c_str(), directCmdline.c_str());
+        TimelinePhase phase("save dmesg");
+        StringVector directArgs;
+        directArgs.push_back("makedumpfile");
+        directArgs.push_back("--dump-dmesg");
+        directArgs.push_back(m_dump);
+        StringVector pipeArgs = directArgs;
+        pipeArgs.push_back("-F");
+	ProcessDataProvider logProvider(pipeArgs, directArgs);
 
 	cout << "Extracting dmesg" << endl;
 	terminal.printLine();
@@ -259,6 +347,7 @@ void SaveDump::saveDump(const RootDirURLVector &urlv)
     bool useSnappy = strcasecmp(dumpformat.c_str(), "snappy") == 0;
     bool useZstd = strcasecmp(dumpformat.c_str(), "zstd") == 0;
 
+    m_dumplevel = dumplevel;
     if (noDump)
 	return;			// nothing to be done
 
@@ -289,50 +378,89 @@ void SaveDump::saveDump(const RootDirURLVector &urlv)
         }
     }
 
+    // spread the dump over all local targets if requested, or write
+    // one file which can be mirrored
+    FileTransfer::Policy policy =
+        FileTransfer::parsePolicy(config->KDUMP_SAVEDIR_POLICY.value());
+    if (urlv.size() > 1 &&
+        urlv.front().getProtocol() == URLParser::PROT_FILE) {
+        if (policy == FileTransfer::POLICY_MIRROR) {
+            if (m_split)
+                cerr << "Splitting is disabled for mirrored targets." << endl;
+            m_split = 0;
+        } else if (policy == FileTransfer::POLICY_STRIPE && !useElf &&
+                   !config->kdumptoolContainsFlag("SINGLE") &&
+                   m_split < urlv.size()) {
+            // makedumpfile cannot combine --split and --num-threads
+            if (m_threads)
+                cerr << "Multithreading is disabled for striped targets."
+                     << endl;
+            m_split = urlv.size();
+            m_threads = 0;
+        }
+    }
+
+    // the index exists already if VMCOREINFO was found, i.e. the dump
+    // is known to be an ELF file
     bool excludeDomU = false;
     if (!config->kdumptoolContainsFlag("XENALLDOMAINS") &&
-	Util::isXenCoreDump(m_dump.c_str()))
+	(m_vmcoreIndex || Util::isElfFile(m_dump)) && vmcoreIndex().isXen())
       excludeDomU = true;
 
+    // unknown formats are saved uncompressed, like ELF
+    DumpEstimator::Format format = DumpEstimator::FMT_ELF;
+    try {
+        format = DumpEstimator::parseFormat(dumpformat);
+    } catch (const KError &error) {
+        Debug::debug()->dbg("%s", error.what());
+    }
+    TimelinePhase preflightPhase("estimate dump size");
+    dumplevel = m_dumplevel = preflight(urlv, dumplevel, format);
+    preflightPhase.end();
+
     if (useElf && dumplevel == 0 && !excludeDomU) {
         // use file source?
         provider = new FileDataProvider(m_dump.c_str());
         m_useMakedumpfile = false;
     } else {
         // use makedumpfile
-        ostringstream cmdline;
-        cmdline << "makedumpfile ";
+        StringVector args;
+        args.push_back("makedumpfile");
 	if (m_split)
-	    cmdline << "--split ";
+	    args.push_back("--split");
         if (m_threads) {
-	    SystemCPU syscpu;
-            cmdline << "--num-threads " << m_threads << " ";
+            args.push_back("--num-threads");
+            args.push_back(StringUtil::number2string(m_threads));
         }
-        cmdline << config->MAKEDUMPFILE_OPTIONS.value() << " ";
-        cmdline << "-d " << config->KDUMP_DUMPLEVEL.value() << " ";
+        // the options are split like shell words
+        StringVector options = ShellConfigParser::splitWords(
+            config->MAKEDUMPFILE_OPTIONS.value());
+        args.insert(args.end(), options.begin(), options.end());
+        args.push_back("-d");
+        args.push_back(StringUtil::number2string(dumplevel));
 	if (excludeDomU)
-	    cmdline << "-X ";
+	    args.push_back("-X");
         if (useElf)
-            cmdline << "-E ";
+            args.push_back("-E");
         if (useCompressed)
-            cmdline << "-c ";
+            args.push_back("-c");
         if (useLZO)
-            cmdline << "-l ";
+            args.push_back("-l");
 	if (useSnappy)
-	    cmdline << "-p ";
+	    args.push_back("-p");
         if (useZstd)
-            cmdline << "-z ";
-        cmdline << m_dump;
+            args.push_back("-z");
+        args.push_back(m_dump);
 
-        string directCmdline = cmdline.str();
-        string pipeCmdline = cmdline.str() + " -F"; // flattened format
+        StringVector pipeArgs = args;
+        pipeArgs.push_back("-F"); // flattened format
 
-        provider = new ProcessDataProvider(pipeCmdline.c_str(),
-            directCmdline.c_str());
+        provider = new ProcessDataProvider(pipeArgs, args);
         m_useMakedumpfile = true;
     }
 
     try {
+        TimelinePhase phase("save vmcore");
         if (m_useMakedumpfile) {
             cout << "Saving dump using makedumpfile" << endl;
             terminal.printLine();
@@ -439,7 +567,7 @@ void SaveDump::generateRearrange()
 void SaveDump::fillVmcoreinfo()
 {
     Vmcoreinfo vm;
-    vm.readFromELF(m_dump.c_str());
+    vm.readFromIndex(vmcoreIndex());
 
     try {
         m_crashtime = vm.getLLongValue("CRASHTIME");
@@ -456,8 +584,22 @@ void SaveDump::fillVmcoreinfo()
         Debug::debug()->dbg("Error getting OSRELEASE: %s", error.what());
     }
 
-    Debug::debug()->dbg("Using crashtime: %lld, crashrelease: %s",
-        m_crashtime, m_crashrelease.c_str());
+    try {
+        m_pagesize = vm.getIntValue("PAGESIZE");
+    } catch (const KError &error) {
+        Debug::debug()->dbg("Error getting PAGESIZE: %s", error.what());
+    }
+
+    // available since Linux 5.9
+    try {
+        m_crashbuildid = vm.getStringValue("BUILD-ID");
+    } catch (const KError &error) {
+        Debug::debug()->dbg("Error getting BUILD-ID: %s", error.what());
+    }
+
+    Debug::debug()->dbg("Using crashtime: %lld, crashrelease: %s, "
+        "build-id: %s", m_crashtime, m_crashrelease.c_str(),
+        m_crashbuildid.c_str());
 }
 
 // -----------------------------------------------------------------------------
@@ -488,7 +630,7 @@ void SaveDump::generateInfo()
     if (m_crashrelease.size() > 0)
         infoLine(ss, "Kernel version", m_crashrelease);
     infoLine(ss, "Host", m_hostname);
-    infoLine(ss, "Dump level", config->KDUMP_DUMPLEVEL.value());
+    infoLine(ss, "Dump level", m_dumplevel);
     infoLine(ss, "Dump format", config->KDUMP_DUMPFORMAT.value());
     if (m_split && m_usedDirectSave)
         infoLine(ss, "Split parts", m_split);
@@ -513,36 +655,138 @@ void SaveDump::generateInfo()
 }
 
 // -----------------------------------------------------------------------------
-void SaveDump::copyKernel()
+void SaveDump::saveTimeline()
 {
-    Debug::debug()->trace("SaveDump::copyKernel()");
+    Timeline *timeline = Timeline::timeline();
+    if (timeline->empty())
+        return;
 
-    Configuration *config = Configuration::config();
+    ostringstream ss;
+    timeline->print(ss);
+
+    string const& s = ss.str();
+    BufferDataProvider provider(s.c_str(), s.size());
+    cout << "Saving timeline" << endl;
+    m_transfer->perform(&provider, "timeline.txt", NULL);
+}
+
+// -----------------------------------------------------------------------------
+static string buildIdOf(const FilePath &path)
+{
+    try {
+        return KernelTool(path).getBuildId();
+    } catch (const KError &error) {
+        Debug::debug()->dbg("Cannot get build-id of %s: %s",
+                            path.c_str(), error.what());
+        return string();
+    }
+}
+
+// -----------------------------------------------------------------------------
+void SaveDump::copyKernel(const RootDirURLVector &urlv)
+{
+    Debug::debug()->trace("SaveDump::copyKernel()");
 
-    FilePath mapfile = findMapfile();
     FilePath kernel = findKernel();
+    FilePath mapfile = findMapfile();
+    FilePath debuginfo = findDebuginfo();
     FilePath fp;
 
-    // mapfile
-    TerminalProgress mapProgress("Copying System.map");
+    // single files are always saved to the first target
+    FilePath target, previous;
+    if (urlv.front().getProtocol() == URLParser::PROT_FILE) {
+        target = urlv.front().getRealPath();
+        (fp = m_rootdir).appendPath(kernel);
+        previous = findPreviousDump(target, fp);
+    }
+
     (fp = m_rootdir).appendPath(mapfile);
-    FileDataProvider mapProvider(fp.c_str());
-    if (config->KDUMP_VERBOSE.value()
-	& Configuration::VERB_PROGRESS)
-        mapProvider.setProgress(&mapProgress);
-    else
-        cout << "Copying System.map" << endl;
-    m_transfer->perform(&mapProvider, mapfile.baseName().c_str());
+    copyFile(fp, "System.map", target, previous);
 
-    TerminalProgress kernelProgress("Copying kernel");
     (fp = m_rootdir).appendPath(kernel);
-    FileDataProvider kernelProvider(fp.c_str());
+    copyFile(fp, "kernel", target, previous);
+
+    if (!debuginfo.empty())
+        copyFile(debuginfo, "debuginfo", target, previous);
+}
+
+// -----------------------------------------------------------------------------
+void SaveDump::copyFile(const FilePath &file, const char *what,
+                        const FilePath &target, const FilePath &previous)
+{
+    Debug::debug()->trace("SaveDump::copyFile(%s, %s, %s, %s)",
+        file.c_str(), what, target.c_str(), previous.c_str());
+
+    Configuration *config = Configuration::config();
+    string name = file.baseName();
+
+    // an identical file from a previous dump can be hard-linked
+    if (!previous.empty()) {
+        FilePath src = previous, dst = target;
+        src.appendPath(name);
+        dst.appendPath(name);
+
+        struct stat srcstat, filestat;
+        if (stat(src.c_str(), &srcstat) == 0 &&
+            stat(file.c_str(), &filestat) == 0 &&
+            srcstat.st_size == filestat.st_size) {
+            if (link(src.c_str(), dst.c_str()) == 0) {
+                cout << "Linking " << what << " from " << previous << endl;
+                return;
+            }
+            Debug::debug()->dbg("Cannot link %s to %s: %s",
+                src.c_str(), dst.c_str(), strerror(errno));
+        }
+    }
+
+    TerminalProgress progress(string("Copying ") + what);
+    FileDataProvider provider(file.c_str());
     if (config->KDUMP_VERBOSE.value()
 	& Configuration::VERB_PROGRESS)
-        kernelProvider.setProgress(&kernelProgress);
+        provider.setProgress(&progress);
     else
-        cout << "Copying kernel" << endl;
-    m_transfer->perform(&kernelProvider, kernel.baseName().c_str());
+        cout << "Copying " << what << endl;
+    m_transfer->perform(&provider, name.c_str());
+}
+
+// -----------------------------------------------------------------------------
+FilePath SaveDump::findPreviousDump(const FilePath &target,
+                                    const FilePath &kernel)
+{
+    Debug::debug()->trace("SaveDump::findPreviousDump(%s, %s)",
+                          target.c_str(), kernel.c_str());
+
+    if (m_crashbuildid.empty())
+        return FilePath();
+
+    FilePath savedir = target.dirName();
+    string current = target.baseName();
+    string name = kernel.baseName();
+
+    StringVector dumps;
+    try {
+        dumps = savedir.listDir(FilterKdumpDirs());
+    } catch (const KError &error) {
+        Debug::debug()->dbg("%s", error.what());
+        return FilePath();
+    }
+
+    // the most recent dumps are the most likely ones
+    for (StringVector::reverse_iterator it = dumps.rbegin();
+         it != dumps.rend(); ++it) {
+        if (*it == current)
+            continue;
+
+        FilePath dir = savedir, fp;
+        dir.appendPath(*it);
+        (fp = dir).appendPath(name);
+        if (fp.exists() && buildIdOf(fp) == m_crashbuildid) {
+            Debug::debug()->dbg("Kernel already saved in %s", dir.c_str());
+            return dir;
+        }
+    }
+
+    return FilePath();
 }
 
 // -----------------------------------------------------------------------------
@@ -550,6 +794,67 @@ string SaveDump::findKernel()
 {
     Debug::debug()->trace("SaveDump::findKernel()");
 
+    if (m_crashbuildid.empty())
+        return findKernelByName();
+
+    FilePath binary, binaryroot;
+    try {
+        binary = findKernelByName();
+        (binaryroot = m_rootdir).appendPath(binary);
+
+        // images without a build-id (e.g. compressed) cannot be
+        // compared; trust the name in that case
+        string buildid = buildIdOf(binaryroot);
+        if (buildid.empty() || buildid == m_crashbuildid)
+            return binary;
+    } catch (const KError &error) {
+        Debug::debug()->dbg("%s", error.what());
+    }
+
+    // look at all kernel images in /boot
+    FilePath boot = m_rootdir;
+    boot.appendPath("/boot");
+    StringVector files;
+    try {
+        files = boot.listDir(FilterDots());
+    } catch (const KError &error) {
+        Debug::debug()->dbg("%s", error.what());
+    }
+
+    static const char *const prefixes[] = {
+        "vmlinux-", "vmlinuz-", "image-", "Image-"
+    };
+    for (StringVector::const_iterator it = files.begin();
+         it != files.end(); ++it) {
+        const KString &name = *it;
+        for (size_t i = 0; i < sizeof(prefixes)/sizeof(prefixes[0]); ++i) {
+            if (!name.startsWith(prefixes[i]))
+                continue;
+
+            FilePath fp = boot;
+            fp.appendPath(name);
+            Debug::debug()->dbg("Trying build-id of %s", fp.c_str());
+            if (buildIdOf(fp) == m_crashbuildid) {
+                (binary = "/boot").appendPath(name);
+                return binary;
+            }
+            break;
+        }
+    }
+
+    if (binary.empty())
+        throw KError("No kernel image found in " + boot);
+
+    Debug::debug()->info("No kernel image in %s matches build-id %s. "
+        "Using %s.", boot.c_str(), m_crashbuildid.c_str(), binary.c_str());
+    return binary;
+}
+
+// -----------------------------------------------------------------------------
+string SaveDump::findKernelByName()
+{
+    Debug::debug()->trace("SaveDump::findKernelByName()");
+
     // find the kernel binary
     FilePath binary, binaryroot;
 
@@ -619,6 +924,139 @@ string SaveDump::findMapfile()
     throw KError("No System.map found in " + fp);
 }
 
+// -----------------------------------------------------------------------------
+FilePath SaveDump::findDebuginfo()
+{
+    Debug::debug()->trace("SaveDump::findDebuginfo()");
+
+    FilePath debug;
+
+    // 1: build-id link
+    if (m_crashbuildid.size() > 2) {
+        (debug = m_rootdir).appendPath("/usr/lib/debug/.build-id");
+        debug.appendPath(m_crashbuildid.substr(0, 2));
+        debug.appendPath(m_crashbuildid.substr(2) + ".debug");
+        Debug::debug()->dbg("Trying %s", debug.c_str());
+        if (debug.exists())
+            return m_rootdir.empty()
+                ? debug.getCanonicalPath()
+                : debug.getCanonicalPath(m_rootdir);
+    }
+
+    // 2: file name
+    (debug = m_rootdir).appendPath("/usr/lib/debug/boot");
+    debug.appendPath("vmlinux-" + m_crashrelease + ".debug");
+    Debug::debug()->dbg("Trying %s", debug.c_str());
+    if (debug.exists() &&
+        (m_crashbuildid.empty() || buildIdOf(debug) == m_crashbuildid))
+        return debug;
+
+    Debug::debug()->dbg("No matching debuginfo found");
+    return FilePath();
+}
+
+// -----------------------------------------------------------------------------
+static bool fitsTargets(const std::vector<unsigned long long> &avail,
+                        FileTransfer::Policy policy, unsigned long files,
+                        unsigned long long size)
+{
+    for (size_t i = 0; i < avail.size(); ++i)
+        if (FileTransfer::targetSize(policy, files, i, avail.size(), size) >
+            avail[i])
+            return false;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+int SaveDump::preflight(const RootDirURLVector &urlv, int dumplevel,
+                        DumpEstimator::Format format)
+{
+    Debug::debug()->trace("SaveDump::preflight(%d, %d)", dumplevel, format);
+
+    Configuration *config = Configuration::config();
+    unsigned long long reserve = 0;
+    if (config->KDUMP_FREE_DISK_SIZE.value() > 0)
+        reserve = config->KDUMP_FREE_DISK_SIZE.value() * 1024ULL * 1024ULL;
+
+    // the free space is known only for local targets
+    std::vector<unsigned long long> avail(urlv.size(), ULLONG_MAX);
+    unsigned long long minAvail = ULLONG_MAX;
+    for (size_t i = 0; i < urlv.size(); ++i) {
+        if (urlv[i].getProtocol() != URLParser::PROT_FILE)
+            continue;
+
+        FilePath path = urlv[i].getRealPath();
+        while (!path.exists() && path.size() > 1)
+            path = path.dirName();
+
+        unsigned long long freeSize = path.freeDiskSize();
+        avail[i] = freeSize > reserve ? freeSize - reserve : 0;
+        if (avail[i] < minAvail)
+            minAvail = avail[i];
+    }
+    if (minAvail == ULLONG_MAX) {
+        Debug::debug()->dbg("No local target.");
+        return dumplevel;
+    }
+
+    std::unique_ptr<DumpEstimator> sampled;
+    const DumpEstimator *estimator = m_estimator;
+    if (!estimator) {
+        try {
+            if (!m_vmcoreIndex && !Util::isElfFile(m_dump))
+                throw KError("The dump is no ELF file.");
+            sampled.reset(new DumpEstimator(vmcoreIndex(), m_pagesize));
+            sampled->sample(FileDescriptor(m_dump, O_RDONLY),
+                            DUMPESTIMATOR_SAMPLES, time(NULL));
+        } catch (const KError &error) {
+            Debug::debug()->dbg("Cannot estimate dump size: %s",
+                                error.what());
+            return dumplevel;
+        }
+        estimator = sampled.get();
+    }
+
+    // each target gets the part of the dump that the policy writes
+    // there, see saveDump()
+    FileTransfer::Policy policy =
+        FileTransfer::parsePolicy(config->KDUMP_SAVEDIR_POLICY.value());
+    unsigned long files = m_split ? m_split : 1;
+
+    unsigned long long size = estimator->estimate(dumplevel, format);
+    cout << "Estimated dump size: " << bytes_to_megabytes(size)
+         << " MiB, available: " << bytes_to_megabytes(minAvail) << " MiB"
+         << endl;
+    if (fitsTargets(avail, policy, files, size))
+        return dumplevel;
+
+    // excluding zero pages can be estimated; beyond that, use the
+    // highest dump level
+    if (!config->kdumptoolContainsFlag("FIXEDLEVEL") &&
+        dumplevel != DUMPLEVEL_MAX) {
+        int newlevel = dumplevel | DUMPLEVEL_ZERO;
+        if (newlevel == dumplevel ||
+            !fitsTargets(avail, policy, files,
+                         estimator->estimate(newlevel, format)))
+            newlevel = DUMPLEVEL_MAX;
+        cout << endl
+             << "WARNING: Raising dump level from " << dumplevel << " to "
+             << newlevel << ", because the dump may not fit on the target."
+             << endl
+             << "WARNING: The estimate is only an upper bound; add FIXEDLEVEL"
+             << " to KDUMPTOOL_FLAGS to keep the configured dump level."
+             << endl << endl;
+        return newlevel;
+    }
+
+    if (DumpEstimator::isMeasurable(dumplevel))
+        throw KError("Dump too large (estimated " +
+            StringUtil::number2string(bytes_to_megabytes(size)) +
+            " MiB). Aborting. Check KDUMP_FREE_DISK_SIZE.");
+
+    cout << "WARNING: The dump may not fit on the target." << endl;
+    return dumplevel;
+}
+
 // -----------------------------------------------------------------------------
 void SaveDump::checkAndDelete(const RootDirURLVector &urlv)
 {
@@ -655,7 +1093,8 @@ void SaveDump::checkOne(const RootDirURL &parser)
 }
 
 // -----------------------------------------------------------------------------
-void SaveDump::sendNotification(bool failure, const RootDirURLVector &urlv)
+void SaveDump::sendNotification(Notification what,
+                                const RootDirURLVector &urlv)
 {
     Debug::debug()->trace("SaveDump::sendNotification");
 
@@ -704,22 +1143,38 @@ void SaveDump::sendNotification(bool failure, const RootDirURLVector &urlv)
         }
 
         ostringstream ss;
-        email.setSubject("kdump: " + m_hostname + " crashed");
-
-        ss << "Your machine " + m_hostname + " crashed." << endl;
+        RootDirURLVector::const_iterator it;
+        switch (what) {
+        case NOTIFY_CRASH:
+            email.setSubject("kdump: " + m_hostname + " crashed");
+            ss << "Your machine " + m_hostname + " crashed." << endl;
+            if (m_crashrelease.size())
+                ss << "Kernel: " << m_crashrelease << endl;
+            ss << "Saving the dump to" << endl;
+            for (it = urlv.begin(); it != urlv.end(); ++it)
+                ss << it->getURL() << endl;
+            break;
 
-        if (failure)
-            ss << "Copying dump failed." << endl;
-        else {
+        case NOTIFY_SAVED:
+            email.setSubject("kdump: " + m_hostname + " dump saved");
+            ss << "Your machine " + m_hostname + " crashed." << endl;
 	    ss << "Dump has been copied to" << endl;
-	    RootDirURLVector::const_iterator it;
             for (it = urlv.begin(); it != urlv.end(); ++it)
                 ss << it->getURL() << endl;
-	}
+            break;
+
+        case NOTIFY_FAILED:
+            email.setSubject("kdump: " + m_hostname + " dump failed");
+            ss << "Your machine " + m_hostname + " crashed." << endl;
+            ss << "Copying dump failed." << endl;
+            break;
+        }
 
         email.setBody(ss.str());
 
-        email.send();
+        if (!m_mailQueue)
+            m_mailQueue = new MailQueue();
+        m_mailQueue->post(email);
     } catch (const KError &err) {
         Debug::debug()->info("Email failed: %s", err.what());
     }
@@ -765,7 +1220,8 @@ Transfer *SaveDump::getTransfer(const RootDirURLVector &urlv)
     switch (urlv.begin()->getProtocol()) {
         case URLParser::PROT_FILE:
             Debug::debug()->dbg("Returning FileTransfer");
-            return new FileTransfer(urlv);
+            return new FileTransfer(urlv, FileTransfer::parsePolicy(
+                Configuration::config()->KDUMP_SAVEDIR_POLICY.value()));
 
         case URLParser::PROT_FTP:
             Debug::debug()->dbg("Returning FTPTransfer");
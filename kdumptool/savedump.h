@@ -23,8 +23,11 @@
 #include "subcommand.h"
 #include "urlparser.h"
 #include "rootdirurl.h"
+#include "dumpestimator.h"
 
 class Transfer;
+class VmcoreIndex;
+class MailQueue;
 
 //{{{ SaveDump -----------------------------------------------------------------
 
@@ -32,6 +35,7 @@ class SaveDump {
     protected:
         FilePath m_dump;
         std::string m_crashrelease;
+        std::string m_crashbuildid;
         std::string m_rootdir;
         std::string m_hostname;
         bool m_nomail;
@@ -67,6 +71,17 @@ class SaveDump {
         void noMail(bool nomail)
         { m_nomail = nomail; }
 
+        /**
+         * Use a dump size estimator which has already sampled the dump
+         * instead of sampling it again. The estimator is not owned and
+         * must outlive the object.
+         *
+         * @param[in] estimator the estimator, or @c NULL to sample the
+         *            dump when it is saved
+         */
+        void estimator(const DumpEstimator *estimator)
+        { m_estimator = estimator; }
+
     protected:
         void saveDump(const RootDirURLVector &urlv);
 
@@ -74,19 +89,111 @@ class SaveDump {
 
         void generateInfo();
 
+        /**
+         * Save the timeline of the dump saving phases (including any
+         * phases recorded before the dump was saved) to timeline.txt.
+         *
+         * @exception KError if writing the file fails
+         */
+        void saveTimeline();
+
         void generateRearrange();
 
         void fillVmcoreinfo();
 
-        void copyKernel();
+        /**
+         * Returns the index of the dump headers and notes. The dump
+         * headers are read only once and shared by all users.
+         *
+         * @exception KError if the dump cannot be read
+         */
+        const VmcoreIndex &vmcoreIndex();
+
+        /**
+         * Copy the kernel, System.map and debuginfo (if installed) to
+         * the first dump target. Files which are already saved in a
+         * previous dump of the same kernel are hard-linked instead.
+         *
+         * @param[in] urlv the dump targets
+         * @exception KError if the kernel or System.map is not found
+         *            or copying fails
+         */
+        void copyKernel(const RootDirURLVector &urlv);
+
+        /**
+         * Copy one file to the first dump target.
+         *
+         * @param[in] file full path of the file
+         * @param[in] what description for progress messages
+         * @param[in] target local target directory (or empty)
+         * @param[in] previous previous dump directory with the same
+         *            kernel (or empty)
+         */
+        void copyFile(const FilePath &file, const char *what,
+                      const FilePath &target, const FilePath &previous);
+
+        /**
+         * Find a previous dump in the same save directory which contains
+         * a kernel with the build-id of the crashed kernel.
+         *
+         * @param[in] target the current dump directory
+         * @param[in] kernel full path of the kernel image to be saved
+         * @return the directory of the previous dump, or an empty path
+         */
+        FilePath findPreviousDump(const FilePath &target,
+                                  const FilePath &kernel);
 
+        /**
+         * Find the kernel image of the crashed kernel, preferring the
+         * image whose build-id matches the dump.
+         */
         std::string findKernel();
 
+        std::string findKernelByName();
+
         std::string findMapfile();
 
+        /**
+         * Find the debuginfo of the crashed kernel.
+         *
+         * @return the full path (including the root directory), or an
+         *         empty path if no debuginfo is installed
+         */
+        FilePath findDebuginfo();
+
+        /**
+         * Estimate the dump size before saving and choose what to do if
+         * it does not fit on a local target: raise the dump level, or
+         * abort without writing anything.
+         *
+         * @param[in] urlv the dump targets
+         * @param[in] dumplevel the configured dump level
+         * @param[in] format the dump format
+         * @return the dump level to use
+         * @exception KError if the dump cannot fit
+         */
+        int preflight(const RootDirURLVector &urlv, int dumplevel,
+                      DumpEstimator::Format format);
+
         void checkAndDelete(const RootDirURLVector &urlv);
 
-        void sendNotification(bool failure, const RootDirURLVector &urlv);
+        /**
+         * Kind of a notification email.
+         */
+        enum Notification {
+            NOTIFY_CRASH,       /**< crash detected, saving starts */
+            NOTIFY_SAVED,       /**< dump has been saved */
+            NOTIFY_FAILED       /**< saving the dump failed */
+        };
+
+        /**
+         * Queue a notification email. The email is sent in the background,
+         * so this never blocks on the SMTP server.
+         *
+         * @param[in] what kind of the notification
+         * @param[in] urlv the dump targets
+         */
+        void sendNotification(Notification what, const RootDirURLVector &urlv);
 
         std::string getKernelReleaseCommandline();
 
@@ -104,10 +211,15 @@ class SaveDump {
     private:
         unsigned long m_split;
         Transfer *m_transfer;
+        VmcoreIndex *m_vmcoreIndex;
+        const DumpEstimator *m_estimator;
         bool m_usedDirectSave;
         bool m_useMakedumpfile;
         unsigned long m_threads;
         unsigned long long m_crashtime;
+        size_t m_pagesize;
+        int m_dumplevel;
+        MailQueue *m_mailQueue;
 
         void checkOne(const RootDirURL &parser);
 };
@@ -24,8 +24,14 @@
 
 #include <stdint.h>
 #include <unistd.h>
+#include <signal.h>
 
 #include "global.h"
+
+#if HAVE_LIBZSTD
+#   include <zstd.h>
+#endif // HAVE_LIBZSTD
+
 #include "debug.h"
 #include "configuration.h"
 #include "fileutil.h"
@@ -34,6 +40,7 @@
 #include "socket.h"
 #include "sshtransfer.h"
 #include "routable.h"
+#include "calibrate.h"
 
 using std::string;
 using std::cerr;
@@ -42,9 +49,27 @@ using std::make_shared;
 
 //{{{ SSHTransfer -------------------------------------------------------------
 
+// Compressors for KDUMP_SSH_COMPRESS
+static const struct {
+    const char *name;
+    const char *command;
+    const char *suffix;
+} remoteCompressors[] = {
+    { "gzip", "gzip -c", ".gz" },
+    { "xz", "xz -c -T0", ".xz" },
+    { "zstd", "zstd -q -c -T0", ".zst" },
+};
+
+// -----------------------------------------------------------------------------
+// KDUMP_SSH_COMPRESS applies to the dump only (vmcore, vmcore0, ...)
+static bool isDumpFile(const string &name)
+{
+    return name.compare(0, 6, "vmcore") == 0;
+}
+
 /* -------------------------------------------------------------------------- */
 SSHTransfer::SSHTransfer(const RootDirURLVector &urlv)
-    : URLTransfer(urlv)
+    : URLTransfer(urlv), m_buffer(SSH_BLOCK_SIZE), m_cctx(nullptr)
 {
     if (urlv.size() > 1)
 	cerr << "WARNING: First dump target used; rest ignored." << endl;
@@ -53,8 +78,28 @@ SSHTransfer::SSHTransfer(const RootDirURLVector &urlv)
     Debug::debug()->trace("SSHTransfer::SSHTransfer(%s)",
 			  target.getURL().c_str());
 
-    // Check network status
     Configuration *config = Configuration::config();
+    m_sparse = config->KDUMP_SSH_SPARSE.value();
+    const string &compress = config->KDUMP_SSH_COMPRESS.value();
+    if (!compress.empty()) {
+        size_t i;
+        for (i = 0; i < sizeof(remoteCompressors) /
+                 sizeof(remoteCompressors[0]); ++i)
+            if (compress == remoteCompressors[i].name)
+                break;
+        if (i >= sizeof(remoteCompressors) / sizeof(remoteCompressors[0]))
+            throw KError("Unknown KDUMP_SSH_COMPRESS: " + compress + ".");
+        m_compress = remoteCompressors[i].command;
+        m_suffix = remoteCompressors[i].suffix;
+    }
+
+    const string &stream = config->KDUMP_SSH_STREAM.value();
+    if (stream == "zstd")
+        initStream();
+    else if (!stream.empty())
+        throw KError("Unknown KDUMP_SSH_STREAM: " + stream + ".");
+
+    // Check network status
     Routable rt(target.getHostname());
     if (!rt.check(config->KDUMP_NET_TIMEOUT.value()))
 	cerr << "WARNING: Dump target not reachable" << endl;
@@ -74,6 +119,86 @@ SSHTransfer::SSHTransfer(const RootDirURLVector &urlv)
 SSHTransfer::~SSHTransfer()
 {
     Debug::debug()->trace("SSHTransfer::~SSHTransfer()");
+
+#if HAVE_LIBZSTD
+    if (m_cctx)
+        ZSTD_freeCCtx(m_cctx);
+#endif // HAVE_LIBZSTD
+}
+
+/* -------------------------------------------------------------------------- */
+void SSHTransfer::initStream()
+{
+    Debug::debug()->trace("SSHTransfer::initStream()");
+
+#if HAVE_LIBZSTD
+    if (!m_compress.empty() && m_suffix != ".zst") {
+        cerr << "WARNING: KDUMP_SSH_STREAM=zstd ignored with "
+             << "KDUMP_SSH_COMPRESS="
+             << Configuration::config()->KDUMP_SSH_COMPRESS.value() << endl;
+        return;
+    }
+
+    m_cctx = ZSTD_createCCtx();
+    if (!m_cctx)
+        throw KError("ZSTD_createCCtx() failed.");
+    ZSTD_CCtx_setParameter(m_cctx, ZSTD_c_compressionLevel,
+                           SSH_STREAM_LEVEL);
+
+    // use the same number of CPUs as makedumpfile
+    unsigned long cpus = Configuration::config()->KDUMP_CPUS.value();
+    unsigned long online = SystemCPU().numOnline();
+    if (!cpus || cpus > online)
+        cpus = online;
+    if (cpus > 1) {
+        size_t ret = ZSTD_CCtx_setParameter(m_cctx, ZSTD_c_nbWorkers, cpus);
+        if (ZSTD_isError(ret))
+            Debug::debug()->dbg("Cannot use %lu zstd threads: %s",
+                                cpus, ZSTD_getErrorName(ret));
+    }
+    m_zbuffer.resize(SSH_BLOCK_SIZE);
+
+    // the stream is stored as-is on the remote host
+    m_compress.clear();
+#else
+    cerr << "WARNING: KDUMP_SSH_STREAM=zstd is not supported." << endl;
+#endif // HAVE_LIBZSTD
+}
+
+/* -------------------------------------------------------------------------- */
+bool SSHTransfer::writeData(int fd, const char *buf, size_t len)
+{
+    while (len) {
+        ssize_t ret = write(fd, buf, len);
+
+        if (ret < 0 && errno == EPIPE)
+            return false;
+        else if (ret < 0)
+            throw KSystemError("SSHTransfer::perform: write failed", errno);
+        len -= ret;
+        buf += ret;
+    }
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+bool SSHTransfer::writeStream(int fd, const char *buf, size_t len)
+{
+#if HAVE_LIBZSTD
+    ZSTD_inBuffer in = { buf, len, 0 };
+    ZSTD_EndDirective mode = len ? ZSTD_e_continue : ZSTD_e_end;
+    size_t remaining;
+    do {
+        ZSTD_outBuffer out = { m_zbuffer.data(), m_zbuffer.size(), 0 };
+        remaining = ZSTD_compressStream2(m_cctx, &out, &in, mode);
+        if (ZSTD_isError(remaining))
+            throw KError(string("zstd compression failed: ") +
+                         ZSTD_getErrorName(remaining));
+        if (!writeData(fd, m_zbuffer.data(), out.pos))
+            return false;
+    } while (len ? in.pos < in.size : remaining != 0);
+#endif // HAVE_LIBZSTD
+    return true;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -95,44 +220,51 @@ void SSHTransfer::perform(DataProvider *dataprovider,
     FilePath fp = target.getPath();
     fp.appendPath(target_files.front());
 
-    string remote;
-    remote.assign("dd of=").append(fp).append("-incomplete");
-    remote.append(" && mv ").append(fp).append("-incomplete ").append(fp);
+    string remote = remoteCommand(fp, isDumpFile(target_files.front()));
     Debug::debug()->dbg("Remote command: %s", remote.c_str());
 
     SubProcess p;
-    auto pipe = make_shared<ParentToChildPipe>();
+    auto pipe = make_shared<ParentToChildPipe>(SSH_BLOCK_SIZE);
     p.setChildFD(STDIN_FILENO, pipe);
     p.spawn("ssh", makeArgs(remote));
 
+    // if the remote command fails, report its exit status
+    struct sigaction sa, oldsa;
+    sa.sa_handler = SIG_IGN;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = 0;
+    sigaction(SIGPIPE, &sa, &oldsa);
+
+#if HAVE_LIBZSTD
+    if (m_cctx)
+        ZSTD_CCtx_reset(m_cctx, ZSTD_reset_session_only);
+#endif // HAVE_LIBZSTD
+
     int fd = pipe->writeEnd();
     try {
         dataprovider->prepare();
         prepared = true;
 
         while (true) {
-            size_t read_data = dataprovider->getData(m_buffer, BUFSIZ);
+            size_t read_data = dataprovider->getData(m_buffer.data(),
+                                                     m_buffer.size());
+
+            // an empty write ends the compressed stream
+            bool ok = m_cctx
+                ? writeStream(fd, m_buffer.data(), read_data)
+                : writeData(fd, m_buffer.data(), read_data);
 
             // finished?
-            if (read_data == 0)
+            if (read_data == 0 || !ok)
                 break;
-
-	    char *p = m_buffer;
-	    while (read_data) {
-		ssize_t ret = write(fd, p, read_data);
-
-		if (ret < 0)
-		    throw KSystemError("SSHTransfer::perform: write failed",
-				       errno);
-		read_data -= ret;
-		p += ret;
-	    }
         }
     } catch (...) {
+        sigaction(SIGPIPE, &oldsa, NULL);
         if (prepared)
             dataprovider->finish();
         throw;
     }
+    sigaction(SIGPIPE, &oldsa, NULL);
     pipe->close();
 
     dataprovider->finish();
@@ -142,6 +274,39 @@ void SSHTransfer::perform(DataProvider *dataprovider,
 		     " with status " + StringUtil::number2string(status));
 }
 
+/* -------------------------------------------------------------------------- */
+string SSHTransfer::remoteCommand(std::string const &path, bool compress) const
+{
+    string suffix = compress ? m_suffix : string();
+    string target = path + suffix;
+    string blocksize = StringUtil::number2string(SSH_BLOCK_SIZE);
+    string ret;
+
+    if (m_cctx && suffix.empty()) {
+        // decompress the stream
+        ret.assign("zstd -q -d -c");
+        if (m_sparse)
+            ret.append(" --sparse");
+        ret.append(" > ").append(target).append("-incomplete");
+    } else if (compress && !m_compress.empty()) {
+        // no pipe into dd, because the exit status would be lost
+        ret.assign(m_compress).append(" > ").append(target)
+            .append("-incomplete");
+    } else {
+        // with ibs and obs instead of bs, dd collects the (possibly
+        // short) reads from the pipe into full output blocks
+        ret.assign("dd of=").append(target).append("-incomplete");
+        ret.append(" ibs=").append(blocksize)
+            .append(" obs=").append(blocksize);
+        if (m_sparse)
+            ret.append(" conv=sparse");
+    }
+
+    ret.append(" && mv ").append(target).append("-incomplete ").append(target);
+    return ret;
+}
+
+/* -------------------------------------------------------------------------- */
 StringVector SSHTransfer::makeArgs(std::string const &remote)
 {
     const RootDirURL &target = getURLVector().front();
@@ -159,6 +324,18 @@ StringVector SSHTransfer::makeArgs(std::string const &remote)
 	ret.push_back(StringUtil::number2string(port));
     }
 
+    const string &cipher = Configuration::config()->KDUMP_SSH_CIPHER.value();
+    if (!cipher.empty()) {
+	ret.push_back("-c");
+	ret.push_back(cipher);
+    }
+
+    // the data is already compressed
+    if (m_cctx) {
+	ret.push_back("-o");
+	ret.push_back("Compression=no");
+    }
+
     ret.push_back(target.getHostname());
     ret.push_back(remote);
 
@@ -628,6 +805,12 @@ StringVector SFTPTransfer::makeArgs(void)
 	ret.push_back(StringUtil::number2string(port));
     }
 
+    const string &cipher = Configuration::config()->KDUMP_SSH_CIPHER.value();
+    if (!cipher.empty()) {
+	ret.push_back("-c");
+	ret.push_back(cipher);
+    }
+
     ret.push_back("-s");
 
     ret.push_back(target.getHostname());
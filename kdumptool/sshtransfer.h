@@ -20,6 +20,7 @@
 #define SSHTRANSFER_H
 
 #include <memory>
+#include <vector>
 
 #include "global.h"
 #include "stringutil.h"
@@ -27,10 +28,25 @@
 #include "process.h"
 #include "transfer.h"
 
+/* size of the blocks written into ssh and by the remote dd */
+#define SSH_BLOCK_SIZE          (1024 * 1024)
+
+/* zstd level for KDUMP_SSH_STREAM */
+#define SSH_STREAM_LEVEL        1
+
+struct ZSTD_CCtx_s;
+
 //{{{ SSHTransfer --------------------------------------------------------------
 
 /**
  * Transfers a file to SSH (upload).
+ *
+ * The data is written to a remote dd process in large blocks. Optionally,
+ * dd skips zero blocks (KDUMP_SSH_SPARSE), or the dump is compressed on the
+ * remote host before it is stored (KDUMP_SSH_COMPRESS).
+ *
+ * With KDUMP_SSH_STREAM=zstd, the data is compressed by multiple threads
+ * before it is sent, and decompressed on the remote host.
  */
 class SSHTransfer : public URLTransfer {
 
@@ -57,10 +73,44 @@ class SSHTransfer : public URLTransfer {
                      const StringVector &target_files,
                      bool *directSave);
 
+        /**
+         * Build the remote command which stores the data.
+         *
+         * @param[in] path full path of the target file on the remote host
+         * @param[in] compress @c true to apply KDUMP_SSH_COMPRESS
+         * @return shell command line
+         */
+        std::string remoteCommand(std::string const &path,
+                                  bool compress) const;
+
     private:
-        char m_buffer[BUFSIZ];
+        std::vector<char> m_buffer;
+        bool m_sparse;
+        std::string m_compress;
+        std::string m_suffix;
+        struct ZSTD_CCtx_s *m_cctx;
+        std::vector<char> m_zbuffer;
 
 	StringVector makeArgs(std::string const &remote);
+
+        void initStream();
+
+        /**
+         * Write all data to the ssh pipe.
+         *
+         * @return @c false if the remote command has exited
+         * @exception KSystemError on any other write error
+         */
+        bool writeData(int fd, const char *buf, size_t len);
+
+        /**
+         * Compress data and write it to the ssh pipe.
+         * A zero @a len ends the stream.
+         *
+         * @return @c false if the remote command has exited
+         * @exception KError if compression fails
+         */
+        bool writeStream(int fd, const char *buf, size_t len);
 };
 
 //}}}
@@ -0,0 +1,221 @@
+/*
+ * (c) 2026, SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "global.h"
+#include "bootheader.h"
+#include "fileutil.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+// Only the start of an image is interesting for the parser
+#define FUZZ_MAX_SIZE   (64 * 1024)
+
+// Magic values which lead the parser into the format-specific code
+static const struct {
+    size_t offset;
+    const char *data;
+    size_t len;
+} fuzz_magics[] = {
+    { 0x0202, "HdrS", 4 },
+    { 0x0206, "\x0f\x02", 2 },
+    { 0x0038, "ARM\x64", 4 },
+    { 0x0000, "\x7f" "ELF", 4 },
+    { 0x0000, "\x1f\x8b\x08\x00", 4 },
+};
+
+// -----------------------------------------------------------------------------
+static string describe(const BootHeader &hdr)
+{
+    std::ostringstream ss;
+    ss << BootHeader::formatName(hdr.format())
+       << " " << Decompressor::formatName(hdr.compression())
+       << " 0x" << std::hex << hdr.protocolVersion() << std::dec
+       << " " << hdr.isRelocatable()
+       << " " << (long long)hdr.payloadOffset();
+    if (hdr.payloadOffset() >= 0)
+        ss << " " << Decompressor::formatName(hdr.payloadCompression())
+           << " " << hdr.payloadLength();
+    if (hdr.imageSize())
+        ss << " size=" << hdr.imageSize();
+    if (!hdr.version().empty())
+        ss << " \"" << hdr.version() << "\"";
+    return ss.str();
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Buffer which ends right before an inaccessible page, so that any
+ * read beyond the end of the data crashes immediately.
+ */
+class GuardedBuffer {
+
+    public:
+        GuardedBuffer(size_t size)
+        {
+            long page = sysconf(_SC_PAGESIZE);
+            m_mapsize = (size + page - 1) / page * page + page;
+            m_map = static_cast<unsigned char *>(
+                mmap(NULL, m_mapsize, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+            if (m_map == MAP_FAILED)
+                throw KSystemError("mmap() failed", errno);
+            m_guard = m_map + m_mapsize - page;
+            if (mprotect(m_guard, page, PROT_NONE) != 0)
+                throw KSystemError("mprotect() failed", errno);
+        }
+
+        ~GuardedBuffer()
+        { munmap(m_map, m_mapsize); }
+
+        // returns space for @p len bytes which ends at the guard page
+        unsigned char *get(size_t len)
+        { return m_guard - len; }
+
+    private:
+        unsigned char *m_map, *m_guard;
+        size_t m_mapsize;
+};
+
+// -----------------------------------------------------------------------------
+static bool check(const BootHeader &hdr, size_t len)
+{
+    if (hdr.payloadOffset() >= 0 &&
+        (hdr.format() != BootHeader::BH_X86 ||
+         size_t(hdr.payloadOffset()) >= len))
+        return false;
+    if (hdr.version().size() > 256 ||
+        (!hdr.version().empty() && hdr.version().size() >= len))
+        return false;
+    if (hdr.compression() != Decompressor::FMT_NONE &&
+        hdr.format() != BootHeader::BH_UNKNOWN)
+        return false;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+static int fuzz(const string &file, unsigned long iterations)
+{
+    string image;
+    {
+        std::ifstream fin(file.c_str(), std::ios::binary);
+        if (!fin)
+            throw KError("Cannot open " + file);
+        std::ostringstream ss;
+        ss << fin.rdbuf();
+        image = ss.str().substr(0, FUZZ_MAX_SIZE);
+    }
+
+    GuardedBuffer buffer(image.size());
+    int errors = 0;
+    for (unsigned long i = 0; i < iterations; ++i) {
+        size_t len = image.size();
+        if (len && rand() % 4 == 0)
+            len = rand() % (len + 1);
+        unsigned char *data = buffer.get(len);
+        memcpy(data, image.data(), len);
+
+        // mutate mostly the headers, which are in the first page
+        int mutations = rand() % 8;
+        for (int j = 0; j < mutations && len; ++j) {
+            size_t pos = rand() % (len < 0x300 ? len : 0x300);
+            switch (rand() % 4) {
+                case 0:
+                    data[pos] = rand();
+                    break;
+                case 1:
+                    data[pos] ^= 1 << (rand() % 8);
+                    break;
+                case 2:
+                    data[pos] = (rand() % 2) ? 0xff : 0x00;
+                    break;
+                default: {
+                    int k = rand() % (sizeof(fuzz_magics) /
+                                      sizeof(fuzz_magics[0]));
+                    if (fuzz_magics[k].offset + fuzz_magics[k].len <= len)
+                        memcpy(data + fuzz_magics[k].offset,
+                               fuzz_magics[k].data, fuzz_magics[k].len);
+                    break;
+                }
+            }
+        }
+
+        BootHeader hdr(data, len);
+        if (!check(hdr, len)) {
+            cerr << file << ": iteration " << i << ": "
+                 << describe(hdr) << endl;
+            ++errors;
+        }
+    }
+
+    cout << file << ": " << iterations << " iterations, "
+         << errors << " errors" << endl;
+    return errors;
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    unsigned long iterations = 0;
+    int first = 1;
+
+    if (argc > 3 && strcmp(argv[1], "-f") == 0) {
+        iterations = strtoul(argv[2], NULL, 0);
+        first = 3;
+    }
+    if (first >= argc) {
+        cerr << "Usage: " << argv[0] << " [-f iterations] image..." << endl;
+        return EXIT_FAILURE;
+    }
+
+    // make failures reproducible
+    srand(1);
+
+    int errors = 0;
+    for (int i = first; i < argc; ++i) {
+        try {
+            if (iterations) {
+                errors += fuzz(argv[i], iterations);
+            } else {
+                FileDescriptor fd(argv[i], O_RDONLY);
+                BootHeader hdr(fd);
+                cout << describe(hdr) << endl;
+            }
+        } catch (const std::exception &ex) {
+            cerr << argv[i] << ": " << ex.what() << endl;
+            ++errors;
+        }
+    }
+
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
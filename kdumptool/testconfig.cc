@@ -38,8 +38,32 @@ using std::ofstream;
 // -----------------------------------------------------------------------------
 int main(int argc, char *argv[])
 {
+    // split words like the shell: testconfig -w text
+    if (argc == 3 && string(argv[1]) == "-w") {
+        try {
+            StringVector words = ShellConfigParser::splitWords(argv[2]);
+            for (StringVector::const_iterator it = words.begin();
+                 it != words.end(); ++it)
+                cout << "[" << *it << "]";
+            cout << endl;
+        } catch (const std::exception &ex) {
+            cerr << "Fatal exception: " << ex.what() << endl;
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    string cachefile;
+    if (argc == 5 && string(argv[1]) == "-c") {
+        cachefile = argv[2];
+        argc -= 2;
+        argv += 2;
+    }
+
     if (argc != 3) {
-        cerr << "Usage: " << argv[0] << " configfile name" << endl;
+        cerr << "Usage: " << argv[0] << " [-c cachefile] configfile name"
+             << endl
+             << "       " << argv[0] << " -w text" << endl;
         return EXIT_FAILURE;
     }
 
@@ -48,6 +72,8 @@ int main(int argc, char *argv[])
 
     Debug::debug()->setStderrLevel(Debug::DL_TRACE);
     try {
+        ShellConfigParser::setCacheFile(cachefile);
+
         ShellConfigParser cp(configfile);
         cp.addVariable(name, "");
         cp.parse();
@@ -56,6 +82,8 @@ int main(int argc, char *argv[])
         val = cp.getValue(name);
         cout << val << endl;
 
+        ShellConfigParser::flushCache();
+
     } catch (const std::exception &ex) {
         cerr << "Fatal exception: " << ex.what() << endl;
         return EXIT_FAILURE;
@@ -0,0 +1,75 @@
+/*
+ * (c) 2026, SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include <iostream>
+#include <cstdlib>
+#include <string>
+
+#include "global.h"
+#include "debug.h"
+#include "configuration.h"
+#include "deletedumps.h"
+#include "fileutil.h"
+#include "stringutil.h"
+#include "stringvector.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+// -----------------------------------------------------------------------------
+static void listDumps(const char *when, const FilePath &dir)
+{
+    StringVector dumps = dir.listDir(FilterKdumpDirs());
+    cout << when << ":";
+    for (StringVector::const_iterator it = dumps.begin();
+         it != dumps.end(); ++it)
+        cout << " " << *it;
+    cout << endl;
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    if (argc != 4) {
+        cerr << "Usage: " << argv[0] << " config projected directory"
+             << endl;
+        return EXIT_FAILURE;
+    }
+
+    try {
+        Configuration::config()->readFile(argv[1]);
+        unsigned long long projected = KString(argv[2]).asLongLong();
+        FilePath dir(argv[3]);
+
+        DeleteDumps deleter;
+        deleter.start(projected);
+        deleter.waitForSpace();
+        listDumps("space", dir);
+        deleter.wait();
+        listDumps("done", dir);
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
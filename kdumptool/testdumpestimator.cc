@@ -0,0 +1,64 @@
+/*
+ * (c) 2026, SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include <iostream>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "global.h"
+#include "fileutil.h"
+#include "dumpestimator.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    if (argc < 4) {
+        cerr << "Usage: " << argv[0] << " dump level format [seed]" << endl;
+        return EXIT_FAILURE;
+    }
+
+    try {
+        int dumplevel = atoi(argv[2]);
+        DumpEstimator::Format format = DumpEstimator::parseFormat(argv[3]);
+        unsigned seed = argc > 4 ? atoi(argv[4]) : 1;
+
+        VmcoreIndex index(argv[1]);
+        DumpEstimator estimator(index, 4096);
+        estimator.sample(FileDescriptor(argv[1], O_RDONLY),
+                         DUMPESTIMATOR_SAMPLES, seed);
+
+        cout << "pages=" << estimator.totalPages()
+             << " zero=" << estimator.zeroPages()
+             << " estimate=" << estimator.estimate(dumplevel, format)
+             << " measurable=" << DumpEstimator::isMeasurable(dumplevel)
+             << endl;
+    } catch (const std::exception &ex) {
+        cerr << ex.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -22,6 +22,10 @@
 #include <cstdlib>
 #include <stdexcept>
 #include <fstream>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "global.h"
 #include "kdumptool.h"
@@ -42,16 +46,19 @@ using std::stringstream;
 // -----------------------------------------------------------------------------
 int main(int argc, char *argv[])
 {
-    string testdata, output1, output2;
+    string testdata, output1, output2, output3, output4;
 
-    if (argc != 4) {
-        cerr << "Usage: " << argv[0] << " testdata output1 output2" << endl;
+    if (argc != 6) {
+        cerr << "Usage: " << argv[0]
+             << " testdata output1 output2 output3 output4" << endl;
         return EXIT_FAILURE;
     }
 
     testdata = argv[1];
     output1 = argv[2];
     output2 = argv[3];
+    output3 = argv[4];
+    output4 = argv[5];
 
     Debug::debug()->setStderrLevel(Debug::DL_TRACE);
     try {
@@ -97,6 +104,34 @@ int main(int argc, char *argv[])
         p2.execute("cat", v);
         fout.close();
 
+        Debug::debug()->info("3rd test: %s -> %s",
+            testdata.c_str(), output3.c_str());
+
+        int infd = open(testdata.c_str(), O_RDONLY);
+        if (infd < 0)
+            throw KSystemError("Cannot open " + testdata, errno);
+        int outfd = open(output3.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (outfd < 0)
+            throw KSystemError("Cannot create " + output3, errno);
+        ProcessFilter p3;
+        p3.setInputFD(STDIN_FILENO, infd);
+        p3.setOutputFD(STDOUT_FILENO, outfd);
+        p3.execute("cat", v);
+        close(infd);
+        close(outfd);
+
+        Debug::debug()->info("4th test: %s -> %s",
+            testdata.c_str(), output4.c_str());
+
+        string out;
+        ProcessFilter p4;
+        p4.setInputBuffer(STDIN_FILENO, s.data(), s.size());
+        p4.setOutputBuffer(STDOUT_FILENO, &out);
+        p4.execute("cat", v);
+        fout.open(output4.c_str());
+        fout << out;
+        fout.close();
+
     } catch (const std::exception &ex) {
         cerr << "Fatal exception: " << ex.what() << endl;
     }
@@ -0,0 +1,71 @@
+/*
+ * (c) 2026, SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include <iostream>
+#include <cstdlib>
+
+#include "global.h"
+#include "kernelinfo.h"
+#include "debug.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    if (argc < 3) {
+        cerr << "Usage: " << argv[0] << " cachefile image..." << endl;
+        return EXIT_FAILURE;
+    }
+
+    KernelInfo::setCacheFile(argv[1]);
+
+    int errors = 0;
+    for (int i = 2; i < argc; ++i) {
+        try {
+            KernelInfo info(argv[i]);
+            cout << info.getKernelType();
+            if (info.getKernelType() != KernelTool::KT_NONE) {
+                cout << " " << info.isRelocatable()
+                     << " " << info.getArch();
+                if (info.hasConfig())
+                    cout << " " << info.nrCpus()
+                         << " " << info.isPreemptRT()
+                         << " " << info.isXen()
+                         << " " << info.isConfigRelocatable();
+                if (!info.getBuildId().empty())
+                    cout << " build-id=" << info.getBuildId();
+            }
+            if (info.fromCache())
+                cout << " (cached)";
+            cout << endl;
+        } catch (const std::exception &ex) {
+            cout << "error" << endl;
+            cerr << argv[i] << ": " << ex.what() << endl;
+            ++errors;
+        }
+    }
+
+    KernelInfo::flushCache();
+
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,73 @@
+/*
+ * (c) 2026, SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <memory>
+
+#include "global.h"
+#include "debug.h"
+#include "dataprovider.h"
+#include "transfer.h"
+#include "rootdirurl.h"
+#include "stringvector.h"
+
+using std::cerr;
+using std::endl;
+using std::string;
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    // with -p, input is a program which writes the data to stdout,
+    // or to the file given as an additional argument
+    bool process = argc > 1 && string(argv[1]) == "-p";
+    if (process) {
+        ++argv;
+        --argc;
+    }
+
+    if (argc < 5) {
+        cerr << "Usage: " << argv[0]
+             << " [-p] policy input target_file directory..." << endl;
+        return EXIT_FAILURE;
+    }
+
+    try {
+        RootDirURLVector urlv;
+        for (int i = 4; i < argc; ++i)
+            urlv.push_back(RootDirURL(argv[i], ""));
+
+        FileTransfer transfer(urlv, FileTransfer::parsePolicy(argv[1]));
+        std::unique_ptr<DataProvider> provider;
+        if (process) {
+            StringVector args(1, argv[2]);
+            provider.reset(new ProcessDataProvider(args, args));
+        } else
+            provider.reset(new FileDataProvider(argv[2]));
+        transfer.perform(provider.get(), StringVector(1, argv[3]), NULL);
+    } catch (const std::exception &ex) {
+        cerr << "Fatal exception: " << ex.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,70 @@
+/*
+ * (c) 2026, SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include <iostream>
+#include <cstdlib>
+
+#include "global.h"
+#include "vmcoreindex.h"
+#include "vmcoreinfo.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        cerr << "Usage: " << argv[0] << " dump..." << endl;
+        return EXIT_FAILURE;
+    }
+
+    int errors = 0;
+    for (int i = 1; i < argc; ++i) {
+        try {
+            VmcoreIndex index(argv[i]);
+
+            cout << (index.isElf64() ? "ELF64" : "ELF32")
+                 << " phnum=" << index.phnum()
+                 << " loads=" << index.loadRanges().size()
+                 << " memsz=" << index.totalLoadSize()
+                 << " cpus=" << index.countNotes("CORE", 1)
+                 << " xen=" << index.isXen() << endl;
+
+            const std::vector<VmcoreIndex::Note> &notes = index.notes();
+            for (std::vector<VmcoreIndex::Note>::const_iterator it =
+                     notes.begin(); it != notes.end(); ++it)
+                cout << "note " << it->name << " " << it->type
+                     << " " << it->descSize << endl;
+
+            Vmcoreinfo vm;
+            vm.readFromIndex(index);
+            cout << "OSRELEASE=" << vm.getStringValue("OSRELEASE")
+                 << " xen=" << vm.isXenVmcoreinfo() << endl;
+        } catch (const std::exception &ex) {
+            cout << "error" << endl;
+            cerr << argv[i] << ": " << ex.what() << endl;
+            ++errors;
+        }
+    }
+
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
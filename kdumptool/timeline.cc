@@ -0,0 +1,117 @@
+/*
+ * (c) 2026, SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include <fstream>
+#include <iomanip>
+
+#include "timeline.h"
+#include "debug.h"
+#include "util.h"
+
+using std::string;
+using std::ifstream;
+using std::ostream;
+using std::endl;
+using std::setw;
+
+#define PROC_UPTIME "/proc/uptime"
+
+//{{{ Timeline -----------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+Timeline *Timeline::m_instance = NULL;
+
+// -----------------------------------------------------------------------------
+Timeline *Timeline::timeline()
+{
+    if (!m_instance)
+        m_instance = new Timeline();
+
+    return m_instance;
+}
+
+// -----------------------------------------------------------------------------
+Timeline::Timeline()
+    : m_start(Util::monotonicTime()), m_uptime(-1.0), m_depth(0)
+{
+    // the first field is the time since boot in seconds
+    ifstream fin(PROC_UPTIME);
+    if (!(fin >> m_uptime)) {
+        Debug::debug()->dbg("Cannot read " PROC_UPTIME);
+        m_uptime = -1.0;
+    }
+}
+
+// -----------------------------------------------------------------------------
+size_t Timeline::begin(const string &name)
+{
+    Debug::debug()->trace("Timeline::begin(%s)", name.c_str());
+
+    Phase phase;
+    phase.name = name;
+    phase.depth = m_depth++;
+    phase.start = Util::monotonicTime() - m_start;
+    phase.end = -1.0;
+    m_phases.push_back(phase);
+    return m_phases.size() - 1;
+}
+
+// -----------------------------------------------------------------------------
+void Timeline::end(size_t index)
+{
+    Phase &phase = m_phases.at(index);
+    phase.end = Util::monotonicTime() - m_start;
+    m_depth = phase.depth;
+
+    Debug::debug()->dbg("Phase %s took %.3f s",
+                        phase.name.c_str(), phase.end - phase.start);
+}
+
+// -----------------------------------------------------------------------------
+void Timeline::print(ostream &out) const
+{
+    std::ios_base::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(3);
+
+    if (m_uptime >= 0)
+        out << "Started " << m_uptime << " s after boot." << endl;
+    out << setw(10) << "Start [s]" << setw(11) << "Uptime [s]"
+        << setw(10) << "Time [s]" << "  Phase" << endl;
+
+    for (const Phase &phase : m_phases) {
+        out << setw(10) << phase.start;
+        if (m_uptime >= 0)
+            out << setw(11) << m_uptime + phase.start;
+        else
+            out << setw(11) << "-";
+        if (phase.end >= 0)
+            out << setw(10) << phase.end - phase.start;
+        else
+            out << setw(10) << "running";
+        out << "  " << string(2 * phase.depth, ' ') << phase.name << endl;
+    }
+    out << "Total: " << Util::monotonicTime() - m_start << " s." << endl;
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
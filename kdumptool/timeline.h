@@ -0,0 +1,136 @@
+/*
+ * (c) 2026, SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+//{{{ Timeline -----------------------------------------------------------------
+
+/**
+ * Records when each phase of saving a dump starts and how long it takes.
+ *
+ * Times are taken from the monotonic clock and reported relative to the
+ * creation of the timeline. The time since kernel boot is derived from
+ * /proc/uptime, so the time spent before the timeline was created (booting
+ * the kdump kernel, mounting the targets) can be seen, too.
+ *
+ * Phases can be nested. The timeline is not thread-safe; phases should
+ * be recorded by the main thread only.
+ */
+class Timeline {
+
+    public:
+        /**
+         * Returns the only timeline. It is created on first use.
+         */
+        static Timeline *timeline();
+
+        /**
+         * Start a new phase. Phases started before this one ends are
+         * nested in it.
+         *
+         * @param[in] name name of the phase
+         * @return index of the phase (to be passed to end())
+         */
+        size_t begin(const std::string &name);
+
+        /**
+         * End a phase.
+         *
+         * @param[in] index the index returned by begin()
+         */
+        void end(size_t index);
+
+        /**
+         * Returns @c true if no phase has been recorded.
+         */
+        bool empty() const
+        { return m_phases.empty(); }
+
+        /**
+         * Print the timeline as a table. Phases which have not ended yet
+         * are marked as running.
+         *
+         * @param[in] out the output stream
+         */
+        void print(std::ostream &out) const;
+
+    protected:
+        Timeline();
+
+    private:
+        struct Phase {
+            std::string name;
+            unsigned depth;
+            double start;
+            double end;
+        };
+
+        static Timeline *m_instance;
+
+        double m_start;
+        double m_uptime;
+        unsigned m_depth;
+        std::vector<Phase> m_phases;
+};
+
+//}}}
+//{{{ TimelinePhase ------------------------------------------------------------
+
+/**
+ * A timeline phase which ends when the object goes out of scope.
+ */
+class TimelinePhase {
+
+    public:
+        /**
+         * Start a phase.
+         *
+         * @param[in] name name of the phase
+         */
+        TimelinePhase(const std::string &name)
+            : m_index(Timeline::timeline()->begin(name)), m_running(true)
+        { }
+
+        ~TimelinePhase()
+        { end(); }
+
+        /**
+         * End the phase before the object goes out of scope.
+         */
+        void end()
+        {
+            if (m_running)
+                Timeline::timeline()->end(m_index);
+            m_running = false;
+        }
+
+    private:
+        size_t m_index;
+        bool m_running;
+};
+
+//}}}
+
+#endif /* TIMELINE_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
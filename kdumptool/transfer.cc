@@ -24,6 +24,13 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <cstring>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <strings.h>
 
 #include <curl/curl.h>
 
@@ -49,6 +56,12 @@ using std::endl;
 
 #define DEFAULT_MOUNTPOINT "/mnt"
 
+/* number of buffers between the reader and the writers of a mirror */
+#define MIRROR_BUFFERS          16
+
+/* smaller transfers are not reported on the console */
+#define THROUGHPUT_REPORT_MIN   (1024*1024)
+
 //{{{ Transfer -----------------------------------------------------------------
 
 // -----------------------------------------------------------------------------
@@ -72,18 +85,66 @@ URLTransfer::URLTransfer(const RootDirURLVector &urlv)
 //{{{ FileTransfer -------------------------------------------------------------
 
 // -----------------------------------------------------------------------------
-FileTransfer::FileTransfer(const RootDirURLVector &urlv)
-    : URLTransfer(urlv), m_bufferSize(0), m_buffer(NULL)
+static void writeBuffer(FILE *fp, const char *buffer, size_t length,
+                        size_t bufferSize, bool sparse, bool &last_was_sparse)
+{
+    // sparse files
+    if (sparse && length == bufferSize && Util::isZero(buffer, bufferSize)) {
+        int ret = fseek(fp, bufferSize, SEEK_CUR);
+        if (ret != 0)
+            throw KSystemError("FileTransfer::perform: fseek() failed.",
+                errno);
+        last_was_sparse = true;
+    } else {
+        size_t ret = fwrite(buffer, 1, length, fp);
+        if (ret != length)
+            throw KSystemError("FileTransfer::perform: fwrite() failed"
+                " with " + StringUtil::number2string(ret) +  ".", errno);
+        last_was_sparse = false;
+    }
+}
+
+// -----------------------------------------------------------------------------
+static void finishSparse(FILE *fp, bool last_was_sparse)
+{
+    if (!last_was_sparse)
+        return;
+
+    loff_t old_offset = ftell(fp);
+
+    // write something
+    int ret = fputc('\0', fp);
+    if (ret == EOF)
+        throw KSystemError("Unable to write.", errno);
+
+    // truncate the file
+    rewind(fp);
+    ret = ftruncate(fileno(fp), old_offset);
+    if (ret != 0)
+        throw KSystemError("Unable to set the file position.", errno);
+}
+
+// -----------------------------------------------------------------------------
+FileTransfer::FileTransfer(const RootDirURLVector &urlv, Policy policy)
+    : URLTransfer(urlv), m_bufferSize(0), m_buffer(NULL),
+      m_policy(policy), m_active(0)
 {
     RootDirURLVector::const_iterator it;
     for (it = urlv.begin(); it != urlv.end(); ++it)
 	if (it->getProtocol() != URLParser::PROT_FILE)
 	    throw KError("Only file URLs are allowed for split.");
 
-    // create directories
+    // create directories; with mirror and failover, a broken target
+    // is skipped when it is used
     for (it = urlv.begin(); it != urlv.end(); ++it) {
         FilePath dir = it->getRealPath();
-        dir.mkdir(true);
+        try {
+            dir.mkdir(true);
+        } catch (const KError &error) {
+            if (m_policy == POLICY_LEGACY || m_policy == POLICY_STRIPE)
+                throw;
+            cerr << "WARNING: " << error.what() << endl;
+        }
     }
 
     // try to get the buffer size
@@ -108,6 +169,38 @@ FileTransfer::~FileTransfer()
     delete[] m_buffer;
 }
 
+// -----------------------------------------------------------------------------
+FileTransfer::Policy FileTransfer::parsePolicy(const string &name)
+{
+    if (strcasecmp(name.c_str(), "legacy") == 0)
+        return POLICY_LEGACY;
+    else if (strcasecmp(name.c_str(), "stripe") == 0)
+        return POLICY_STRIPE;
+    else if (strcasecmp(name.c_str(), "mirror") == 0)
+        return POLICY_MIRROR;
+    else if (strcasecmp(name.c_str(), "failover") == 0)
+        return POLICY_FAILOVER;
+    else
+        throw KError("Invalid target policy: " + name + ".");
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long FileTransfer::targetSize(Policy policy,
+                                            unsigned long files,
+                                            size_t idx, size_t count,
+                                            unsigned long long size)
+{
+    // a mirror gets a full copy, and with failover any target may have
+    // to take the whole dump
+    if (count <= 1 || files == 0 ||
+        policy == POLICY_MIRROR || policy == POLICY_FAILOVER)
+        return size;
+
+    // file i is written to target i % count, see performStripe()
+    unsigned long mine = idx < files ? (files - idx + count - 1) / count : 0;
+    return (size * mine + files - 1) / files;
+}
+
 // -----------------------------------------------------------------------------
 void FileTransfer::perform(DataProvider *dataprovider,
                            const StringVector &target_files,
@@ -117,17 +210,67 @@ void FileTransfer::perform(DataProvider *dataprovider,
 	dataprovider, target_files.front().c_str(),
 	target_files.size() > 1 ? ", ..." : "");
 
+    RootDirURLVector &urlv = getURLVector();
+
+    if (m_policy == POLICY_MIRROR && urlv.size() > 1) {
+        if (target_files.size() == 1) {
+            performMirror(dataprovider, target_files);
+            if (directSave)
+                *directSave = false;
+            return;
+        }
+        cerr << "WARNING: Split files cannot be mirrored; "
+            "striping them instead." << endl;
+    }
+
+    if (m_policy != POLICY_FAILOVER) {
+        performStripe(dataprovider, target_files, 0, urlv.size(), directSave);
+        return;
+    }
+
+    while (true) {
+        try {
+            performStripe(dataprovider, target_files, m_active, 1,
+                          directSave);
+            return;
+        } catch (const KError &error) {
+            FilePath dir = urlv[m_active].getRealPath();
+            cerr << "Saving to " << dir << " failed: " << error.what()
+                 << endl;
+
+            // remove what was written so far
+            StringVector::const_iterator it;
+            for (it = target_files.begin(); it != target_files.end(); ++it) {
+                FilePath fp = dir;
+                unlink(fp.appendPath(*it).c_str());
+            }
+
+            if (m_active + 1 >= urlv.size())
+                throw;
+            ++m_active;
+            cerr << "Trying next target "
+                 << urlv[m_active].getRealPath() << "." << endl;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+void FileTransfer::performStripe(DataProvider *dataprovider,
+                                 const StringVector &target_files,
+                                 size_t first, size_t count, bool *directSave)
+{
     StringVector full_targets;
     StringVector::const_iterator it;
     RootDirURLVector &urlv = getURLVector();
-    RootDirURLVector::const_iterator itv = urlv.begin();
+    size_t i = 0;
     for (it = target_files.begin(); it != target_files.end(); ++it) {
-        FilePath fp = itv->getRealPath();
+        FilePath fp = urlv[first + i].getRealPath();
         full_targets.push_back(fp.appendPath(*it));
-	if (++itv == urlv.end())
-	    itv = urlv.begin();
+	if (++i == count)
+	    i = 0;
     }
 
+    double start = Util::monotonicTime();
     if (dataprovider->canSaveToFile()) {
 	performFile(dataprovider, full_targets);
         if (directSave)
@@ -137,6 +280,7 @@ void FileTransfer::perform(DataProvider *dataprovider,
         if (directSave)
             *directSave = false;
     }
+    reportThroughput(full_targets, Util::monotonicTime() - start);
 }
 
 // -----------------------------------------------------------------------------
@@ -181,47 +325,238 @@ void FileTransfer::performPipe(DataProvider *dataprovider,
             if (read_data == 0)
                 break;
 
-            // sparse files
-            if (sparse && read_data == m_bufferSize &&
-                    Util::isZero(m_buffer, m_bufferSize)) {
-                int ret = fseek(fp, m_bufferSize, SEEK_CUR);
-                if (ret != 0)
-                    throw KSystemError("FileTransfer::perform: fseek() failed.",
-                        errno);
-                last_was_sparse = true;
-            } else {
-                size_t ret = fwrite(m_buffer, 1, read_data, fp);
-                if (ret != read_data)
-                    throw KSystemError("FileTransfer::perform: fwrite() failed"
-                        " with " + StringUtil::number2string(ret) +  ".", errno);
-                last_was_sparse = false;
+            writeBuffer(fp, m_buffer, read_data, m_bufferSize, sparse,
+                        last_was_sparse);
+        }
+
+        finishSparse(fp, last_was_sparse);
+    } catch (...) {
+        close(fp);
+        if (prepared)
+            dataprovider->finish();
+        throw;
+    }
+
+    close(fp);
+    dataprovider->finish();
+}
+
+// -----------------------------------------------------------------------------
+namespace {
+
+/**
+ * Ring of buffers shared by the reader and the writers of a mirror.
+ * Buffer n is reused for data block n + MIRROR_BUFFERS after all
+ * writers which are still alive have written block n.
+ */
+struct MirrorRing {
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::vector<std::vector<char> > buffers;
+    std::vector<size_t> lengths;
+    unsigned long long produced;
+    bool eof;
+    bool aborted;
+
+    // per writer
+    std::vector<unsigned long long> consumed;
+    std::vector<bool> alive;
+    std::vector<string> errors;
+
+    MirrorRing(size_t bufferSize, size_t writers)
+        : buffers(MIRROR_BUFFERS, std::vector<char>(bufferSize)),
+          lengths(MIRROR_BUFFERS), produced(0), eof(false), aborted(false),
+          consumed(writers, 0), alive(writers, true), errors(writers)
+    { }
+
+    // true if at least one writer is still alive
+    bool anyAlive() const
+    {
+        return std::find(alive.begin(), alive.end(), true) != alive.end();
+    }
+
+    // true if a free buffer is available for the next block
+    bool canProduce() const
+    {
+        for (size_t i = 0; i < consumed.size(); ++i)
+            if (alive[i] && produced - consumed[i] >= MIRROR_BUFFERS)
+                return false;
+        return true;
+    }
+};
+
+}
+
+// -----------------------------------------------------------------------------
+static void mirrorWriter(MirrorRing &ring, size_t idx, FILE *fp,
+                         bool sparse)
+{
+    std::unique_lock<std::mutex> lock(ring.mutex);
+    bool last_was_sparse = false;
+    try {
+        while (true) {
+            while (!ring.aborted && !ring.eof &&
+                   ring.consumed[idx] == ring.produced)
+                ring.cond.wait(lock);
+            if (ring.aborted)
+                break;
+            if (ring.consumed[idx] == ring.produced) {
+                // end of data
+                lock.unlock();
+                finishSparse(fp, last_was_sparse);
+                lock.lock();
+                break;
             }
+
+            size_t slot = ring.consumed[idx] % MIRROR_BUFFERS;
+            lock.unlock();
+            writeBuffer(fp, ring.buffers[slot].data(), ring.lengths[slot],
+                        ring.buffers[slot].size(), sparse, last_was_sparse);
+            lock.lock();
+
+            ++ring.consumed[idx];
+            ring.cond.notify_all();
+        }
+    } catch (const std::exception &error) {
+        if (!lock.owns_lock())
+            lock.lock();
+        ring.alive[idx] = false;
+        ring.errors[idx] = error.what();
+        ring.cond.notify_all();
+    }
+}
+
+// -----------------------------------------------------------------------------
+void FileTransfer::performMirror(DataProvider *dataprovider,
+                                 const StringVector &target_files)
+{
+    Debug::debug()->trace("FileTransfer::performMirror(%p, \"%s\")",
+        dataprovider, target_files.front().c_str());
+
+    RootDirURLVector &urlv = getURLVector();
+    bool sparse = !Configuration::config()->kdumptoolContainsFlag("NOSPARSE");
+
+    StringVector full_targets;
+    std::vector<FILE *> files;
+    RootDirURLVector::const_iterator itv;
+    for (itv = urlv.begin(); itv != urlv.end(); ++itv) {
+        FilePath fp = itv->getRealPath();
+        full_targets.push_back(fp.appendPath(target_files.front()));
+        try {
+            files.push_back(open(full_targets.back()));
+        } catch (const KError &error) {
+            cerr << "WARNING: " << error.what() << endl;
+            files.push_back(NULL);
         }
+    }
 
-        if (last_was_sparse) {
+    MirrorRing ring(m_bufferSize, files.size());
+    for (size_t i = 0; i < files.size(); ++i)
+        if (!files[i])
+            ring.alive[i] = false;
 
-            loff_t old_offset = ftell(fp);
+    double start = Util::monotonicTime();
+    std::vector<std::thread> threads;
+    bool prepared = false;
+    try {
+        for (size_t i = 0; i < files.size(); ++i)
+            if (files[i])
+                threads.push_back(std::thread(mirrorWriter, std::ref(ring),
+                                              i, files[i], sparse));
 
-            // write something
-            int ret = fputc('\0', fp);
-            if (ret == EOF)
-                throw KSystemError("Unable to write.", errno);
+        dataprovider->prepare();
+        prepared = true;
 
-            // truncate the file
-            rewind(fp);
-            ret = ftruncate(fileno(fp), old_offset);
-            if (ret != 0)
-                throw KSystemError("Unable to set the file position.", errno);
+        while (true) {
+            std::unique_lock<std::mutex> lock(ring.mutex);
+            while (ring.anyAlive() && !ring.canProduce())
+                ring.cond.wait(lock);
+            if (!ring.anyAlive())
+                throw KError("Cannot write to any mirror target.");
+
+            size_t slot = ring.produced % MIRROR_BUFFERS;
+            lock.unlock();
+            size_t read_data = dataprovider->getData(
+                ring.buffers[slot].data(), ring.buffers[slot].size());
+            lock.lock();
+
+            if (read_data == 0) {
+                ring.eof = true;
+                ring.cond.notify_all();
+                break;
+            }
+            ring.lengths[slot] = read_data;
+            ++ring.produced;
+            ring.cond.notify_all();
         }
     } catch (...) {
-        close(fp);
+        {
+            std::lock_guard<std::mutex> lock(ring.mutex);
+            ring.aborted = true;
+            ring.cond.notify_all();
+        }
+        for (size_t i = 0; i < threads.size(); ++i)
+            threads[i].join();
+        for (size_t i = 0; i < files.size(); ++i)
+            if (files[i])
+                close(files[i]);
         if (prepared)
             dataprovider->finish();
         throw;
     }
 
-    close(fp);
+    for (size_t i = 0; i < threads.size(); ++i)
+        threads[i].join();
+    for (size_t i = 0; i < files.size(); ++i)
+        if (files[i])
+            close(files[i]);
     dataprovider->finish();
+
+    // report the targets which failed and keep the good copies
+    StringVector good;
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (ring.alive[i])
+            good.push_back(full_targets[i]);
+        else if (files[i]) {
+            cerr << "WARNING: Mirror " << full_targets[i] << " failed: "
+                 << ring.errors[i] << endl;
+            unlink(full_targets[i].c_str());
+        }
+    }
+    if (good.empty())
+        throw KError("Cannot write to any mirror target.");
+
+    reportThroughput(good, Util::monotonicTime() - start);
+}
+
+// -----------------------------------------------------------------------------
+void FileTransfer::reportThroughput(const StringVector &files, double seconds)
+{
+    std::map<string, unsigned long long> bytes;
+    StringVector::const_iterator it;
+    for (it = files.begin(); it != files.end(); ++it) {
+        struct stat mystat;
+        if (stat(it->c_str(), &mystat) == 0)
+            bytes[FilePath(*it).dirName()] += mystat.st_size;
+    }
+
+    std::map<string, unsigned long long>::const_iterator bit;
+    for (bit = bytes.begin(); bit != bytes.end(); ++bit) {
+        double mib = bit->second / 1048576.0;
+        double rate = seconds > 0 ? mib / seconds : 0;
+        if (bit->second < THROUGHPUT_REPORT_MIN) {
+            Debug::debug()->dbg("Saved %llu bytes to %s in %.3f s",
+                bit->second, bit->first.c_str(), seconds);
+            continue;
+        }
+
+        std::ostringstream ss;
+        ss.setf(std::ios::fixed);
+        ss.precision(2);
+        ss << "Saved " << mib << " MiB to " << bit->first << " in "
+           << seconds << " s (" << rate << " MiB/s)";
+        std::cout << ss.str() << endl;
+    }
 }
 
 // -----------------------------------------------------------------------------
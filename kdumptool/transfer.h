@@ -123,18 +123,38 @@ class URLTransfer : public Transfer {
 
 /**
  * Transfers files.
+ *
+ * With more than one target directory, a policy decides how the targets
+ * are used:
+ *
+ *  - legacy, stripe: the files are distributed round-robin over the
+ *    targets,
+ *  - mirror: every file is written to all targets concurrently,
+ *  - failover: all files are written to one target; if writing fails,
+ *    the next target is used.
  */
 class FileTransfer : public URLTransfer {
 
     public:
+        /**
+         * Policy for multiple target directories.
+         */
+        enum Policy {
+            POLICY_LEGACY,
+            POLICY_STRIPE,
+            POLICY_MIRROR,
+            POLICY_FAILOVER
+        };
 
         /**
          * Creates a new FileTransfer object.
          *
          * @param[in] urlv target directories
+         * @param[in] policy how to use multiple target directories
          * @throw KError if parsing the URL or creating the directory failed
          */
-        FileTransfer(const RootDirURLVector &urlv);
+        FileTransfer(const RootDirURLVector &urlv,
+                     Policy policy = POLICY_LEGACY);
 
         /**
          * Destroys a FileTransfer object.
@@ -150,8 +170,38 @@ class FileTransfer : public URLTransfer {
                      const StringVector &target_files,
                      bool *directSave);
 
+        /**
+         * Convert a KDUMP_SAVEDIR_POLICY value.
+         *
+         * @param[in] name "legacy", "stripe", "mirror" or "failover"
+         * @throw KError if the policy is unknown
+         */
+        static Policy parsePolicy(const std::string &name);
+
+        /**
+         * Compute how much of the data is written to one target.
+         *
+         * @param[in] policy policy for multiple targets
+         * @param[in] files  number of files, or zero if unknown
+         * @param[in] idx    index of the target
+         * @param[in] count  number of targets
+         * @param[in] size   total size of all files [bytes]
+         * @return upper bound of the bytes written to the target
+         */
+        static unsigned long long targetSize(Policy policy,
+                                             unsigned long files,
+                                             size_t idx, size_t count,
+                                             unsigned long long size);
+
     protected:
 
+        void performStripe(DataProvider *dataprovider,
+                           const StringVector &target_files,
+                           size_t first, size_t count, bool *directSave);
+
+        void performMirror(DataProvider *dataprovider,
+                           const StringVector &target_files);
+
         void performFile(DataProvider *dataprovider,
 			 const StringVector &target_files);
 
@@ -162,9 +212,20 @@ class FileTransfer : public URLTransfer {
 
         void close(FILE *fp);
 
+        /**
+         * Print the amount of data written to each target directory
+         * and the resulting throughput.
+         *
+         * @param[in] files the written files (full paths)
+         * @param[in] seconds time needed to write the files
+         */
+        void reportThroughput(const StringVector &files, double seconds);
+
     private:
         size_t m_bufferSize;
         char *m_buffer;
+        Policy m_policy;
+        size_t m_active;
 };
 
 //}}}
@@ -20,22 +20,24 @@
 #include <cstring>
 #include <cstdlib>
 #include <cerrno>
+#include <memory>
 
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/utsname.h>
 #include <sys/stat.h>
-#include <sys/mman.h>
+#include <time.h>
 
 #include <libelf.h>
 #include <gelf.h>
 
 #include "global.h"
-#include "elf.h"
 #include "util.h"
 #include "debug.h"
 #include "fileutil.h"
+#include "decompress.h"
+#include "vmcoreindex.h"
 
 using std::string;
 using std::strerror;
@@ -100,33 +102,20 @@ bool Util::isGzipFile(const string &file)
 // -----------------------------------------------------------------------------
 bool Util::isElfFile(int fd)
 {
-    int     dupfd;
-    gzFile  fp = NULL;
-    int     err;
     char    buffer[EI_MAG3+1];
-    
-    Debug::debug()->trace("isElfFile(%d)", fd);
 
-    // the dup() is because we want to keep the fd open on gzclose()
-    dupfd = dup(fd);
-    if (dupfd < 0) {
-        throw KError("gzfile dup failed");
-    }
-    lseek(dupfd, 0, SEEK_SET);
+    Debug::debug()->trace("isElfFile(%d)", fd);
 
-    fp = gzdopen(dupfd, "r");
-    if (!fp) {
-        close(dupfd);
-        throw KError("gzopen failed");
+    Decompressor::Format fmt = Decompressor::detect(fd);
+    if (!Decompressor::isSupported(fmt)) {
+        Debug::debug()->dbg("%s compression is not supported",
+                            Decompressor::formatName(fmt));
+        return false;
     }
 
-    err = gzread(fp, buffer, EI_MAG3+1);
-    if (err != (EI_MAG3+1)) {
-        gzclose(fp);
+    std::unique_ptr<Decompressor> data(Decompressor::open(fd));
+    if (data->read(buffer, EI_MAG3+1) != (EI_MAG3+1))
         throw KError("IdentifyKernel::isElfFile: Couldn't read bytes");
-    }
-
-    gzclose(fp);
 
     return buffer[EI_MAG0] == ELFMAG0 && buffer[EI_MAG1] == ELFMAG1 &&
             buffer[EI_MAG2] == ELFMAG2 && buffer[EI_MAG3] == ELFMAG3;
@@ -139,196 +128,20 @@ bool Util::isElfFile(const string &file)
 }
 
 // -----------------------------------------------------------------------------
-static off_t FindElfNoteByName(int fd, off_t offset, size_t sz,
-                               const char *name)
-{
-    char *buf, *p;
-    size_t to_read;
-    size_t nlen;
-    off_t ret = (off_t)-1;
-
-    Debug::debug()->trace("FindElfNoteByName(%d, %lu, %lu, %s)",
-                          fd, (unsigned long)offset, (unsigned long)sz, name);
-
-    if (lseek(fd, offset, SEEK_SET) == (off_t)-1)
-        throw KSystemError("Cannot seek to ELF notes", errno);
-
-    buf = new char[sz];
-    try {
-        to_read = sz;
-        p = buf;
-        while (to_read) {
-            ssize_t bytes_read = read(fd, p, to_read);
-            if (bytes_read < 0)
-                throw KSystemError("Cannot read ELF note", errno);
-            else if (!bytes_read)
-                throw KError("Unexpected EOF while reading ELF note");
-
-            to_read -= bytes_read;
-            p += bytes_read;
-        }
-
-        nlen = strlen(name);
-        to_read = sz;
-        p = buf;
-        while (to_read) {
-            Elf64_Nhdr *hdr = reinterpret_cast<Elf64_Nhdr*>(p);
-            if (to_read < sizeof(*hdr))
-                break;
-            to_read -= sizeof(*hdr);
-            p += sizeof(*hdr);
-
-            size_t notesz =
-                ((hdr->n_namesz + 3) & (-(Elf64_Word)4)) +
-                ((hdr->n_descsz + 3) & (-(Elf64_Word)4));
-            if (to_read < notesz)
-                break;
-
-            if ((hdr->n_namesz == nlen && !memcmp(p, name, nlen)) ||
-                (hdr->n_namesz == nlen+1 && !memcmp(p, name, nlen+1))) {
-                ret = offset + (p - buf) - sizeof(*hdr);
-                break;
-            }
-
-            to_read -= notesz;
-            p += notesz;
-        }
-    } catch (...) {
-        delete buf;
-        throw;
-    }
-
-    return ret;
-}
-
-// -----------------------------------------------------------------------------
-#define ELF_HEADER_MAPSIZE          (128*1024)
-
-static void *map_elf(int fd, size_t len)
-{
-    void *map;
-    map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
-    if (map == MAP_FAILED) {
-	map = mmap(NULL, len, PROT_READ | PROT_WRITE,
-		   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-	if (map == MAP_FAILED)
-	    throw KSystemError("Cannot allocate ELF headers", errno);
-
-	size_t to_read = len;
-	char *p = reinterpret_cast<char *>(map);
-	while (to_read) {
-	    ssize_t bytes_read = read(fd, p, to_read);
-	    if (bytes_read < 0)
-		throw KSystemError("ELF read error", errno);
-	    else if (!bytes_read)
-		break;
-
-	    to_read -= bytes_read;
-	    p += bytes_read;
-	}
-    }
-    return map;
-}
-
 bool Util::isXenCoreDump(int fd)
 {
-    void *map = MAP_FAILED;
-    Elf *elf = (Elf*)0;
-    bool ret = false;
-    size_t mapsize = ELF_HEADER_MAPSIZE;
-
     Debug::debug()->trace("isXenCoreDump(%d)", fd);
 
-    if (elf_version(EV_CURRENT) == EV_NONE)
-        throw KError("libelf is out of date.");
-
-    try {
-        map = map_elf(fd, mapsize);
-        elf = elf_memory(reinterpret_cast<char *>(map), mapsize);
-        if (!elf)
-            throw KELFError("elf_memory() failed", elf_errno());
-
-        if (elf_kind(elf) != ELF_K_ELF)
-            return false;
-
-        size_t endphdr;
-        Elf32_Ehdr *ehdr32;
-        Elf64_Ehdr *ehdr64;
-
-        switch (gelf_getclass(elf)) {
-        case ELFCLASS32:
-            ehdr32 = reinterpret_cast<Elf32_Ehdr*>(map);
-            endphdr = ehdr32->e_phoff + ehdr32->e_phentsize * ehdr32->e_phnum;
-            break;
-        case ELFCLASS64:
-            ehdr64 = reinterpret_cast<Elf64_Ehdr*>(map);
-            endphdr = ehdr64->e_phoff + ehdr64->e_phentsize * ehdr64->e_phnum;
-            break;
-        default:
-            throw KError("Unrecognized ELF class");
-        }
-
-        if (endphdr > mapsize) {
-            elf_end(elf);
-            munmap(map, mapsize);
+    if (!isElfFile(fd))
+        return false;
 
-            long pagesize = sysconf(_SC_PAGESIZE);
-            mapsize = (endphdr + pagesize - 1) & ~(pagesize - 1);
-            Debug::debug()->dbg("Enlarging map size to %zu bytes", mapsize);
-
-            map = map_elf(fd, mapsize);
-            elf = elf_memory(reinterpret_cast<char *>(map), mapsize);
-            if (!elf)
-                throw KELFError("elf_memory() failed", elf_errno());
-        }
-
-        size_t phnum, i;
-        if (elf_getphdrnum(elf, &phnum))
-            throw KELFError("Cannot count ELF program headers", elf_errno());
-
-        for (i = 0; i < phnum; ++i) {
-            GElf_Phdr phdr;
-
-            if (gelf_getphdr(elf, i, &phdr) != &phdr)
-                throw KELFError("getphdr() failed.", elf_errno());
-
-            if (phdr.p_type == PT_NOTE &&
-                FindElfNoteByName(fd, phdr.p_offset, phdr.p_filesz, "Xen")
-                != (off_t)-1) {
-                ret = true;
-                break;
-            }
-        }
-    } catch (...) {
-        if (elf)
-            elf_end(elf);
-        if (map != MAP_FAILED)
-            munmap(map, mapsize);
-        throw;
-    }
-
-    munmap(map, mapsize);
-    elf_end(elf);
-    return ret;
+    return VmcoreIndex(fd).isXen();
 }
 
 // -----------------------------------------------------------------------------
 bool Util::isXenCoreDump(const string &file)
 {
-    int fd = open(file.c_str(), O_RDONLY);
-    if (fd < 0) {
-        throw KSystemError("Opening of " + file + " failed.", errno);
-    }
-
-    bool ret;
-    try {
-         ret = isXenCoreDump(fd);
-    } catch (...) {
-        close(fd);
-        throw;
-    }
-
-    return ret;
+    return isXenCoreDump(FileDescriptor(file, O_RDONLY));
 }
 
 // -----------------------------------------------------------------------------
@@ -376,6 +189,22 @@ bool Util::isZero(const char *buffer, size_t size)
     return true;
 }
 
+// -----------------------------------------------------------------------------
+double Util::monotonicTime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// -----------------------------------------------------------------------------
+void Util::setNonBlocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+        throw KSystemError("Cannot make file descriptor non-blocking", errno);
+}
+
 // -----------------------------------------------------------------------------
 string Util::getHostDomain()
 {
@@ -397,20 +226,8 @@ string Util::getHostDomain()
 ssize_t Util::findBytes(const unsigned char *haystack, size_t haystack_len,
                         const unsigned char *needle, size_t needle_len)
 {
-    for (size_t i = 0; i < (haystack_len-needle_len); i++) {
-        bool found = true;
-        for (size_t j = 0; j < needle_len; j++) {
-            if (haystack[i+j] != needle[j]) {
-                found = false;
-                break;
-            }
-        }
-        if (found) {
-            return i;
-        }
-    }
-
-    return -1;
+    const void *found = memmem(haystack, haystack_len, needle, needle_len);
+    return found ? static_cast<const unsigned char *>(found) - haystack : -1;
 }
 
 // -----------------------------------------------------------------------------
@@ -120,6 +120,22 @@ class Util {
          */
         static bool isZero(const char *buffer, size_t size);
 
+        /**
+         * Returns the time of the monotonic clock in seconds. Only the
+         * difference of two such times is meaningful.
+         *
+         * @return seconds since an unspecified starting point
+         */
+        static double monotonicTime();
+
+        /**
+         * Sets the O_NONBLOCK flag of a file descriptor.
+         *
+         * @param[in] fd the file descriptor
+         * @exception KSystemError if the flags cannot be changed
+         */
+        static void setNonBlocking(int fd);
+
         /**
          * Returns the system hostname and domainname in the form
          * hostname.domainname.
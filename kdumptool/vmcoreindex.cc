@@ -0,0 +1,281 @@
+/*
+ * (c) 2026, SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include <string>
+#include <cstring>
+#include <cerrno>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <elf.h>
+
+#include "global.h"
+#include "debug.h"
+#include "fileutil.h"
+#include "stringutil.h"
+#include "vmcoreindex.h"
+
+using std::string;
+
+/* upper limit for the size of the program header table */
+#define VMCORE_PHDRS_MAX            (64*1024*1024)
+
+/* upper limit for the total size of all PT_NOTE segments */
+#define VMCORE_NOTES_MAX            (64*1024*1024)
+
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+#  define ELFDATA_NATIVE    ELFDATA2LSB
+#else
+#  define ELFDATA_NATIVE    ELFDATA2MSB
+#endif
+
+// -----------------------------------------------------------------------------
+static void read_exact(int fd, void *buf, size_t len, off_t offset,
+                       const char *what)
+{
+    char *p = reinterpret_cast<char *>(buf);
+    size_t done = 0;
+    while (done < len) {
+        ssize_t bytes_read = pread(fd, p + done, len - done, offset + done);
+        if (bytes_read < 0) {
+            if (errno == EINTR)
+                continue;
+            throw KSystemError(string("Cannot read ") + what, errno);
+        } else if (!bytes_read)
+            throw KError(string("Unexpected EOF while reading ") + what);
+        done += bytes_read;
+    }
+}
+
+// -----------------------------------------------------------------------------
+template<class Ehdr, class Shdr>
+static void read_ehdr(int fd, const unsigned char *ident,
+                      unsigned long long &phoff, size_t &phentsize,
+                      size_t &phnum)
+{
+    Ehdr ehdr;
+    memcpy(ehdr.e_ident, ident, EI_NIDENT);
+    read_exact(fd, reinterpret_cast<char *>(&ehdr) + EI_NIDENT,
+               sizeof ehdr - EI_NIDENT, EI_NIDENT, "ELF header");
+
+    phoff = ehdr.e_phoff;
+    phentsize = ehdr.e_phentsize;
+    phnum = ehdr.e_phnum;
+
+    // With extended numbering, the real count is in sh_info of the
+    // first section header
+    if (phnum == PN_XNUM) {
+        if (!ehdr.e_shoff)
+            throw KError("PN_XNUM without a section header table.");
+        Shdr shdr;
+        read_exact(fd, &shdr, sizeof shdr, ehdr.e_shoff, "section header 0");
+        phnum = shdr.sh_info;
+        Debug::debug()->dbg("Extended program header count: %zu", phnum);
+    }
+}
+
+// -----------------------------------------------------------------------------
+template<class Phdr>
+static void parse_phdrs(const char *table, size_t phentsize, size_t phnum,
+                        std::vector<VmcoreIndex::LoadRange> &loads,
+                        std::vector<std::pair<unsigned long long,
+                                              unsigned long long> > &notes)
+{
+    for (size_t i = 0; i < phnum; ++i) {
+        Phdr phdr;
+        memcpy(&phdr, table + i * phentsize, sizeof phdr);
+
+        if (phdr.p_type == PT_LOAD) {
+            VmcoreIndex::LoadRange load;
+            load.paddr = phdr.p_paddr;
+            load.vaddr = phdr.p_vaddr;
+            load.offset = phdr.p_offset;
+            load.filesz = phdr.p_filesz;
+            load.memsz = phdr.p_memsz;
+            loads.push_back(load);
+        } else if (phdr.p_type == PT_NOTE)
+            notes.push_back(std::make_pair(phdr.p_offset, phdr.p_filesz));
+    }
+}
+
+//{{{ VmcoreIndex --------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+VmcoreIndex::VmcoreIndex(const string &file)
+    : m_elf64(false), m_phnum(0)
+{
+    Debug::debug()->trace("VmcoreIndex::VmcoreIndex(%s)", file.c_str());
+
+    read(FileDescriptor(file, O_RDONLY));
+}
+
+// -----------------------------------------------------------------------------
+VmcoreIndex::VmcoreIndex(int fd)
+    : m_elf64(false), m_phnum(0)
+{
+    Debug::debug()->trace("VmcoreIndex::VmcoreIndex(%d)", fd);
+
+    read(fd);
+}
+
+// -----------------------------------------------------------------------------
+void VmcoreIndex::read(int fd)
+{
+    unsigned char ident[EI_NIDENT];
+    read_exact(fd, ident, sizeof ident, 0, "ELF header");
+
+    if (memcmp(ident, ELFMAG, SELFMAG) != 0)
+        throw KError("The dump is no ELF object.");
+    if (ident[EI_DATA] != ELFDATA_NATIVE)
+        throw KError("The byte order of the dump does not match the host.");
+
+    unsigned long long phoff;
+    size_t phentsize, minentsize;
+    switch (ident[EI_CLASS]) {
+    case ELFCLASS32:
+        read_ehdr<Elf32_Ehdr, Elf32_Shdr>(fd, ident, phoff, phentsize, m_phnum);
+        minentsize = sizeof(Elf32_Phdr);
+        break;
+    case ELFCLASS64:
+        m_elf64 = true;
+        read_ehdr<Elf64_Ehdr, Elf64_Shdr>(fd, ident, phoff, phentsize, m_phnum);
+        minentsize = sizeof(Elf64_Phdr);
+        break;
+    default:
+        throw KError("Unrecognized ELF class");
+    }
+
+    if (m_phnum && phentsize < minentsize)
+        throw KError("Invalid ELF program header size " +
+            StringUtil::number2string(phentsize) + ".");
+    if (m_phnum > VMCORE_PHDRS_MAX / minentsize ||
+        m_phnum * phentsize > VMCORE_PHDRS_MAX)
+        throw KError("ELF program header table is too large (" +
+            StringUtil::number2string(m_phnum) + " entries).");
+
+    // Read the whole program header table with one pread()
+    std::vector<char> table(m_phnum * phentsize);
+    read_exact(fd, table.data(), table.size(), phoff,
+               "ELF program headers");
+
+    std::vector<std::pair<unsigned long long, unsigned long long> >
+        noteSegments;
+    if (m_elf64)
+        parse_phdrs<Elf64_Phdr>(table.data(), phentsize, m_phnum,
+                                m_loads, noteSegments);
+    else
+        parse_phdrs<Elf32_Phdr>(table.data(), phentsize, m_phnum,
+                                m_loads, noteSegments);
+
+    Debug::debug()->dbg("%zu program headers, %zu PT_LOAD, %zu PT_NOTE",
+                        m_phnum, m_loads.size(), noteSegments.size());
+
+    // Size the note buffer once from the PT_NOTE extents
+    size_t total = 0;
+    for (size_t i = 0; i < noteSegments.size(); ++i) {
+        // notes are 4-byte aligned
+        total = (total + 3) & ~size_t(3);
+        if (noteSegments[i].second > VMCORE_NOTES_MAX - total)
+            throw KError("ELF notes are too large (" +
+                StringUtil::number2string(noteSegments[i].second) +
+                " bytes).");
+        total += noteSegments[i].second;
+    }
+    m_noteData.reserve(total);
+
+    for (size_t i = 0; i < noteSegments.size(); ++i) {
+        size_t start = (m_noteData.size() + 3) & ~size_t(3);
+        m_noteData.resize(start + noteSegments[i].second);
+        read_exact(fd, &m_noteData[start], noteSegments[i].second,
+                   noteSegments[i].first, "ELF notes");
+        parseNotes(start);
+    }
+}
+
+// -----------------------------------------------------------------------------
+void VmcoreIndex::parseNotes(size_t start)
+{
+    size_t pos = start;
+    size_t end = m_noteData.size();
+
+    // Elf32_Nhdr and Elf64_Nhdr are identical
+    while (end - pos >= sizeof(Elf64_Nhdr)) {
+        Elf64_Nhdr hdr;
+        memcpy(&hdr, &m_noteData[pos], sizeof hdr);
+        pos += sizeof hdr;
+
+        size_t namesz = (size_t(hdr.n_namesz) + 3) & ~size_t(3);
+        size_t descsz = (size_t(hdr.n_descsz) + 3) & ~size_t(3);
+        if (namesz > end - pos || descsz > end - pos - namesz) {
+            Debug::debug()->dbg("Truncated ELF note at offset %zu",
+                                pos - sizeof hdr - start);
+            break;
+        }
+
+        Note note;
+        const char *name = &m_noteData[pos];
+        note.name.assign(name, strnlen(name, hdr.n_namesz));
+        note.type = hdr.n_type;
+        note.descOffset = pos + namesz;
+        note.descSize = hdr.n_descsz;
+
+        m_noteIndex.insert(std::make_pair(note.name, m_notes.size()));
+        m_notes.push_back(note);
+
+        pos += namesz + descsz;
+    }
+}
+
+// -----------------------------------------------------------------------------
+const VmcoreIndex::Note *VmcoreIndex::findNote(const string &name) const
+{
+    // equal keys are kept in insertion order, so the lower bound is
+    // the first note in file order; find() may return any of them
+    std::multimap<string, size_t>::const_iterator it =
+        m_noteIndex.lower_bound(name);
+    return it != m_noteIndex.end() && it->first == name
+        ? &m_notes[it->second] : NULL;
+}
+
+// -----------------------------------------------------------------------------
+size_t VmcoreIndex::countNotes(const string &name, unsigned long type) const
+{
+    size_t ret = 0;
+    std::pair<std::multimap<string, size_t>::const_iterator,
+              std::multimap<string, size_t>::const_iterator> range =
+        m_noteIndex.equal_range(name);
+    for (std::multimap<string, size_t>::const_iterator it = range.first;
+         it != range.second; ++it)
+        if (m_notes[it->second].type == type)
+            ++ret;
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+unsigned long long VmcoreIndex::totalLoadSize() const
+{
+    unsigned long long ret = 0;
+    for (std::vector<LoadRange>::const_iterator it = m_loads.begin();
+         it != m_loads.end(); ++it)
+        ret += it->memsz;
+    return ret;
+}
+
+//}}}
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
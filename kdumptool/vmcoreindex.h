@@ -0,0 +1,166 @@
+/*
+ * (c) 2026, SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#ifndef VMCOREINDEX_H
+#define VMCOREINDEX_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "global.h"
+
+//{{{ VmcoreIndex --------------------------------------------------------------
+
+/**
+ * Index of the ELF headers and notes of a crash dump (e.g. /proc/vmcore).
+ *
+ * The program headers and all PT_NOTE segments are read once when the
+ * object is created. Afterwards, all information is available without
+ * accessing the dump file again, so a single index can be shared by all
+ * code which inspects the dump.
+ */
+class VmcoreIndex {
+
+    public:
+        /**
+         * A PT_LOAD segment.
+         */
+        struct LoadRange {
+            unsigned long long paddr;
+            unsigned long long vaddr;
+            unsigned long long offset;
+            unsigned long long filesz;
+            unsigned long long memsz;
+        };
+
+        /**
+         * An ELF note. The descriptor data is kept in the index.
+         */
+        struct Note {
+            std::string name;
+            unsigned long type;
+            size_t descOffset;
+            size_t descSize;
+        };
+
+        /**
+         * Read the headers of a dump file.
+         *
+         * @param[in] file path to the dump file
+         * @exception KError if the file is not an ELF file or cannot be read
+         */
+        VmcoreIndex(const std::string &file);
+
+        /**
+         * Read the headers of a dump file.
+         *
+         * @param[in] fd file descriptor of the dump file
+         * @exception KError if the file is not an ELF file or cannot be read
+         */
+        VmcoreIndex(int fd);
+
+        /**
+         * Checks whether the dump is a 64-bit ELF file.
+         */
+        bool isElf64() const
+        { return m_elf64; }
+
+        /**
+         * Returns the number of program headers.
+         */
+        size_t phnum() const
+        { return m_phnum; }
+
+        /**
+         * Returns the PT_LOAD segments in file order.
+         */
+        const std::vector<LoadRange> &loadRanges() const
+        { return m_loads; }
+
+        /**
+         * Returns all notes in file order.
+         */
+        const std::vector<Note> &notes() const
+        { return m_notes; }
+
+        /**
+         * Find the first note with a given name.
+         *
+         * @param[in] name the note name, e.g. "VMCOREINFO"
+         * @return the note, or @c NULL if there is no such note
+         */
+        const Note *findNote(const std::string &name) const;
+
+        /**
+         * Count the notes with a given name and type, e.g. the
+         * NT_PRSTATUS notes of the "CORE" owner (one per CPU).
+         *
+         * @param[in] name the note name
+         * @param[in] type the note type
+         */
+        size_t countNotes(const std::string &name, unsigned long type) const;
+
+        /**
+         * Returns the descriptor data of a note.
+         *
+         * @param[in] note a note of this index
+         */
+        const char *noteDesc(const Note &note) const
+        { return m_noteData.data() + note.descOffset; }
+
+        /**
+         * Checks whether this is a dump of the Xen hypervisor.
+         */
+        bool isXen() const
+        { return findNote("Xen") != NULL; }
+
+        /**
+         * Returns the sum of the memory sizes of all PT_LOAD segments.
+         */
+        unsigned long long totalLoadSize() const;
+
+    protected:
+        /**
+         * Read the program headers and notes.
+         *
+         * @param[in] fd file descriptor of the dump file
+         */
+        void read(int fd);
+
+        /**
+         * Split the data of a PT_NOTE segment into notes.
+         *
+         * @param[in] start offset of the segment in m_noteData
+         */
+        void parseNotes(size_t start);
+
+    private:
+        bool m_elf64;
+        size_t m_phnum;
+        std::vector<LoadRange> m_loads;
+        std::vector<Note> m_notes;
+        std::multimap<std::string, size_t> m_noteIndex;
+        std::string m_noteData;
+};
+
+//}}}
+
+#endif /* VMCOREINDEX_H */
+
+// vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -25,6 +25,8 @@
 #include "global.h"
 #include "stringutil.h"
 
+class VmcoreIndex;
+
 //{{{ Vmcoreinfo ---------------------------------------------------------------
 
 /**
@@ -36,8 +38,6 @@ class Vmcoreinfo {
 
         /**
          * Creates a new Vmcoreinfo object.
-         *
-         * @exception KError if the libelf library is out of date
          */
         Vmcoreinfo();
 
@@ -55,6 +55,14 @@ class Vmcoreinfo {
          */
         void readFromELF(const char *elf_file);
 
+        /**
+         * Reads the vmcoreinfo from the notes of an already indexed dump.
+         *
+         * @param[in] index the index of the dump
+         * @exception KError if the dump has no VMCOREINFO note
+         */
+        void readFromIndex(const VmcoreIndex &index);
+
         /**
          * Gets all keys.
          *
@@ -97,12 +105,6 @@ class Vmcoreinfo {
          */
         bool isXenVmcoreinfo() const;
 
-    protected:
-        ByteVector readElfNote(const char *file);
-
-        ByteVector readVmcoreinfoFromNotes(const char *buffer, size_t size,
-                                           bool isElf64);
-
     private:
         StringStringMap m_map;
         bool m_xenVmcoreinfo;
@@ -0,0 +1,86 @@
+#!/bin/bash
+#
+# (c) 2026, SUSE LLC
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+# 02110-1301, USA.
+#
+
+#
+# Program                                                                    {{{
+#
+
+TESTBOOTHEADER=$1
+DIR=$2
+
+if [ -z "$TESTBOOTHEADER" ] || [ -z "$DIR" ] ; then
+    echo "Usage: $0 testbootheader directory"
+    exit 1
+fi
+
+. "$(dirname "$0")/testutil.sh"
+
+errornumber=0
+TMPDIR=$(mktemp -d)
+trap 'rm -rf "$TMPDIR"' EXIT
+
+# TEST #1: Headers of the sample kernel images
+RESULT=$( cd "$DIR" && "$TESTBOOTHEADER" kernel-ELF-aarch64 \
+    kernel-ELFgz-x86_64 kernel-bzImage-x86_64 test.txt empty.conf 2>&1 )
+check "samples" "ELF none 0x0 0 -1
+unknown gzip 0x0 0 -1
+bzImage none 0x207 1 -1
+unknown none 0x0 0 -1
+unknown none 0x0 0 -1" "$RESULT"
+
+# TEST #2: bzImage with version string and payload location
+BZIMAGE="$TMPDIR/bzImage"
+truncate -s 1024 "$BZIMAGE"
+put "$BZIMAGE" $(( 0x1f1 )) "\001"			# setup_sects
+put "$BZIMAGE" $(( 0x202 )) "HdrS\017\002"		# boot protocol 2.15
+put "$BZIMAGE" $(( 0x20e )) "\000\001"			# kernel_version
+put "$BZIMAGE" $(( 0x234 )) "\001"			# relocatable_kernel
+put "$BZIMAGE" $(( 0x24c )) "\040\000\000\000"		# payload_length
+put "$BZIMAGE" $(( 0x300 )) "6.4.0-test (geeko@buildhost) #1\000"
+head -c 32 "$DIR/kernel-ELFgz-x86_64" >> "$BZIMAGE"
+RESULT=$( "$TESTBOOTHEADER" "$BZIMAGE" 2>&1 )
+check "bzImage" \
+    'bzImage none 0x20f 1 1024 gzip 32 "6.4.0-test (geeko@buildhost) #1"' \
+    "$RESULT"
+
+# TEST #3: The same bzImage truncated inside the version string
+head -c $(( 0x305 )) "$BZIMAGE" > "$TMPDIR/truncated"
+RESULT=$( "$TESTBOOTHEADER" "$TMPDIR/truncated" 2>&1 )
+check "truncated" 'bzImage none 0x20f 1 -1 "6.4.0"' "$RESULT"
+
+# TEST #4: arm64 Image header
+IMAGE="$TMPDIR/Image"
+truncate -s 64 "$IMAGE"
+put "$IMAGE" 16 "\000\000\100\001"			# image_size
+put "$IMAGE" 56 "ARM\144"				# magic
+RESULT=$( "$TESTBOOTHEADER" "$IMAGE" 2>&1 )
+check "arm64" "arm64 Image none 0x0 1 -1 size=20971520" "$RESULT"
+
+# TEST #5: Mutated and truncated headers must neither crash the parser
+# nor produce values outside the file
+RESULT=$( "$TESTBOOTHEADER" -f 20000 "$DIR"/kernel-* "$BZIMAGE" "$IMAGE" \
+    2>&1 >/dev/null ) || RESULT="$RESULT (exit status $?)"
+check "fuzz" "" "$RESULT"
+
+exit $errornumber
+
+# }}}
+
+# vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
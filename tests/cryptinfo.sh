@@ -0,0 +1,97 @@
+#!/bin/bash
+#
+# (c) 2026, SUSE LLC
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+# 02110-1301, USA.
+#
+
+# Create a fake LUKS header
+#                                                                            {{{
+function mkluks()
+{
+    local file="$1"
+    local version="$2"
+    local uuid="$3"
+    local json="$4"
+
+    rm -f "$file"
+    truncate -s 16384 "$file"
+    put "$file" 0 "LUKS\\272\\276\\000\\$version"
+    put "$file" 168 "$uuid"
+    if [ "$version" = 2 ] ; then
+	# hdr_size: 16 KiB
+	put "$file" 8 "\\000\\000\\000\\000\\000\\000\\100\\000"
+	put "$file" 448 "$uuid"
+	put "$file" 4096 "$json"
+    fi
+}
+# }}}
+
+#
+# Program                                                                    {{{
+#
+
+TESTCRYPTINFO=$1
+
+if [ -z "$TESTCRYPTINFO" ] ; then
+    echo "Usage: $0 testcryptinfo"
+    exit 1
+fi
+
+. "$(dirname "$0")/testutil.sh"
+
+errornumber=0
+TMPDIR=$(mktemp -d)
+trap 'rm -rf "$TMPDIR"' EXIT
+
+JSON_ARGON='{"keyslots":{"0":{"type":"luks2","kdf":{"type":"argon2id",
+"time":4,"memory":1048576,"cpus":4}},"1":{"type":"luks2","kdf":{"type":
+"argon2i","time":4, "memory" : 524288,"cpus":4}}},"tokens":{"0":{"type":
+"x-memory","note":"\\"memory\\":9999999"}},"config":{"json_size":"12288"}}'
+JSON_PBKDF2='{"keyslots":{"0":{"type":"luks2","kdf":{"type":"pbkdf2",
+"hash":"sha256","iterations":1000}}},"config":{}}'
+
+# TEST #1: LUKS2 with Argon2 keyslots
+mkluks "$TMPDIR/argon" 2 "11111111-1111-1111-1111-111111111111" "$JSON_ARGON"
+RESULT=$( "$TESTCRYPTINFO" "$TMPDIR/argon" 2>/dev/null )
+check "argon2" "1048576" "$RESULT"
+
+# TEST #2: LUKS2 with PBKDF2 keyslots
+mkluks "$TMPDIR/pbkdf2" 2 "22222222-2222-2222-2222-222222222222" "$JSON_PBKDF2"
+RESULT=$( "$TESTCRYPTINFO" "$TMPDIR/pbkdf2" 2>/dev/null )
+check "pbkdf2" "0" "$RESULT"
+
+# TEST #3: LUKS1 never needs extra memory
+mkluks "$TMPDIR/luks1" 1 "33333333-3333-3333-3333-333333333333"
+RESULT=$( "$TESTCRYPTINFO" "$TMPDIR/luks1" 2>/dev/null )
+check "luks1" "0" "$RESULT"
+
+# TEST #4: Not a LUKS device
+truncate -s 16384 "$TMPDIR/plain"
+RESULT=$( "$TESTCRYPTINFO" "$TMPDIR/plain" 2>/dev/null )
+check "plain" "error" "$RESULT"
+
+# TEST #5: The same header is parsed only once
+cp "$TMPDIR/argon" "$TMPDIR/argon-copy"
+RESULT=$( "$TESTCRYPTINFO" "$TMPDIR/argon" "$TMPDIR/argon-copy" 2>&1 |
+	  grep -c "(cached)" )
+check "cache" "1" "$RESULT"
+
+exit $errornumber
+
+# }}}
+
+# vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
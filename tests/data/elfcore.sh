@@ -0,0 +1,110 @@
+#
+# (c) 2026, SUSE LLC
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+# 02110-1301, USA.
+#
+# Helper functions to create ELF core files for tests.
+#
+
+# Print little-endian integers
+#                                                                            {{{
+function le()
+{
+    local bytes="$1"
+    local value="$2"
+    local i
+    for (( i = 0; i < bytes; i++ )) ; do
+	printf "\\$(printf %03o $(( (value >> (8 * i)) & 255 )))"
+    done
+}
+# }}}
+
+# Print an ELF note
+#                                                                            {{{
+function note()
+{
+    local name="$1"
+    local type="$2"
+    local desc="$3"
+    local namesz=$(( ${#name} + 1 ))
+    le 4 $namesz
+    le 4 ${#desc}
+    le 4 $type
+    printf "%s\0" "$name"
+    head -c $(( (4 - namesz % 4) % 4 )) /dev/zero
+    printf "%s" "$desc"
+    head -c $(( (4 - ${#desc} % 4) % 4 )) /dev/zero
+}
+# }}}
+
+# Create an ELF64 core file with the given notes and 1 MiB PT_LOAD
+# segments; optionally use extended numbering (PN_XNUM), leave a gap of
+# the given size before the program header table, and append the
+# contents of the segments from a file
+#                                                                            {{{
+function mkcore()
+{
+    local file="$1"
+    local notes="$2"
+    local loads="$3"
+    local xnum="$4"
+    local gap="${5:-0}"
+    local data="$6"
+    local phnum=$(( loads + 1 ))
+    local shoff=0 shnum=0
+    local phoff=$(( 64 + gap ))
+    if [ -n "$xnum" ] ; then
+	shoff=64
+	shnum=1
+	phoff=$(( phoff + 64 ))
+    fi
+    local notesoff=$(( phoff + 56 * phnum ))
+    local notessz=$(stat -c %s "$notes")
+    local i
+    {
+	# ELF header
+	printf '\x7fELF\x02\x01\x01\0\0\0\0\0\0\0\0\0'
+	le 2 4 ; le 2 62 ; le 4 1		# ET_CORE, EM_X86_64
+	le 8 0 ; le 8 $phoff ; le 8 $shoff	# e_entry, e_phoff, e_shoff
+	le 4 0 ; le 2 64 ; le 2 56		# e_flags, e_ehsize, e_phentsize
+	if [ -n "$xnum" ] ; then
+	    le 2 65535 ; le 2 64 ; le 2 $shnum ; le 2 0
+	    # section header 0 holds the real count in sh_info
+	    le 4 0 ; le 4 0 ; le 8 0 ; le 8 0 ; le 8 0 ; le 8 0
+	    le 4 0 ; le 4 $phnum ; le 8 0 ; le 8 0
+	else
+	    le 2 $phnum ; le 2 0 ; le 2 0 ; le 2 0
+	fi
+	head -c $gap /dev/zero
+	# PT_NOTE
+	le 4 4 ; le 4 0
+	le 8 $notesoff ; le 8 0 ; le 8 0
+	le 8 $notessz ; le 8 0 ; le 8 0
+	# PT_LOAD segments of 1 MiB each
+	for (( i = 0; i < loads; i++ )) ; do
+	    le 4 1 ; le 4 7
+	    le 8 $(( notesoff + notessz + i * 1048576 ))
+	    le 8 $(( 0xffff880000000000 + i * 1048576 ))
+	    le 8 $(( i * 1048576 ))
+	    le 8 1048576 ; le 8 1048576 ; le 8 0
+	done
+	cat "$notes"
+	test -z "$data" || cat "$data"
+    } > "$file"
+}
+# }}}
+
+# vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -39,9 +39,10 @@ function check_output()
 
 KDUMPTOOL=$1
 DIR=$2
+TESTDELETEDUMPS=$3
 
-if [ -z "$KDUMPTOOL" ] || [ -z "$DIR" ] ; then
-    echo "Usage: $0 kdumptool dir"
+if [ -z "$KDUMPTOOL" ] || [ -z "$DIR" ] || [ -z "$TESTDELETEDUMPS" ] ; then
+    echo "Usage: $0 kdumptool dir testdeletedumps"
     exit 1
 fi
 
@@ -63,7 +64,7 @@ KDUMP_SAVEDIR="file:///$DIR/tmp-delete_dumps"
 KDUMP_KEEP_OLD_DUMPS=0
 EOF
 
-"$KDUMPTOOL" -F "$CONF" delete_dumps || exit 1
+"$KDUMPTOOL" -F "$CONF" -C "" delete_dumps || exit 1
 for f in "${TESTKDUMP[@]}" "${TESTDIRS[@]}" "${TESTFILES[@]}"; do
     if ! test -e "$DIR/tmp-delete_dumps/$f"; then
 	echo "$f incorrectly deleted!" >&2
@@ -78,7 +79,7 @@ KDUMP_SAVEDIR="file:///$DIR/tmp-delete_dumps"
 KDUMP_KEEP_OLD_DUMPS=$nkeep
 EOF
 
-"$KDUMPTOOL" -F "$CONF" delete_dumps || exit 1
+"$KDUMPTOOL" -F "$CONF" -C "" delete_dumps || exit 1
 
 for f in "${TESTKDUMP[@]}" "${TESTDIRS[@]}" "${TESTFILES[@]}"; do
     if ! test -e "$DIR/tmp-delete_dumps/$f"; then
@@ -95,7 +96,7 @@ KDUMP_SAVEDIR="file:///$DIR/tmp-delete_dumps"
 KDUMP_KEEP_OLD_DUMPS=$nkeep
 EOF
 
-"$KDUMPTOOL" -F "$CONF" delete_dumps || exit 1
+"$KDUMPTOOL" -F "$CONF" -C "" delete_dumps || exit 1
 
 save_ifs=IFS
 IFS=$'\n'
@@ -125,7 +126,7 @@ KDUMP_SAVEDIR="file:///$DIR/tmp-delete_dumps"
 KDUMP_KEEP_OLD_DUMPS=1
 EOF
 
-"$KDUMPTOOL" -F "$CONF" delete_dumps || exit 1
+"$KDUMPTOOL" -F "$CONF" -C "" delete_dumps || exit 1
 
 save_ifs=IFS
 IFS=$'\n'
@@ -149,13 +150,23 @@ done
 
 echo "Delete all dumps"
 
+# dumps may contain subdirectories and symbolic links, but the
+# deletion must not follow the links
+for f in "${TESTKDUMP[@]}"; do
+    test -d "$DIR/tmp-delete_dumps/$f" || continue
+    mkdir -p "$DIR/tmp-delete_dumps/$f/sub/dir"
+    touch "$DIR/tmp-delete_dumps/$f/sub/dir/file"
+    ln -s ../../unrelated "$DIR/tmp-delete_dumps/$f/sub/link"
+done
+echo "keep me" > "$DIR/tmp-delete_dumps/unrelated/keep"
+
 nkeep=1
 cat <<EOF >"$CONF"
 KDUMP_SAVEDIR="file:///$DIR/tmp-delete_dumps"
 KDUMP_KEEP_OLD_DUMPS=-1
 EOF
 
-"$KDUMPTOOL" -F "$CONF" delete_dumps || exit 1
+"$KDUMPTOOL" -F "$CONF" -C "" delete_dumps || exit 1
 
 for f in "${TESTDIRS[@]}" "${TESTFILES[@]}"; do
     if ! test -e "$DIR/tmp-delete_dumps/$f"; then
@@ -171,6 +182,45 @@ for f in "${TESTKDUMP[@]}"; do
     fi
 done
 
+if [ "$(cat "$DIR/tmp-delete_dumps/unrelated/keep" 2>&1)" != "keep me" ]
+then
+    echo "Symbolic link target incorrectly deleted!" >&2
+    errors=$(( $errors+1 ))
+fi
+
+echo "Make room for a new dump"
+
+# if the new dump does not fit, the oldest dumps must be gone when
+# waitForSpace() returns; the number of kept dumps is still honoured
+setup_testdir "$DIR/tmp-delete_dumps" || exit 1
+cat <<EOF >"$CONF"
+KDUMP_SAVEDIR="file:///$DIR/tmp-delete_dumps"
+KDUMP_KEEP_OLD_DUMPS=2
+KDUMP_FREE_DISK_SIZE=0
+EOF
+
+KEPTDUMP=$( echo "$SORTDUMPS" | tail -n 2 | tr '\n' ' ' )
+OUTPUT=$( "$TESTDELETEDUMPS" "$CONF" 4611686018427387904 \
+    "$DIR/tmp-delete_dumps" 2>/dev/null )
+EXPECT="space: ${KEPTDUMP% }
+done: ${KEPTDUMP% }"
+check_output
+
+echo "Delete old dumps while saving"
+
+# with enough space, the old dumps are deleted in the background
+setup_testdir "$DIR/tmp-delete_dumps" || exit 1
+cat <<EOF >"$CONF"
+KDUMP_SAVEDIR="file:///$DIR/tmp-delete_dumps"
+KDUMP_KEEP_OLD_DUMPS=2
+KDUMP_FREE_DISK_SIZE=0
+EOF
+
+OUTPUT=$( "$TESTDELETEDUMPS" "$CONF" 0 "$DIR/tmp-delete_dumps" \
+    2>/dev/null | grep "^done:" )
+EXPECT="done: ${KEPTDUMP% }"
+check_output
+
 exit $errors
 
 # }}}
@@ -0,0 +1,112 @@
+#!/bin/bash
+#
+# (c) 2026, SUSE LLC
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+# 02110-1301, USA.
+#
+
+# Get a value from the output of testdumpestimator
+#                                                                            {{{
+function value()
+{
+    local name="$1"
+    shift
+    "$TESTDUMPESTIMATOR" "$@" | sed -n "s/.*\\<$name=\\([0-9]*\\).*/\\1/p"
+}
+# }}}
+
+# Check that a value is within a range
+#                                                                            {{{
+function check_range()
+{
+    local name="$1"
+    local min="$2"
+    local max="$3"
+    local result="$4"
+    if [ -z "$result" ] || [ "$result" -lt "$min" ] || [ "$result" -gt "$max" ]
+    then
+	echo "failed test: $name"
+	echo "Expected: $min..$max"
+	echo "Result: $result"
+	errornumber=$(( errornumber + 1 ))
+    fi
+}
+# }}}
+
+#
+# Program                                                                    {{{
+#
+
+TESTDUMPESTIMATOR=$1
+
+if [ -z "$TESTDUMPESTIMATOR" ] ; then
+    echo "Usage: $0 testdumpestimator"
+    exit 1
+fi
+
+. "$(dirname "$0")/data/elfcore.sh"
+
+errornumber=0
+TMPDIR=$(mktemp -d)
+trap 'rm -rf "$TMPDIR"' EXIT
+
+# One segment of zeroes and one segment of compressible text
+note VMCOREINFO 0 "PAGESIZE=4096
+" > "$TMPDIR/notes"
+{
+    head -c 1048576 /dev/zero
+    yes "kdump dump size estimator test" | head -c 1048576
+} > "$TMPDIR/data"
+mkcore "$TMPDIR/vmcore" "$TMPDIR/notes" 2 "" 0 "$TMPDIR/data"
+
+# 512 pages, half of them zero
+check_range "pages" 512 512 $(value pages "$TMPDIR/vmcore" 0 ELF)
+check_range "zero" 192 320 $(value zero "$TMPDIR/vmcore" 0 ELF)
+
+# ELF without filtering is a copy of the file
+check_range "ELF level 0" 2101416 2101416 \
+    $(value estimate "$TMPDIR/vmcore" 0 ELF)
+
+# ELF without zero pages
+ELF1=$(value estimate "$TMPDIR/vmcore" 1 ELF)
+check_range "ELF level 1" $(( 4264 + 192 * 4096 )) $(( 4264 + 320 * 4096 )) \
+    "$ELF1"
+
+# Compression makes text pages much smaller
+ZLIB1=$(value estimate "$TMPDIR/vmcore" 1 compressed)
+check_range "compressed level 1" 1 $(( ELF1 / 4 )) "$ZLIB1"
+for fmt in lzo snappy zstd ; do
+    check_range "$fmt level 1" 1 $(( ELF1 / 2 )) \
+	$(value estimate "$TMPDIR/vmcore" 1 $fmt)
+done
+
+# Zero pages cost a page descriptor each if not excluded
+ZLIB0=$(value estimate "$TMPDIR/vmcore" 0 compressed)
+check_range "compressed level 0" $(( ZLIB1 + 192 * 24 )) \
+    $(( ZLIB1 + 320 * 24 + 4096 )) "$ZLIB0"
+
+# No dump at all
+check_range "none" 0 0 $(value estimate "$TMPDIR/vmcore" 31 none)
+
+# Only zero page exclusion can be measured
+check_range "measurable 1" 1 1 $(value measurable "$TMPDIR/vmcore" 1 ELF)
+check_range "measurable 31" 0 0 $(value measurable "$TMPDIR/vmcore" 31 ELF)
+
+exit $errornumber
+
+# }}}
+
+# vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -53,13 +53,16 @@ TYPE=(         "x86"
 
 KDUMPTOOL=$1
 DIR=$2
-KDUMPOPT="-F $2/empty.conf"
 
 if [ -z "$DIR" ] || [ -z "$KDUMPTOOL" ] ; then
     echo "Usage: $0 kdumptool directory"
     exit 1
 fi
 
+CACHEDIR=$(mktemp -d)
+trap 'rm -rf "$CACHEDIR"' EXIT
+KDUMPOPT="-F $DIR/empty.conf -C $CACHEDIR"
+
 case `uname -m` in
     i?86|x86_64)
 	x86=yes
@@ -0,0 +1,145 @@
+#!/bin/bash
+#
+# (c) 2026, SUSE LLC
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+# 02110-1301, USA.
+#
+
+# Create a fake ELF kernel image with an embedded configuration
+#                                                                            {{{
+function mkimage()
+{
+    local file="$1"
+    local padding="$2"
+    local config="$3"
+    local truncate="$4"
+
+    cp "$DIR/kernel-ELF-x86_64" "$file"
+    head -c "$padding" /dev/zero >> "$file"
+    printf "IKCFG_ST" >> "$file"
+    if [ -n "$truncate" ] ; then
+	gzip -9 -n -c "$config" | head -c "$truncate" >> "$file"
+    else
+	gzip -9 -n -c "$config" >> "$file"
+    fi
+    printf "IKCFG_ED" >> "$file"
+    head -c 65536 /dev/zero >> "$file"
+}
+# }}}
+
+#
+# Program                                                                    {{{
+#
+
+KDUMPTOOL=$1
+DIR=$2
+
+if [ -z "$KDUMPTOOL" ] || [ -z "$DIR" ] ; then
+    echo "Usage: $0 kdumptool directory"
+    exit 1
+fi
+
+. "$(dirname "$0")/testutil.sh"
+
+errornumber=0
+TMPDIR=$(mktemp -d)
+trap 'rm -rf "$TMPDIR"' EXIT
+
+# A highly compressible configuration (much more than 1:20)
+CONFIG="$TMPDIR/config"
+{
+    echo "CONFIG_LOCALVERSION=\"-test\""
+    for i in $(seq 1 5000) ; do
+	echo "# CONFIG_UNUSED_$(( i % 3 )) is not set"
+    done
+    echo "CONFIG_NR_CPUS=64"
+    echo "CONFIG_NR_CPUS=128"
+} > "$CONFIG"
+
+# TEST #1: ELF image
+mkimage "$TMPDIR/elf" 100000 "$CONFIG"
+"$KDUMPTOOL" read_ikconfig "$TMPDIR/elf" > "$TMPDIR/out" 2>/dev/null
+RESULT=$( cmp "$CONFIG" "$TMPDIR/out" 2>&1 )
+check "elf" "" "$RESULT"
+
+# TEST #2: Gzipped ELF image
+gzip -c "$TMPDIR/elf" > "$TMPDIR/elf.gz"
+"$KDUMPTOOL" read_ikconfig "$TMPDIR/elf.gz" > "$TMPDIR/out" 2>/dev/null
+RESULT=$( cmp "$CONFIG" "$TMPDIR/out" 2>&1 )
+check "elf.gz" "" "$RESULT"
+
+# TEST #3: Marker across a read boundary
+for padding in 61435 61436 61437 61438 61439 61440 ; do
+    mkimage "$TMPDIR/boundary" $padding "$CONFIG"
+    "$KDUMPTOOL" read_ikconfig "$TMPDIR/boundary" > "$TMPDIR/out" 2>/dev/null
+    RESULT=$( cmp "$CONFIG" "$TMPDIR/out" 2>&1 )
+    check "boundary $padding" "" "$RESULT"
+done
+
+# TEST #4: Truncated configuration
+mkimage "$TMPDIR/truncated" 100 "$CONFIG" 200
+RESULT=$( "$KDUMPTOOL" read_ikconfig "$TMPDIR/truncated" 2>&1 )
+check "truncated" "Cannot read IKCONFIG." "$RESULT"
+
+# TEST #5: No embedded configuration
+RESULT=$( "$KDUMPTOOL" read_ikconfig "$DIR/kernel-ELF-x86_64" 2>&1 )
+check "missing" \
+    "Cannot read configuration from $DIR/kernel-ELF-x86_64." "$RESULT"
+
+# TEST #6: ELF images compressed with other formats
+FEATURES=$( "$KDUMPTOOL" --version 2>&1 )
+for fmt in xz zstd lz4 ; do
+    if ! command -v $fmt >/dev/null || \
+	[[ "$FEATURES" != *"compression:"*" $fmt"* ]] ; then
+	echo "Skipping $fmt"
+	continue
+    fi
+    $fmt -c "$TMPDIR/elf" > "$TMPDIR/elf.$fmt"
+    RESULT=$( "$KDUMPTOOL" -F "$DIR/empty.conf" -C "$TMPDIR/cache" \
+	identify_kernel -t "$TMPDIR/elf.$fmt" 2>&1 )
+    check "type $fmt" "ELF $fmt" "$RESULT"
+    "$KDUMPTOOL" read_ikconfig "$TMPDIR/elf.$fmt" > "$TMPDIR/out" 2>/dev/null
+    RESULT=$( cmp "$CONFIG" "$TMPDIR/out" 2>&1 )
+    check "elf.$fmt" "" "$RESULT"
+done
+
+# TEST #7: bzImage with the payload location in the boot header
+case $(uname -m) in
+    i?86|x86_64)
+	BZIMAGE="$TMPDIR/bzImage"
+	truncate -s 1024 "$BZIMAGE"
+	put "$BZIMAGE" $(( 0x1f1 )) "\001"		# setup_sects
+	put "$BZIMAGE" $(( 0x202 )) "HdrS\017\002"	# boot protocol 2.15
+	gzip -c "$TMPDIR/elf" >> "$BZIMAGE"
+	head -c 4096 /dev/zero >> "$BZIMAGE"
+	"$KDUMPTOOL" read_ikconfig "$BZIMAGE" > "$TMPDIR/out" 2>/dev/null
+	RESULT=$( cmp "$CONFIG" "$TMPDIR/out" 2>&1 )
+	check "bzImage" "" "$RESULT"
+	;;
+esac
+
+# TEST #8: Query individual options
+RESULT=$( "$KDUMPTOOL" read_ikconfig "$TMPDIR/elf" CONFIG_NR_CPUS \
+    CONFIG_MISSING CONFIG_UNUSED_1 CONFIG_LOCALVERSION 2>&1 )
+check "options" "CONFIG_NR_CPUS=128
+# CONFIG_UNUSED_1 is not set
+CONFIG_LOCALVERSION=\"-test\"" "$RESULT"
+
+exit $errornumber
+
+# }}}
+
+# vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
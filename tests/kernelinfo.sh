@@ -0,0 +1,119 @@
+#!/bin/bash
+#
+# (c) 2026, SUSE LLC
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+# 02110-1301, USA.
+#
+
+# Create a minimal x86_64 ELF file with a GNU build-id note
+#                                                                            {{{
+function mkbuildid()
+{
+    local file="$1"
+    local id="$2"
+    {
+	# ELF header
+	printf '\x7fELF\x02\x01\x01\0\0\0\0\0\0\0\0\0'
+	printf '\x02\0\x3e\0\x01\0\0\0'
+	printf '\0\0\0\0\0\0\0\0'		# e_entry
+	printf '\x40\0\0\0\0\0\0\0'		# e_phoff
+	printf '\0\0\0\0\0\0\0\0\0\0\0\0'	# e_shoff, e_flags
+	printf '\x40\0\x38\0\x01\0\0\0\0\0\0\0'
+	# PT_NOTE program header
+	printf '\x04\0\0\0\x04\0\0\0'
+	printf '\x78\0\0\0\0\0\0\0'		# p_offset
+	printf '\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0'
+	printf '\x24\0\0\0\0\0\0\0\x24\0\0\0\0\0\0\0'
+	printf '\x04\0\0\0\0\0\0\0'
+	# NT_GNU_BUILD_ID
+	printf '\x04\0\0\0\x14\0\0\0\x03\0\0\0GNU\0'
+	printf "$(echo "$id" | sed 's/../\\x&/g')"
+    } > "$file"
+}
+# }}}
+
+#
+# Program                                                                    {{{
+#
+
+TESTKERNELINFO=$1
+DIR=$2
+
+if [ -z "$TESTKERNELINFO" ] || [ -z "$DIR" ] ; then
+    echo "Usage: $0 testkernelinfo directory"
+    exit 1
+fi
+
+. "$(dirname "$0")/testutil.sh"
+
+errornumber=0
+TMPDIR=$(mktemp -d)
+trap 'rm -rf "$TMPDIR"' EXIT
+
+CACHE="$TMPDIR/cache/kernels"
+ELF="$TMPDIR/kernel-ELF-aarch64"
+ELFGZ="$TMPDIR/kernel-ELFgz-x86_64"
+OTHER="$TMPDIR/test.txt"
+cp "$DIR/kernel-ELF-aarch64" "$DIR/kernel-ELFgz-x86_64" "$DIR/test.txt" \
+   "$TMPDIR"
+
+# TEST #1: Compute properties and create the cache
+RESULT=$( "$TESTKERNELINFO" "$CACHE" "$ELF" "$ELFGZ" "$OTHER" 2>/dev/null )
+check "compute" "0 1 aarch64
+1 0 x86_64
+8" "$RESULT"
+[ -f "$CACHE" ] || check "create" "$CACHE" "(missing)"
+
+# TEST #2: Take all properties from the cache
+RESULT=$( "$TESTKERNELINFO" "$CACHE" "$ELF" "$ELFGZ" "$OTHER" 2>/dev/null )
+check "cached" "0 1 aarch64 (cached)
+1 0 x86_64 (cached)
+8 (cached)" "$RESULT"
+
+# TEST #3: A modified image is examined again
+cat "$DIR/kernel-ELF-x86_64" > "$ELF"
+RESULT=$( "$TESTKERNELINFO" "$CACHE" "$ELF" "$ELFGZ" 2>/dev/null )
+check "modified" "0 0 x86_64
+1 0 x86_64 (cached)" "$RESULT"
+
+# TEST #4: Entries for removed images are dropped
+rm "$OTHER"
+touch "$ELF"
+"$TESTKERNELINFO" "$CACHE" "$ELF" >/dev/null 2>&1
+RESULT=$( grep -c "$OTHER" "$CACHE" )
+check "prune" "0" "$RESULT"
+
+# TEST #5: A cache file with an unknown format is ignored
+echo "garbage" > "$CACHE"
+RESULT=$( "$TESTKERNELINFO" "$CACHE" "$ELFGZ" 2>/dev/null )
+check "format" "1 0 x86_64" "$RESULT"
+
+# TEST #6: Build-id of plain and compressed ELF images
+ID=0123456789abcdef0123456789abcdef01234567
+mkbuildid "$TMPDIR/vmlinux" "$ID"
+gzip -c "$TMPDIR/vmlinux" > "$TMPDIR/vmlinux.gz"
+RESULT=$( "$TESTKERNELINFO" "$CACHE" "$TMPDIR/vmlinux" "$TMPDIR/vmlinux.gz" \
+    2>/dev/null )
+check "build-id" "0 0 x86_64 build-id=$ID
+1 0 x86_64 build-id=$ID" "$RESULT"
+RESULT=$( "$TESTKERNELINFO" "$CACHE" "$TMPDIR/vmlinux.gz" 2>/dev/null )
+check "build-id cached" "1 0 x86_64 build-id=$ID (cached)" "$RESULT"
+
+exit $errornumber
+
+# }}}
+
+# vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
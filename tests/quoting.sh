@@ -31,7 +31,7 @@ if [ -z "$DIR" ] || [ -z "$KDUMPTOOL" ] ; then
 fi
 
 errors=0
-output=$( $KDUMPTOOL -F $DIR/quoting.conf dump_config )
+output=$( $KDUMPTOOL -F $DIR/quoting.conf -C "" dump_config )
 status=$?
 if [ $status -ne 0 ] ; then
     echo "Exitstatus is '$status'"
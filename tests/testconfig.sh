@@ -60,6 +60,99 @@ if [ "$QUOTING" != '$FOO' ] ; then
     errors=$[$errors + 1]
 fi
 
+# Compare the parsed value of a variable with what the shell prints
+function compare()
+{
+    local file="$1"
+    local name="$2"
+    local result expect
+    result=$($TESTCONFIG -c "$TMPDIR/cache" "$file" "$name" 2>/dev/null)
+    expect=$(/bin/sh -c "$name=; . \"\$1\"; echo '$name='\$$name" \
+        sh "$file")
+    expect=${expect#$name=}
+    if [ "$result" != "$expect" ] ; then
+        echo "\$$name in $file must be '$expect' but is '$result'."
+        errors=$[$errors + 1]
+    fi
+}
+
+TMPDIR=$(mktemp -d)
+trap 'rm -rf "$TMPDIR"' EXIT
+
+# Constructs handled without a shell
+NATIVE="$TMPDIR/native.conf"
+cat > "$NATIVE" <<'END'
+# comment
+A=plain
+B="double quoted  with   spaces"
+C='single $A quoted'
+D="expand $A and ${B}"
+E=$A$C	# trailing comment
+F=unquoted\ escaped
+G="multi
+line"
+H=
+I=a#b
+J="dollar $ alone"
+K=$HOME
+L=$UNDEFINED_VARIABLE
+M=one;N=two
+O="line \
+continued"
+P='it'\''s'
+END
+for name in A B C D E F G H I J K L M N O P ; do
+    compare "$NATIVE" $name
+done
+if $TESTCONFIG -c "$TMPDIR/cache" "$NATIVE" A 2>&1 | grep -q /bin/sh ; then
+    echo "$NATIVE should be parsed without a shell."
+    errors=$[$errors + 1]
+fi
+if ! $TESTCONFIG -c "$TMPDIR/cache" "$NATIVE" A 2>&1 | grep -q "in cache" ; then
+    echo "$NATIVE should be taken from the cache."
+    errors=$[$errors + 1]
+fi
+
+# Constructs which need a shell
+SHELLCONF="$TMPDIR/shell.conf"
+cat > "$SHELLCONF" <<'END'
+A=$(echo command substitution)
+B=${A:-default}
+C="a * b"
+END
+for name in A B C ; do
+    compare "$SHELLCONF" $name
+done
+if ! $TESTCONFIG "$SHELLCONF" A 2>&1 | grep -q /bin/sh ; then
+    echo "$SHELLCONF should be parsed with a shell."
+    errors=$[$errors + 1]
+fi
+
+# Word splitting, compared with the shell
+function compare_words()
+{
+    local text="$1"
+    local result expect
+    result=$($TESTCONFIG -w "$text" 2>/dev/null)
+    expect=$(/bin/sh -c "set -- $text; for a; do printf '[%s]' \"\$a\"; done")
+    if [ "$result" != "$expect" ] ; then
+        echo "Words of '$text' must be '$expect' but are '$result'."
+        errors=$[$errors + 1]
+    fi
+}
+
+compare_words ''
+compare_words '-D'
+compare_words '  --message-level   31 -D '
+compare_words '--config "/tmp/with space.conf"'
+compare_words "--config '/tmp/it'\''s.conf' a\\ b"
+compare_words '"$HOME" $HOME/x'
+compare_words '/proc/cpuinf?'
+if $TESTCONFIG -w '"a b" c' 2>&1 | grep -q /bin/sh ; then
+    echo "Quoted words should be split without a shell."
+    errors=$[$errors + 1]
+fi
+
 exit $errors
 
 # vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -27,7 +27,8 @@ if [ -z "$DIR" ] || [ -z "$TESTIO" ] ; then
 fi
 
 errors=0
-$TESTIO $DIR/test.txt $DIR/test.txt.1 $DIR/test.txt.2
+$TESTIO $DIR/test.txt $DIR/test.txt.1 $DIR/test.txt.2 \
+    $DIR/test.txt.3 $DIR/test.txt.4
 
 cmp $DIR/test.txt $DIR/test.txt.1
 if [ $? -ne 0 ] ; then
@@ -41,7 +42,19 @@ if [ $? -ne 0 ] ; then
     errors=$[$errors+1]
 fi
 
-rm -f $DIR/test.txt.1 $DIR/test.txt.2
+cmp $DIR/test.txt $DIR/test.txt.3
+if [ $? -ne 0 ] ; then
+    echo "$DIR/test.txt != $DIR/test.txt.3"
+    errors=$[$errors+1]
+fi
+
+cmp $DIR/test.txt $DIR/test.txt.4
+if [ $? -ne 0 ] ; then
+    echo "$DIR/test.txt != $DIR/test.txt.4"
+    errors=$[$errors+1]
+fi
+
+rm -f $DIR/test.txt.1 $DIR/test.txt.2 $DIR/test.txt.3 $DIR/test.txt.4
 exit $errors
 
 # vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
@@ -0,0 +1,53 @@
+#
+# (c) 2026, SUSE LLC
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+# 02110-1301, USA.
+#
+# Helper functions shared by the test scripts.
+#
+
+# Write data at a given offset of a file
+#                                                                            {{{
+function put()
+{
+    local file="$1"
+    local offset="$2"
+    local data="$3"
+    printf "$data" | dd of="$file" bs=1 seek="$offset" conv=notrunc \
+	status=none
+}
+# }}}
+
+# Check that results match expectation; failures are counted
+# in $errornumber
+#                                                                            {{{
+function check()
+{
+    local name="$1"
+    local expect="$2"
+    local result="$3"
+    if [ "$result" != "$expect" ] ; then
+	echo "failed test: $name"
+	echo "Expected:"
+	echo "$expect"
+	echo "Result:"
+	echo "$result"
+	errornumber=$(( errornumber + 1 ))
+    fi
+}
+# }}}
+
+# vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
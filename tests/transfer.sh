@@ -0,0 +1,142 @@
+#!/bin/bash
+#
+# (c) 2026, SUSE LLC
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+# 02110-1301, USA.
+#
+
+# List the copies of the input file below $TMPDIR
+#                                                                            {{{
+function copies()
+{
+    local f
+    for f in "$TMPDIR"/t*/vmcore ; do
+	[ -f "$f" ] || continue
+	if cmp -s "$TMPDIR/input" "$f" ; then
+	    echo "${f#$TMPDIR/} ok"
+	else
+	    echo "${f#$TMPDIR/} differs"
+	fi
+    done
+}
+# }}}
+
+#
+# Program                                                                    {{{
+#
+
+TESTTRANSFER=$1
+
+if [ -z "$TESTTRANSFER" ] ; then
+    echo "Usage: $0 testtransfer"
+    exit 1
+fi
+
+. "$(dirname "$0")/testutil.sh"
+
+errornumber=0
+TMPDIR=$(mktemp -d)
+trap 'rm -rf "$TMPDIR"' EXIT
+
+# random data with holes, larger than the mirror ring
+{
+    head -c 1000000 /dev/urandom
+    head -c 2000000 /dev/zero
+    head -c 1000001 /dev/urandom
+    head -c 300000 /dev/zero
+} > "$TMPDIR/input"
+
+# TEST #1: Mirror to all targets
+"$TESTTRANSFER" mirror "$TMPDIR/input" vmcore \
+    "$TMPDIR/t1" "$TMPDIR/t2" "$TMPDIR/t3" >/dev/null 2>&1
+check "mirror" "t1/vmcore ok
+t2/vmcore ok
+t3/vmcore ok" "$(copies)"
+rm -rf "$TMPDIR"/t*
+
+# TEST #2: A broken mirror does not stop the others
+mkdir -p "$TMPDIR/t2/vmcore"
+"$TESTTRANSFER" mirror "$TMPDIR/input" vmcore \
+    "$TMPDIR/t1" "$TMPDIR/t2" "$TMPDIR/t3" >/dev/null 2>&1
+check "mirror-broken" "0
+t1/vmcore ok
+t3/vmcore ok" "$?
+$(copies)"
+rm -rf "$TMPDIR"/t*
+
+# TEST #3: Failover to the next target
+mkdir -p "$TMPDIR/t1/vmcore"
+"$TESTTRANSFER" failover "$TMPDIR/input" vmcore \
+    "$TMPDIR/t1" "$TMPDIR/t2" >/dev/null 2>&1
+check "failover" "0
+t2/vmcore ok" "$?
+$(copies)"
+rm -rf "$TMPDIR"/t*
+
+# TEST #4: Failover fails if no target works
+mkdir -p "$TMPDIR/t1/vmcore" "$TMPDIR/t2/vmcore"
+"$TESTTRANSFER" failover "$TMPDIR/input" vmcore \
+    "$TMPDIR/t1" "$TMPDIR/t2" >/dev/null 2>&1
+check "failover-all" "1" "$?"
+rm -rf "$TMPDIR"/t*
+
+# TEST #5: A single file is saved to the first target
+"$TESTTRANSFER" stripe "$TMPDIR/input" vmcore \
+    "$TMPDIR/t1" "$TMPDIR/t2" >/dev/null 2>&1
+check "stripe" "t1/vmcore ok" "$(copies)"
+rm -rf "$TMPDIR"/t*
+"$TESTTRANSFER" legacy "$TMPDIR/input" vmcore \
+    "$TMPDIR/t1" "$TMPDIR/t2" >/dev/null 2>&1
+check "legacy" "t1/vmcore ok" "$(copies)"
+rm -rf "$TMPDIR"/t*
+
+# TEST #6: Data from a process saved directly and through a pipe
+cat > "$TMPDIR/dump" <<EOF
+#!/bin/sh
+printf '\rCopying data : [ 50.0 %%]' >&2
+echo "some warning" >&2
+if [ -n "\$1" ] ; then
+    cat "$TMPDIR/input" > "\$1"
+else
+    cat "$TMPDIR/input"
+fi
+EOF
+chmod +x "$TMPDIR/dump"
+"$TESTTRANSFER" -p stripe "$TMPDIR/dump" vmcore "$TMPDIR/t1" >/dev/null 2>&1
+"$TESTTRANSFER" -p mirror "$TMPDIR/dump" vmcore \
+    "$TMPDIR/t2" "$TMPDIR/t3" >/dev/null 2>&1
+check "process" "t1/vmcore ok
+t2/vmcore ok
+t3/vmcore ok" "$(copies)"
+rm -rf "$TMPDIR"/t*
+
+# TEST #7: The last error line of a failed process is reported
+printf '#!/bin/sh\necho "something broke" >&2\nexit 3\n' > "$TMPDIR/dump"
+RESULT=$( "$TESTTRANSFER" -p stripe "$TMPDIR/dump" vmcore "$TMPDIR/t1" \
+    2>&1 >/dev/null | grep '^Fatal' )
+check "process-error" \
+    "Fatal exception: $TMPDIR/dump failed (3): something broke." "$RESULT"
+rm -rf "$TMPDIR"/t*
+
+# TEST #8: Unknown policy
+"$TESTTRANSFER" raid5 "$TMPDIR/input" vmcore "$TMPDIR/t1" >/dev/null 2>&1
+check "policy" "1" "$?"
+
+exit $errornumber
+
+# }}}
+
+# vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1:
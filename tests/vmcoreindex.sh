@@ -0,0 +1,115 @@
+#!/bin/bash
+#
+# (c) 2026, SUSE LLC
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+# 02110-1301, USA.
+#
+
+#
+# Program                                                                    {{{
+#
+
+TESTVMCOREINDEX=$1
+
+if [ -z "$TESTVMCOREINDEX" ] ; then
+    echo "Usage: $0 testvmcoreindex"
+    exit 1
+fi
+
+. "$(dirname "$0")/data/elfcore.sh"
+. "$(dirname "$0")/testutil.sh"
+
+errornumber=0
+TMPDIR=$(mktemp -d)
+trap 'rm -rf "$TMPDIR"' EXIT
+
+VMCOREINFO="OSRELEASE=6.4.0-test
+CRASHTIME=1700000000
+"
+VMCOREINFO_XEN="OSRELEASE=4.17.0-xen
+"
+PRSTATUS=$(printf '%0336d' 0)
+
+# TEST #1: Notes and PT_LOAD segments of a kernel dump
+{
+    note CORE 1 "$PRSTATUS"
+    note CORE 1 "$PRSTATUS"
+    note VMCOREINFO 0 "$VMCOREINFO"
+} > "$TMPDIR/notes"
+mkcore "$TMPDIR/vmcore" "$TMPDIR/notes" 3
+RESULT=$( "$TESTVMCOREINDEX" "$TMPDIR/vmcore" 2>&1 )
+check "kernel" "ELF64 phnum=4 loads=3 memsz=3145728 cpus=2 xen=0
+note CORE 1 336
+note CORE 1 336
+note VMCOREINFO 0 42
+OSRELEASE=6.4.0-test xen=0" "$RESULT"
+
+# TEST #2: Xen hypervisor dump
+{
+    note CORE 1 "$PRSTATUS"
+    note Xen 0x1000001 "0000"
+    note VMCOREINFO_XEN 0 "$VMCOREINFO_XEN"
+} > "$TMPDIR/notes"
+mkcore "$TMPDIR/vmcore" "$TMPDIR/notes" 1
+RESULT=$( "$TESTVMCOREINDEX" "$TMPDIR/vmcore" 2>&1 )
+check "xen" "ELF64 phnum=2 loads=1 memsz=1048576 cpus=1 xen=1
+note CORE 1 336
+note Xen 16777217 4
+note VMCOREINFO_XEN 0 21
+OSRELEASE=4.17.0-xen xen=1" "$RESULT"
+
+# TEST #3: A truncated note is ignored
+{
+    note VMCOREINFO 0 "$VMCOREINFO"
+    le 4 5 ; le 4 4096 ; le 4 1
+    printf 'CORE\0\0\0\0'
+} > "$TMPDIR/notes"
+mkcore "$TMPDIR/vmcore" "$TMPDIR/notes" 0
+RESULT=$( "$TESTVMCOREINDEX" "$TMPDIR/vmcore" 2>&1 )
+check "truncated" "ELF64 phnum=1 loads=0 memsz=0 cpus=0 xen=0
+note VMCOREINFO 0 42
+OSRELEASE=6.4.0-test xen=0" "$RESULT"
+
+# TEST #4: Extended program header numbering (PN_XNUM)
+{
+    note CORE 1 "$PRSTATUS"
+    note VMCOREINFO 0 "$VMCOREINFO"
+} > "$TMPDIR/notes"
+mkcore "$TMPDIR/vmcore" "$TMPDIR/notes" 2 xnum
+RESULT=$( "$TESTVMCOREINDEX" "$TMPDIR/vmcore" 2>&1 )
+check "xnum" "ELF64 phnum=3 loads=2 memsz=2097152 cpus=1 xen=0
+note CORE 1 336
+note VMCOREINFO 0 42
+OSRELEASE=6.4.0-test xen=0" "$RESULT"
+
+# TEST #5: Headers and notes beyond the first 128 KiB
+mkcore "$TMPDIR/vmcore" "$TMPDIR/notes" 2 "" 262144
+RESULT=$( "$TESTVMCOREINDEX" "$TMPDIR/vmcore" 2>&1 )
+check "large" "ELF64 phnum=3 loads=2 memsz=2097152 cpus=1 xen=0
+note CORE 1 336
+note VMCOREINFO 0 42
+OSRELEASE=6.4.0-test xen=0" "$RESULT"
+
+# TEST #6: Truncated program header table
+head -c 262200 "$TMPDIR/vmcore" > "$TMPDIR/short"
+RESULT=$( "$TESTVMCOREINDEX" "$TMPDIR/short" 2>/dev/null )
+check "short" "error" "$RESULT"
+
+exit $errornumber
+
+# }}}
+
+# vim: set sw=4 ts=4 fdm=marker et: :collapseFolds=1: